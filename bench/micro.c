@@ -0,0 +1,631 @@
+/**
+ * Microbenchmarks das rotinas de nó
+ *
+ * Mede, para cada ordem, a busca dentro de um nó (keys_lower_bound()), os
+ * kernels de divisão, mescla e empréstimos (node_kernels_for()), usados por
+ * node_split_child(), node_merge() e node_ensure_min_keys(), e a ida e volta
+ * de um nó pelo arquivo (disk_write() e disk_read())
+ *
+ * Cada rodada prepara MICRO_SETS conjuntos de nós fora da medição e aplica a
+ * rotina a todos eles; as rodadas se repetem até somarem o tempo pedido. O
+ * custo fixo de uma rodada vazia é medido antes e descontado. Os nós ficam no
+ * cache, de modo que a medida é a do próprio kernel
+ *
+ * Ciclos e instruções vêm de perf_event_open(), contando também o kernel
+ * quando permitido; sem acesso aos contadores, só o tempo é mostrado
+ *
+ * Uso: micro [opções]
+ *   -O o,...   Ordens (padrão 4,16,64,128,255,341,1024)
+ *   -k nome    Mede apenas a rotina com esse nome
+ *   -T ms      Tempo medido de cada rotina em cada ordem (padrão 100)
+ *   -i         Nós internos nos kernels (padrão: folhas)
+ *   -b backend pread ou mmap (padrão pread)
+ *   -f arquivo Arquivo usado por disk_read e disk_write (padrão micro.db)
+ */
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btree.h"
+#include "kernels.h"
+#include "keys.h"
+#include "node.h"
+#include "storage.h"
+
+// Conjuntos de nós preparados para cada rodada
+#define MICRO_SETS 32
+
+// Chaves procuradas em cada rodada da busca
+#define MICRO_PROBES 1024
+
+// Rodadas vazias usadas para medir o custo fixo de uma rodada
+#define MICRO_CALIBRATION 4096
+
+// Quantidade máxima de ordens na lista
+#define MICRO_MAX_ORDERS 16
+
+/**
+ * Contadores de hardware do thread, lidos em grupo
+ */
+typedef struct micro_perf {
+  int fd;      // Líder do grupo (ciclos) ou -1 sem contadores
+  int instrs;  // Instruções
+  bool kernel; // Flag indicando que o tempo no kernel também é contado
+} micro_perf_t;
+
+/**
+ * Totais de uma medição
+ */
+typedef struct micro_sample {
+  double ns;     // Tempo
+  double cycles; // Ciclos
+  double instrs; // Instruções
+  size_t ops;    // Operações
+} micro_sample_t;
+
+/**
+ * Nós de um conjunto: o pai e os filhos idx e idx + 1 (ou idx - 1 e idx nos
+ * empréstimos do irmão à esquerda)
+ */
+typedef struct micro_set {
+  node_t *parent;
+  node_t *left;
+  node_t *right;
+  int idx;
+} micro_set_t;
+
+/**
+ * Estado compartilhado pelas rotinas de uma ordem
+ */
+typedef struct micro_ctx {
+  size_t order;                    // Ordem
+  bool leaf;                       // Flag indicando filhos folha
+  const node_kernels_t *kernels;   // Kernels da ordem
+  storage_t *st;                   // Arquivo das rotinas de disco
+  node_slab_t *slab;               // Alocador dos nós
+  micro_set_t sets[MICRO_SETS];    // Conjuntos de nós
+  int probes[MICRO_PROBES];        // Chaves procuradas
+  uint64_t rng;                    // Estado do gerador xorshift64*
+  int sink;                        // Resultado acumulado, para não ser
+                                   // descartado pelo compilador
+} micro_ctx_t;
+
+/**
+ * Rotina medida
+ */
+typedef struct micro_case {
+  const char *name;
+
+  // Prepara os conjuntos, fora da medição
+  void (*prepare)(micro_ctx_t *ctx);
+
+  // Executa a rotina sobre todos os conjuntos
+  int (*run)(micro_ctx_t *ctx);
+
+  // Operações de uma rodada
+  size_t ops;
+} micro_case_t;
+
+static uint64_t micro_rand(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+
+  return x * 0x2545f4914f6cdd1dull;
+}
+
+static double micro_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int micro_perf_event(uint64_t config, bool kernel, int group) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = group == -1;
+  attr.exclude_kernel = !kernel;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/**
+ * Abre os contadores de ciclos e instruções, contando o kernel se permitido
+ * e só o espaço de usuário caso contrário
+ */
+static void micro_perf_open(micro_perf_t *perf) {
+  perf->fd = perf->instrs = -1;
+
+  for (int kernel = 1; kernel >= 0 && perf->fd < 0; kernel--) {
+    perf->fd = micro_perf_event(PERF_COUNT_HW_CPU_CYCLES, kernel, -1);
+    perf->kernel = kernel;
+  }
+
+  if (perf->fd < 0)
+    return;
+
+  perf->instrs = micro_perf_event(PERF_COUNT_HW_INSTRUCTIONS, perf->kernel,
+                                  perf->fd);
+  if (perf->instrs < 0) {
+    close(perf->fd);
+    perf->fd = -1;
+  }
+}
+
+static void micro_perf_close(micro_perf_t *perf) {
+  if (perf->fd < 0)
+    return;
+
+  close(perf->instrs);
+  close(perf->fd);
+}
+
+static void micro_perf_start(const micro_perf_t *perf) {
+  if (perf->fd < 0)
+    return;
+
+  ioctl(perf->fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(perf->fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+/**
+ * Para os contadores e soma os valores lidos, corrigidos pela fração do
+ * tempo em que estiveram ativos se foram multiplexados
+ */
+static void micro_perf_stop(const micro_perf_t *perf, micro_sample_t *out) {
+  if (perf->fd < 0)
+    return;
+
+  ioctl(perf->fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+  struct {
+    uint64_t nr, enabled, running, values[2];
+  } data;
+
+  if (read(perf->fd, &data, sizeof(data)) != sizeof(data) ||
+      data.running == 0)
+    return;
+
+  double scale = (double)data.enabled / data.running;
+  out->cycles += data.values[0] * scale;
+  out->instrs += data.values[1] * scale;
+}
+
+/**
+ * Preenche um nó com n chaves a partir de base, de 2 em 2
+ */
+static void micro_fill(node_t *node, bool leaf, size_t order, size_t n,
+                       int base) {
+  node_init(node, leaf, order, node->bin_pos);
+
+  for (size_t i = 0; i < n; i++) {
+    node->keys[i] = base + 2 * i;
+    node->values[i] = base + 2 * i;
+  }
+
+  if (!leaf)
+    for (size_t i = 0; i <= n; i++)
+      node->children[i] = DISK_FIRST_NODE_PAGE + i;
+
+  node->n_keys = n;
+}
+
+/**
+ * Pai com metade das chaves e filhos idx e idx + 1 com as chaves dadas
+ */
+static void micro_family(micro_ctx_t *ctx, size_t left, size_t right) {
+  size_t order = ctx->order;
+  size_t p = (order - 1) / 2 > 2 ? (order - 1) / 2 : 2;
+  int idx = p / 2;
+
+  for (size_t s = 0; s < MICRO_SETS; s++) {
+    micro_set_t *set = &ctx->sets[s];
+
+    micro_fill(set->parent, false, order, p, 1 << 20);
+    micro_fill(set->left, ctx->leaf, order, left, 0);
+    micro_fill(set->right, ctx->leaf, order, right, 1 << 21);
+    set->idx = idx;
+  }
+}
+
+static void micro_prepare_none(micro_ctx_t *ctx) { (void)ctx; }
+
+static int micro_run_none(micro_ctx_t *ctx) {
+  (void)ctx;
+  return 0;
+}
+
+static void micro_prepare_search(micro_ctx_t *ctx) {
+  micro_fill(ctx->sets[0].left, true, ctx->order, ctx->order - 1, 0);
+
+  // Chaves presentes e ausentes, de todo o intervalo do nó
+  for (size_t i = 0; i < MICRO_PROBES; i++)
+    ctx->probes[i] = micro_rand(&ctx->rng) % (2 * ctx->order);
+}
+
+static int micro_run_search(micro_ctx_t *ctx) {
+  const node_t *node = ctx->sets[0].left;
+  int sum = 0;
+
+  for (size_t i = 0; i < MICRO_PROBES; i++)
+    sum += keys_lower_bound(node->keys, node->n_keys, ctx->probes[i]);
+
+  return sum;
+}
+
+// Filho cheio e irmão vazio
+static void micro_prepare_split(micro_ctx_t *ctx) {
+  micro_family(ctx, ctx->order - 1, 0);
+}
+
+static int micro_run_split(micro_ctx_t *ctx) {
+  for (size_t s = 0; s < MICRO_SETS; s++) {
+    micro_set_t *set = &ctx->sets[s];
+    ctx->kernels->split(set->parent, set->idx, set->left, set->right,
+                        ctx->order);
+  }
+
+  return ctx->sets[0].parent->n_keys;
+}
+
+// Os dois filhos com t - 1 chaves, como na mescla de node_ensure_min_keys()
+static void micro_prepare_merge(micro_ctx_t *ctx) {
+  size_t t = node_min_degree(ctx->order);
+  micro_family(ctx, t - 1, t - 1);
+}
+
+static int micro_run_merge(micro_ctx_t *ctx) {
+  for (size_t s = 0; s < MICRO_SETS; s++) {
+    micro_set_t *set = &ctx->sets[s];
+    ctx->kernels->merge(set->parent, set->idx, set->left, set->right,
+                        ctx->order);
+  }
+
+  return ctx->sets[0].left->n_keys;
+}
+
+// Irmão à esquerda com t chaves e filho com t - 1
+static void micro_prepare_borrow_left(micro_ctx_t *ctx) {
+  size_t t = node_min_degree(ctx->order);
+  micro_family(ctx, t, t - 1);
+}
+
+static int micro_run_borrow_left(micro_ctx_t *ctx) {
+  for (size_t s = 0; s < MICRO_SETS; s++) {
+    micro_set_t *set = &ctx->sets[s];
+    ctx->kernels->borrow_left(set->parent, set->idx + 1, set->right,
+                              set->left, ctx->order);
+  }
+
+  return ctx->sets[0].right->n_keys;
+}
+
+// Filho com t - 1 chaves e irmão à direita com t
+static void micro_prepare_borrow_right(micro_ctx_t *ctx) {
+  size_t t = node_min_degree(ctx->order);
+  micro_family(ctx, t - 1, t);
+}
+
+static int micro_run_borrow_right(micro_ctx_t *ctx) {
+  for (size_t s = 0; s < MICRO_SETS; s++) {
+    micro_set_t *set = &ctx->sets[s];
+    ctx->kernels->borrow_right(set->parent, set->idx, set->left, set->right,
+                               ctx->order);
+  }
+
+  return ctx->sets[0].left->n_keys;
+}
+
+// Nós cheios, cada um na sua página
+static void micro_prepare_write(micro_ctx_t *ctx) {
+  for (size_t s = 0; s < MICRO_SETS; s++)
+    micro_fill(ctx->sets[s].left, ctx->leaf, ctx->order, ctx->order - 1,
+               s << 16);
+}
+
+static int micro_run_write(micro_ctx_t *ctx) {
+  int sum = 0;
+
+  for (size_t s = 0; s < MICRO_SETS; s++)
+    sum += disk_write(ctx->st, ctx->sets[s].left, ctx->order);
+
+  return sum;
+}
+
+static int micro_run_read(micro_ctx_t *ctx) {
+  int sum = 0;
+
+  for (size_t s = 0; s < MICRO_SETS; s++) {
+    node_t *node = ctx->sets[s].left;
+    sum += disk_read(ctx->st, node, ctx->order, node->bin_pos);
+    sum += node->keys[node->n_keys - 1];
+  }
+
+  return sum;
+}
+
+// disk_read lê as páginas deixadas pela rotina anterior
+static const micro_case_t cases[] = {
+    {"search", micro_prepare_search, micro_run_search, MICRO_PROBES},
+    {"split", micro_prepare_split, micro_run_split, MICRO_SETS},
+    {"merge", micro_prepare_merge, micro_run_merge, MICRO_SETS},
+    {"borrow_left", micro_prepare_borrow_left, micro_run_borrow_left,
+     MICRO_SETS},
+    {"borrow_right", micro_prepare_borrow_right, micro_run_borrow_right,
+     MICRO_SETS},
+    {"disk_write", micro_prepare_write, micro_run_write, MICRO_SETS},
+    {"disk_read", micro_prepare_none, micro_run_read, MICRO_SETS},
+};
+
+/**
+ * Repete rodadas da rotina até somar budget nanossegundos medidos
+ *
+ * @param rounds Quantidade fixa de rodadas ou 0 para usar o tempo
+ */
+static micro_sample_t micro_measure(micro_ctx_t *ctx, const micro_case_t *c,
+                                    const micro_perf_t *perf, double budget,
+                                    size_t rounds) {
+  micro_sample_t total = {0};
+
+  for (size_t r = 0; rounds ? r < rounds : total.ns < budget; r++) {
+    c->prepare(ctx);
+
+    micro_perf_start(perf);
+    double start = micro_now();
+
+    ctx->sink += c->run(ctx);
+
+    total.ns += micro_now() - start;
+    micro_perf_stop(perf, &total);
+    total.ops += c->ops;
+  }
+
+  return total;
+}
+
+/**
+ * Desconta de uma medição o custo fixo das suas rodadas
+ */
+static void micro_subtract(micro_sample_t *sample, const micro_case_t *c,
+                           const micro_sample_t *overhead) {
+  double rounds = (double)sample->ops / c->ops;
+  double per_round = 1.0 / MICRO_CALIBRATION;
+
+  sample->ns -= rounds * overhead->ns * per_round;
+  sample->cycles -= rounds * overhead->cycles * per_round;
+  sample->instrs -= rounds * overhead->instrs * per_round;
+
+  if (sample->ns < 0)
+    sample->ns = 0;
+  if (sample->cycles < 0)
+    sample->cycles = 0;
+  if (sample->instrs < 0)
+    sample->instrs = 0;
+}
+
+/**
+ * Escolhe a menor página em que cabe um nó da ordem
+ *
+ * @return Tamanho da página ou 0 se a ordem não couber em nenhuma
+ */
+static size_t micro_page_size(size_t order) {
+  static const size_t sizes[] = {BTREE_PAGE_4K, BTREE_PAGE_8K, BTREE_PAGE_16K};
+
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); i++)
+    if (btree_max_order(sizes[i], BTREE_LAYOUT_BTREE) >= order)
+      return sizes[i];
+
+  return 0;
+}
+
+/**
+ * Mede as rotinas escolhidas em uma ordem
+ *
+ * @return BTREE_SUCCESS ou código de erro
+ */
+static int micro_order(size_t order, const btree_options_t *base,
+                       const char *only, const micro_perf_t *perf,
+                       double budget, bool leaf, const char *filename) {
+  btree_options_t opts = *base;
+  opts.page_size = micro_page_size(order);
+
+  if (order < 4 || opts.page_size == 0) {
+    fprintf(stderr, "ordem %zu: fora do intervalo\n", order);
+    return BTREE_ERROR_INVALID_PARAM;
+  }
+
+  micro_ctx_t ctx = {
+      .order = order,
+      .leaf = leaf,
+      .kernels = node_kernels_for(order),
+      .rng = 0x9e3779b97f4a7c15ull,
+  };
+
+  ctx.slab = node_slab_create(false, order, opts.page_size);
+  ctx.st = storage_open(filename, "w+b", &opts, NULL);
+  if (!ctx.slab || !ctx.st) {
+    fprintf(stderr, "ordem %zu: erro ao abrir %s\n", order, filename);
+    node_slab_destroy(ctx.slab);
+    if (ctx.st)
+      storage_close(ctx.st);
+    return BTREE_ERROR_IO;
+  }
+
+  int result = node_slab_reserve(ctx.slab, 3 * MICRO_SETS);
+
+  for (size_t s = 0; s < MICRO_SETS && result == BTREE_SUCCESS; s++) {
+    micro_set_t *set = &ctx.sets[s];
+    size_t page = DISK_FIRST_NODE_PAGE + 3 * s;
+
+    set->parent = node_slab_alloc(ctx.slab, false, page);
+    set->left = node_slab_alloc(ctx.slab, leaf, page + 1);
+    set->right = node_slab_alloc(ctx.slab, leaf, page + 2);
+
+    if (!set->parent || !set->left || !set->right)
+      result = BTREE_ERROR_ALLOC;
+  }
+
+  if (result == BTREE_SUCCESS) {
+    const micro_case_t empty = {"", micro_prepare_none, micro_run_none, 1};
+    micro_sample_t overhead =
+        micro_measure(&ctx, &empty, perf, 0, MICRO_CALIBRATION);
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(*cases); i++) {
+      const micro_case_t *c = &cases[i];
+
+      // disk_read depende das páginas escritas por disk_write
+      bool needed = !only || strcmp(only, c->name) == 0 ||
+                    (strcmp(only, "disk_read") == 0 &&
+                     strcmp(c->name, "disk_write") == 0);
+      if (!needed)
+        continue;
+
+      micro_sample_t sample = micro_measure(&ctx, c, perf, budget, 0);
+      if (only && strcmp(only, c->name) != 0)
+        continue;
+
+      micro_subtract(&sample, c, &overhead);
+
+      printf("%6zu  %-12s %10.1f", order, c->name, sample.ns / sample.ops);
+      if (perf->fd >= 0)
+        printf(" %10.1f %10.1f %6.2f", sample.cycles / sample.ops,
+               sample.instrs / sample.ops,
+               sample.cycles ? sample.instrs / sample.cycles : 0);
+      printf("\n");
+    }
+  }
+
+  storage_close(ctx.st);
+  node_slab_destroy(ctx.slab);
+  unlink(filename);
+
+  return result;
+}
+
+/**
+ * Lê uma lista de ordens separadas por vírgulas
+ *
+ * @return Quantidade de ordens lidas ou 0 se a lista for inválida
+ */
+static size_t micro_parse_orders(const char *arg, size_t *orders) {
+  size_t n = 0;
+
+  while (*arg && n < MICRO_MAX_ORDERS) {
+    char *end;
+    orders[n++] = strtoul(arg, &end, 10);
+
+    if (end == arg)
+      return 0;
+    if (*end == ',')
+      end++;
+    else if (*end != '\0')
+      return 0;
+
+    arg = end;
+  }
+
+  return *arg ? 0 : n;
+}
+
+static void micro_usage(const char *prog) {
+  fprintf(stderr,
+          "uso: %s [-O ordem,...] [-k rotina] [-T ms] [-i] [-b pread|mmap] "
+          "[-f arquivo]\n",
+          prog);
+}
+
+int main(int argc, char *argv[]) {
+  size_t orders[MICRO_MAX_ORDERS] = {4, 16, 64, 128, 255, 341, 1024};
+  size_t n_orders = 7;
+  const char *only = NULL;
+  const char *filename = "micro.db";
+  double budget = 100e6;
+  bool leaf = true;
+
+  btree_options_t opts;
+  btree_options_init(&opts);
+
+  int c;
+  while ((c = getopt(argc, argv, "O:k:T:ib:f:h")) != -1) {
+    switch (c) {
+    case 'O':
+      n_orders = micro_parse_orders(optarg, orders);
+      break;
+    case 'k':
+      only = optarg;
+      break;
+    case 'T':
+      budget = strtod(optarg, NULL) * 1e6;
+      break;
+    case 'i':
+      leaf = false;
+      break;
+    case 'b':
+      opts.backend = strcmp(optarg, "mmap") == 0 ? BTREE_BACKEND_MMAP
+                                                 : BTREE_BACKEND_PREAD;
+      break;
+    case 'f':
+      filename = optarg;
+      break;
+    default:
+      micro_usage(argv[0]);
+      return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  if (n_orders == 0 || !(budget > 0)) {
+    micro_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (only) {
+    bool found = false;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(*cases); i++)
+      found |= strcmp(only, cases[i].name) == 0;
+
+    if (!found) {
+      fprintf(stderr, "rotina desconhecida: %s\n", only);
+      return EXIT_FAILURE;
+    }
+  }
+
+  micro_perf_t perf;
+  micro_perf_open(&perf);
+
+  printf("# busca %s, %s, backend %s, contadores %s\n", keys_kernel(),
+         leaf ? "folhas" : "nós internos",
+         opts.backend == BTREE_BACKEND_MMAP ? "mmap" : "pread",
+         perf.fd < 0 ? "indisponíveis"
+                     : perf.kernel ? "usuário e kernel" : "só usuário");
+  printf("%6s  %-12s %10s", "ordem", "rotina", "ns/op");
+  if (perf.fd >= 0)
+    printf(" %10s %10s %6s", "ciclos/op", "instr/op", "IPC");
+  printf("\n");
+
+  int status = EXIT_SUCCESS;
+
+  for (size_t i = 0; i < n_orders; i++)
+    if (micro_order(orders[i], &opts, only, &perf, budget, leaf, filename) !=
+        BTREE_SUCCESS)
+      status = EXIT_FAILURE;
+
+  micro_perf_close(&perf);
+
+  return status;
+}
@@ -0,0 +1,683 @@
+/**
+ * Benchmark com cargas no estilo do YCSB
+ *
+ * Para cada combinação de ordem e quantidade de registros, cria uma árvore,
+ * carrega os registros 0..n-1 e executa a carga escolhida, medindo vazão,
+ * percentis de latência (btree_latency()) e páginas lidas e escritas por
+ * operação (btree_stats())
+ *
+ * Uso: ycsb [opções]
+ *   -w A-F      Carga (padrão A)
+ *   -d dist     Distribuição das chaves: uniform, zipfian ou sequential
+ *               (padrão zipfian; na carga D, zipfian escolhe as mais novas)
+ *   -n n,...    Quantidades de registros carregados, como 1e4,1e6 (padrão 1e5)
+ *   -O o,...    Ordens da árvore, ou auto (padrão auto)
+ *   -o ops      Operações da fase de execução (padrão 1e5)
+ *   -t threads  Threads da fase de execução (padrão 1)
+ *   -p páginas  Capacidade do buffer pool (padrão BTREE_DEFAULT_POOL_PAGES)
+ *   -l layout   btree ou bplus (padrão btree)
+ *   -b backend  pread ou mmap (padrão pread)
+ *   -u          E/S pelo io_uring
+ *   -W          Log de redo
+ *   -F fill     Ocupação dos nós na carga inicial (padrão 1)
+ *   -s seed     Semente dos geradores (padrão 1)
+ *   -f arquivo  Arquivo da árvore, removido ao final (padrão ycsb.db)
+ *
+ * Cargas (proporções de operações):
+ *   A  50% leituras, 50% atualizações
+ *   B  95% leituras, 5% atualizações
+ *   C  100% leituras
+ *   D  95% leituras, 5% inserções; leituras concentradas nas chaves novas
+ *   E  95% varreduras de até 100 chaves, 5% inserções
+ *   F  50% leituras, 50% leituras seguidas de atualização
+ */
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btree.h"
+
+// Registros carregados de uma vez; acima disso, a carga segue em lotes
+#define BENCH_LOAD_CHUNK ((size_t)1 << 24)
+
+// Maior quantidade de chaves de uma varredura da carga E
+#define BENCH_MAX_SCAN 100
+
+// Expoente da distribuição zipfian, o mesmo do YCSB
+#define BENCH_ZIPF_THETA 0.99
+
+// Termos da série zeta somados um a um; o restante é aproximado pela integral
+#define BENCH_ZETA_EXACT ((size_t)1 << 20)
+
+// Quantidade máxima de valores em uma lista de opções
+#define BENCH_MAX_LIST 16
+
+/**
+ * Tipos de operação da fase de execução
+ */
+typedef enum bench_op {
+  BENCH_READ,   // btree_get()
+  BENCH_UPDATE, // btree_insert() sobre uma chave existente
+  BENCH_INSERT, // btree_insert() de uma chave nova
+  BENCH_SCAN,   // btree_cursor_seek() seguido de btree_cursor_next()
+  BENCH_RMW,    // btree_get() seguido de btree_insert() da mesma chave
+  BENCH_N_OPS,
+} bench_op_t;
+
+/**
+ * Distribuições das chaves escolhidas
+ */
+typedef enum bench_dist {
+  BENCH_UNIFORM,    // Qualquer registro com a mesma probabilidade
+  BENCH_ZIPFIAN,    // Poucos registros concentram os acessos
+  BENCH_SEQUENTIAL, // Registros percorridos em ordem por cada thread
+} bench_dist_t;
+
+/**
+ * Carga: proporção de cada tipo de operação
+ */
+typedef struct bench_workload {
+  char name;                // Letra da carga
+  double mix[BENCH_N_OPS];  // Proporções, somando 1
+  bool latest;              // Leituras concentradas nas chaves mais novas
+} bench_workload_t;
+
+static const bench_workload_t workloads[] = {
+    {'A', {[BENCH_READ] = 0.5, [BENCH_UPDATE] = 0.5}, false},
+    {'B', {[BENCH_READ] = 0.95, [BENCH_UPDATE] = 0.05}, false},
+    {'C', {[BENCH_READ] = 1}, false},
+    {'D', {[BENCH_READ] = 0.95, [BENCH_INSERT] = 0.05}, true},
+    {'E', {[BENCH_SCAN] = 0.95, [BENCH_INSERT] = 0.05}, false},
+    {'F', {[BENCH_READ] = 0.5, [BENCH_RMW] = 0.5}, false},
+};
+
+/**
+ * Gerador zipfian de Gray et al., como o do YCSB, sobre [0, n)
+ */
+typedef struct bench_zipf {
+  size_t n;     // Quantidade de itens
+  double alpha; // 1 / (1 - theta)
+  double zetan; // zeta(n, theta)
+  double eta;   // Constante de Gray et al.
+  double half;  // 1 + 0.5^theta
+} bench_zipf_t;
+
+/**
+ * Parâmetros de uma execução
+ */
+typedef struct bench_config {
+  const bench_workload_t *workload; // Carga
+  bench_dist_t dist;                // Distribuição das chaves
+  size_t records;                   // Registros carregados
+  size_t order;                     // Ordem da árvore
+  size_t ops;                       // Operações da fase de execução
+  size_t threads;                   // Threads da fase de execução
+  double fill;                      // Ocupação dos nós na carga
+  uint64_t seed;                    // Semente dos geradores
+  const char *filename;             // Arquivo da árvore
+  btree_options_t opts;             // Opções da árvore
+} bench_config_t;
+
+/**
+ * Estado compartilhado pelos threads da fase de execução
+ */
+typedef struct bench_run {
+  const bench_config_t *cfg; // Parâmetros
+  btree_t *tree;             // Árvore
+  bench_zipf_t zipf;         // Gerador zipfian sobre os registros carregados
+  size_t next_key;           // Próxima chave inserida
+  size_t done[BENCH_N_OPS];  // Operações feitas de cada tipo
+  size_t errors;             // Operações que falharam
+} bench_run_t;
+
+/**
+ * Estado de um thread da fase de execução
+ */
+typedef struct bench_thread {
+  bench_run_t *run; // Estado compartilhado
+  size_t id;        // Número do thread
+  size_t ops;       // Operações deste thread
+  uint64_t rng;     // Estado do gerador xorshift64*
+  size_t seq;       // Próximo registro da distribuição sequencial
+} bench_thread_t;
+
+static const char *const op_names[BENCH_N_OPS] = {"read", "update", "insert",
+                                                  "scan", "rmw"};
+
+static const char *const dist_names[] = {"uniform", "zipfian", "sequential"};
+
+static uint64_t bench_rand(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  *state = x;
+
+  return x * 0x2545f4914f6cdd1dull;
+}
+
+/**
+ * @return Valor uniforme em [0, 1)
+ */
+static double bench_uniform(uint64_t *state) {
+  return (bench_rand(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Calcula zeta(n, theta) = soma de 1 / i^theta para i em [1, n]
+ *
+ * Os primeiros BENCH_ZETA_EXACT termos são somados um a um; os demais, que
+ * variam devagar, são aproximados pela integral com correção do ponto médio
+ */
+static double bench_zeta(size_t n, double theta) {
+  size_t exact = n < BENCH_ZETA_EXACT ? n : BENCH_ZETA_EXACT;
+  double sum = 0;
+
+  for (size_t i = 1; i <= exact; i++)
+    sum += pow((double)i, -theta);
+
+  if (n > exact) {
+    double a = exact + 0.5, b = n + 0.5;
+    sum += (pow(b, 1 - theta) - pow(a, 1 - theta)) / (1 - theta);
+  }
+
+  return sum;
+}
+
+static void bench_zipf_init(bench_zipf_t *z, size_t n) {
+  double theta = BENCH_ZIPF_THETA;
+
+  z->n = n;
+  z->alpha = 1 / (1 - theta);
+  z->zetan = bench_zeta(n, theta);
+  z->half = 1 + pow(0.5, theta);
+  z->eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - bench_zeta(2, theta) / z->zetan);
+}
+
+/**
+ * @return Posição em [0, n), com 0 a mais provável
+ */
+static size_t bench_zipf_next(const bench_zipf_t *z, uint64_t *state) {
+  double u = bench_uniform(state);
+  double uz = u * z->zetan;
+
+  if (uz < 1)
+    return 0;
+  if (uz < z->half)
+    return 1;
+
+  size_t rank = z->n * pow(z->eta * u - z->eta + 1, z->alpha);
+
+  return rank < z->n ? rank : z->n - 1;
+}
+
+/**
+ * Espalha uma posição pelo espaço de chaves (FNV-1a), para que as chaves
+ * mais acessadas não fiquem vizinhas
+ */
+static uint64_t bench_scramble(uint64_t rank) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+
+  for (int i = 0; i < 8; i++) {
+    hash ^= (rank >> (8 * i)) & 0xff;
+    hash *= 0x100000001b3ull;
+  }
+
+  return hash;
+}
+
+/**
+ * Escolhe uma chave existente segundo a distribuição da execução
+ */
+static int bench_key(bench_thread_t *t) {
+  bench_run_t *run = t->run;
+  const bench_config_t *cfg = run->cfg;
+  size_t n = __atomic_load_n(&run->next_key, __ATOMIC_RELAXED);
+
+  switch (cfg->dist) {
+  case BENCH_UNIFORM:
+    return bench_rand(&t->rng) % n;
+  case BENCH_SEQUENTIAL:
+    return t->seq++ % n;
+  case BENCH_ZIPFIAN:
+    break;
+  }
+
+  size_t rank = bench_zipf_next(&run->zipf, &t->rng);
+
+  // Carga D: as chaves mais novas são as mais lidas
+  if (cfg->workload->latest)
+    return rank < n ? n - 1 - rank : 0;
+
+  return bench_scramble(rank) % n;
+}
+
+static bench_op_t bench_pick(bench_thread_t *t) {
+  const double *mix = t->run->cfg->workload->mix;
+  double u = bench_uniform(&t->rng);
+
+  for (int op = 0; op < BENCH_N_OPS; op++) {
+    if (u < mix[op])
+      return op;
+    u -= mix[op];
+  }
+
+  return BENCH_READ;
+}
+
+/**
+ * Executa uma operação
+ *
+ * @return BTREE_SUCCESS ou código de erro
+ */
+static int bench_op(bench_thread_t *t, bench_op_t op, btree_cursor_t *cur) {
+  btree_t *tree = t->run->tree;
+  int key, value;
+
+  switch (op) {
+  case BENCH_READ:
+    return btree_get(tree, bench_key(t), &value);
+  case BENCH_UPDATE:
+    return btree_insert(tree, bench_key(t), bench_rand(&t->rng) & 0x7fffffff);
+  case BENCH_INSERT:
+    key = __atomic_fetch_add(&t->run->next_key, 1, __ATOMIC_RELAXED);
+    return btree_insert(tree, key, key);
+  case BENCH_RMW: {
+    key = bench_key(t);
+    int result = btree_get(tree, key, &value);
+    return result == BTREE_SUCCESS ? btree_insert(tree, key, value + 1)
+                                   : result;
+  }
+  case BENCH_SCAN: {
+    size_t len = 1 + bench_rand(&t->rng) % BENCH_MAX_SCAN;
+    int result = btree_cursor_seek(cur, bench_key(t));
+
+    for (size_t i = 1; i < len && result == BTREE_SUCCESS; i++)
+      result = btree_cursor_next(cur);
+
+    // Chegar ao fim da árvore encerra a varredura antes
+    return result == BTREE_ERROR_NOT_FOUND ? BTREE_SUCCESS : result;
+  }
+  default:
+    return BTREE_ERROR_INVALID_PARAM;
+  }
+}
+
+static void *bench_worker(void *arg) {
+  bench_thread_t *t = arg;
+  bench_run_t *run = t->run;
+
+  size_t done[BENCH_N_OPS] = {0};
+  size_t errors = 0;
+
+  btree_cursor_t *cur = btree_cursor_open(run->tree);
+  if (!cur) {
+    __atomic_add_fetch(&run->errors, t->ops, __ATOMIC_RELAXED);
+    return NULL;
+  }
+
+  for (size_t i = 0; i < t->ops; i++) {
+    bench_op_t op = bench_pick(t);
+
+    if (bench_op(t, op, cur) != BTREE_SUCCESS)
+      errors++;
+    done[op]++;
+  }
+
+  btree_cursor_close(cur);
+
+  for (int op = 0; op < BENCH_N_OPS; op++)
+    __atomic_add_fetch(&run->done[op], done[op], __ATOMIC_RELAXED);
+  __atomic_add_fetch(&run->errors, errors, __ATOMIC_RELAXED);
+
+  return NULL;
+}
+
+/**
+ * Carrega os registros 0..n-1, com registro igual à chave
+ *
+ * Até BENCH_LOAD_CHUNK registros, a árvore é construída por
+ * btree_bulk_load(); o restante segue em lotes ordenados por
+ * btree_insert_batch()
+ *
+ * @return BTREE_SUCCESS ou código de erro
+ */
+static int bench_load(btree_t *tree, size_t n, double fill) {
+  size_t chunk = n < BENCH_LOAD_CHUNK ? n : BENCH_LOAD_CHUNK;
+  int *keys = malloc(chunk * sizeof(int));
+  if (!keys)
+    return BTREE_ERROR_ALLOC;
+
+  int result = BTREE_SUCCESS;
+
+  for (size_t start = 0; start < n && result == BTREE_SUCCESS;
+       start += chunk) {
+    size_t len = n - start < chunk ? n - start : chunk;
+    for (size_t i = 0; i < len; i++)
+      keys[i] = start + i;
+
+    result = start == 0 ? btree_bulk_load(tree, keys, keys, len, fill)
+                        : btree_insert_batch(tree, keys, keys, len);
+  }
+
+  free(keys);
+
+  return result == BTREE_SUCCESS ? btree_flush(tree) : result;
+}
+
+static size_t bench_pages(const size_t *pages) {
+  size_t sum = 0;
+
+  for (int l = 0; l < BTREE_STATS_LEVELS; l++)
+    sum += pages[l];
+
+  return sum;
+}
+
+/**
+ * Imprime vazão, páginas por operação e percentis de latência
+ */
+static void bench_report(const bench_config_t *cfg, const bench_run_t *run,
+                         double elapsed, const btree_stats_t *before,
+                         const btree_stats_t *after) {
+  size_t ops = cfg->ops;
+  double per_op = ops ? 1.0 / ops : 0;
+
+  printf("# carga %c, %s, ordem %zu, %zu registros, %zu operações, "
+         "%zu threads\n",
+         cfg->workload->name, dist_names[cfg->dist],
+         btree_order(run->tree), cfg->records, ops, cfg->threads);
+
+  printf("vazão      %.0f ops/s (%.3f s)\n", ops / elapsed, elapsed);
+
+  printf("operações ");
+  for (int op = 0; op < BENCH_N_OPS; op++)
+    if (run->done[op])
+      printf(" %s %zu", op_names[op], run->done[op]);
+  printf(", erros %zu\n", run->errors);
+
+  printf("páginas/op lidas %.3f, escritas %.3f, acertos no pool %.3f\n",
+         (bench_pages(after->page_reads) - bench_pages(before->page_reads)) *
+             per_op,
+         (bench_pages(after->page_writes) - bench_pages(before->page_writes)) *
+             per_op,
+         (after->cache_hits - before->cache_hits) * per_op);
+
+  printf("bytes/op   lidos %.0f, escritos %.0f, log %.0f\n",
+         (after->bytes_read - before->bytes_read) * per_op,
+         (after->bytes_written - before->bytes_written) * per_op,
+         (after->wal_bytes - before->wal_bytes) * per_op);
+
+  printf("%-8s %10s %10s %10s %10s %10s %10s\n", "op (ns)", "n", "media",
+         "p50", "p99", "p99.9", "max");
+
+  // A carga inicial fica no histograma de bulk, que não é mostrado
+  for (int op = 0; op < BTREE_N_OPS; op++) {
+    btree_latency_t lat;
+    if (op == BTREE_OP_BULK ||
+        btree_latency(run->tree, op, &lat) != BTREE_SUCCESS || lat.count == 0)
+      continue;
+
+    printf("%-8s %10zu %10.0f %10lu %10lu %10lu %10lu\n", btree_op_name(op),
+           lat.count, lat.mean, (unsigned long)lat.p50, (unsigned long)lat.p99,
+           (unsigned long)lat.p999, (unsigned long)lat.max);
+  }
+
+  printf("\n");
+}
+
+/**
+ * Remove o arquivo da árvore e o seu log
+ */
+static void bench_unlink(const char *filename) {
+  char wal[4096];
+  snprintf(wal, sizeof(wal), "%s-wal", filename);
+
+  unlink(filename);
+  unlink(wal);
+}
+
+/**
+ * Cria a árvore, carrega os registros e executa a carga
+ *
+ * @return BTREE_SUCCESS ou código de erro
+ */
+static int bench_execute(const bench_config_t *cfg) {
+  btree_t *tree =
+      btree_create_ex(cfg->order, cfg->filename, "w+b", &cfg->opts);
+  if (!tree) {
+    fprintf(stderr, "ordem %zu: erro ao criar %s\n", cfg->order,
+            cfg->filename);
+    return BTREE_ERROR_INVALID_PARAM;
+  }
+
+  int result = bench_load(tree, cfg->records, cfg->fill);
+  if (result != BTREE_SUCCESS) {
+    fprintf(stderr, "erro %d na carga de %zu registros\n", result,
+            cfg->records);
+    btree_destroy(tree);
+    bench_unlink(cfg->filename);
+    return result;
+  }
+
+  bench_run_t run = {.cfg = cfg, .tree = tree, .next_key = cfg->records};
+  if (cfg->dist == BENCH_ZIPFIAN)
+    bench_zipf_init(&run.zipf, cfg->records);
+
+  bench_thread_t *threads = calloc(cfg->threads, sizeof(bench_thread_t));
+  pthread_t *ids = calloc(cfg->threads, sizeof(pthread_t));
+  if (!threads || !ids) {
+    free(threads);
+    free(ids);
+    btree_destroy(tree);
+    bench_unlink(cfg->filename);
+    return BTREE_ERROR_ALLOC;
+  }
+
+  for (size_t i = 0; i < cfg->threads; i++) {
+    threads[i] = (bench_thread_t){&run, i, cfg->ops / cfg->threads,
+                                  cfg->seed * 0x9e3779b97f4a7c15ull + i + 1,
+                                  cfg->records / cfg->threads * i};
+    if (i < cfg->ops % cfg->threads)
+      threads[i].ops++;
+  }
+
+  btree_stats_t before, after;
+  btree_stats(tree, &before);
+
+  double start = bench_now();
+
+  size_t started = 0;
+  for (; started < cfg->threads; started++)
+    if (pthread_create(&ids[started], NULL, bench_worker,
+                       &threads[started]) != 0)
+      break;
+
+  for (size_t i = 0; i < started; i++)
+    pthread_join(ids[i], NULL);
+
+  double elapsed = bench_now() - start;
+
+  // As páginas alteradas pela execução também contam como escritas por ela
+  btree_flush(tree);
+  btree_stats(tree, &after);
+
+  if (started < cfg->threads)
+    fprintf(stderr, "apenas %zu threads criados\n", started);
+
+  bench_report(cfg, &run, elapsed, &before, &after);
+
+  free(threads);
+  free(ids);
+  btree_destroy(tree);
+  bench_unlink(cfg->filename);
+
+  return BTREE_SUCCESS;
+}
+
+/**
+ * Lê uma lista separada por vírgulas de quantidades, como "1e4,1e6", ou de
+ * ordens, em que "auto" é BTREE_ORDER_AUTO
+ *
+ * @return Quantidade de valores lidos ou 0 se a lista for inválida
+ */
+static size_t bench_parse_list(const char *arg, size_t *values) {
+  size_t n = 0;
+
+  while (*arg && n < BENCH_MAX_LIST) {
+    char *end;
+
+    if (strncmp(arg, "auto", 4) == 0) {
+      values[n++] = BTREE_ORDER_AUTO;
+      end = (char *)arg + 4;
+    } else {
+      double v = strtod(arg, &end);
+      if (end == arg || v < 0)
+        return 0;
+      values[n++] = v;
+    }
+
+    if (*end == ',')
+      end++;
+    else if (*end != '\0')
+      return 0;
+
+    arg = end;
+  }
+
+  return *arg ? 0 : n;
+}
+
+static void bench_usage(const char *prog) {
+  fprintf(stderr,
+          "uso: %s [-w A-F] [-d uniform|zipfian|sequential] [-n n,...] "
+          "[-O ordem,...|auto] [-o ops] [-t threads] [-p páginas] "
+          "[-l btree|bplus] [-b pread|mmap] [-u] [-W] [-F fill] [-s seed] "
+          "[-f arquivo]\n",
+          prog);
+}
+
+int main(int argc, char *argv[]) {
+  bench_config_t cfg = {
+      .workload = &workloads[0],
+      .dist = BENCH_ZIPFIAN,
+      .ops = 100000,
+      .threads = 1,
+      .fill = 1,
+      .seed = 1,
+      .filename = "ycsb.db",
+  };
+  btree_options_init(&cfg.opts);
+
+  size_t records[BENCH_MAX_LIST] = {100000}, n_records = 1;
+  size_t orders[BENCH_MAX_LIST] = {BTREE_ORDER_AUTO}, n_orders = 1;
+
+  int c;
+  while ((c = getopt(argc, argv, "w:d:n:O:o:t:p:l:b:uWF:s:f:h")) != -1) {
+    switch (c) {
+    case 'w':
+      cfg.workload = NULL;
+      for (size_t i = 0; i < sizeof(workloads) / sizeof(*workloads); i++)
+        if (workloads[i].name == (optarg[0] & ~0x20) && !optarg[1])
+          cfg.workload = &workloads[i];
+      if (!cfg.workload) {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'd':
+      if (strcmp(optarg, "uniform") == 0)
+        cfg.dist = BENCH_UNIFORM;
+      else if (strcmp(optarg, "zipfian") == 0)
+        cfg.dist = BENCH_ZIPFIAN;
+      else if (strcmp(optarg, "sequential") == 0)
+        cfg.dist = BENCH_SEQUENTIAL;
+      else {
+        bench_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'n':
+      n_records = bench_parse_list(optarg, records);
+      break;
+    case 'O':
+      n_orders = bench_parse_list(optarg, orders);
+      break;
+    case 'o':
+      cfg.ops = strtod(optarg, NULL);
+      break;
+    case 't':
+      cfg.threads = strtoul(optarg, NULL, 10);
+      break;
+    case 'p':
+      cfg.opts.pool_pages = strtoul(optarg, NULL, 10);
+      break;
+    case 'l':
+      cfg.opts.layout = strcmp(optarg, "bplus") == 0 ? BTREE_LAYOUT_BPLUS
+                                                     : BTREE_LAYOUT_BTREE;
+      break;
+    case 'b':
+      cfg.opts.backend = strcmp(optarg, "mmap") == 0 ? BTREE_BACKEND_MMAP
+                                                     : BTREE_BACKEND_PREAD;
+      break;
+    case 'u':
+      cfg.opts.io_engine = BTREE_IO_URING;
+      break;
+    case 'W':
+      cfg.opts.wal = true;
+      break;
+    case 'F':
+      cfg.fill = strtod(optarg, NULL);
+      break;
+    case 's':
+      cfg.seed = strtoull(optarg, NULL, 10);
+      break;
+    case 'f':
+      cfg.filename = optarg;
+      break;
+    default:
+      bench_usage(argv[0]);
+      return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  if (n_records == 0 || n_orders == 0 || cfg.threads == 0 ||
+      !(cfg.fill > 0 && cfg.fill <= 1)) {
+    bench_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  int status = EXIT_SUCCESS;
+
+  for (size_t i = 0; i < n_orders; i++) {
+    for (size_t j = 0; j < n_records; j++) {
+      cfg.order = orders[i];
+      cfg.records = records[j];
+
+      // As chaves são int: as inserções da execução também precisam caber
+      if (cfg.records == 0 || cfg.records + cfg.ops > INT32_MAX) {
+        fprintf(stderr, "%zu registros e %zu operações: fora do intervalo\n",
+                cfg.records, cfg.ops);
+        status = EXIT_FAILURE;
+        continue;
+      }
+
+      if (bench_execute(&cfg) != BTREE_SUCCESS)
+        status = EXIT_FAILURE;
+    }
+  }
+
+  return status;
+}
@@ -0,0 +1,632 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "bplus.h"
+#include "keys.h"
+
+/**
+ * Escolhe o filho de um nó interno por onde a busca continua
+ *
+ * Cada chave de um nó interno é a menor chave da subárvore à sua direita
+ *
+ * @return Quantidade de chaves menores ou iguais a key
+ */
+static int bplus_route(const node_t *node, int key) {
+  return keys_upper_bound(node->keys, node->n_keys, key);
+}
+
+/**
+ * @return Posição da primeira chave maior ou igual a key
+ */
+static int bplus_lower(const node_t *node, int key) {
+  return keys_lower_bound(node->keys, node->n_keys, key);
+}
+
+node_t *bplus_find_leaf(int root, int key, bpool_t *pool) {
+  if (!pool || root == -1)
+    return NULL;
+
+  node_t *node = bpool_pin_shared(pool, root);
+
+  // O filho é fixado antes de o pai ser liberado (latch coupling)
+  while (node && !node->is_leaf) {
+    node_t *child =
+        bpool_pin_shared(pool, node->children[bplus_route(node, key)]);
+    bpool_unpin(pool, node, false);
+    node = child;
+  }
+
+  return node;
+}
+
+node_t *bplus_search(int root, int key, int *pos, bpool_t *pool) {
+  if (!pos)
+    return NULL;
+
+  node_t *leaf = bplus_find_leaf(root, key, pool);
+  if (!leaf)
+    return NULL;
+
+  int i = bplus_lower(leaf, key);
+  if (i < (int)leaf->n_keys && leaf->keys[i] == key) {
+    *pos = i;
+    return leaf;
+  }
+
+  bpool_unpin(pool, leaf, false);
+
+  return NULL;
+}
+
+/**
+ * Divide um filho cheio em dois
+ *
+ * Uma folha é dividida ao meio e a primeira chave da nova folha é copiada
+ * para o pai; em um nó interno, a chave do meio sobe para o pai
+ *
+ * @param parent Pai fixado, com espaço para mais uma chave
+ * @param idx Posição do filho em parent
+ * @param child Filho fixado, cheio
+ * @param pool Buffer pool da árvore
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+static int bplus_split_child(node_t *parent, int idx, node_t *child,
+                             bpool_t *pool) {
+  node_t *right = bpool_new(pool, child->is_leaf);
+  if (!right)
+    return BTREE_ERROR_IO;
+
+  right->level = child->level;
+
+  int n = child->n_keys;
+  int mid = n / 2;
+  int sep;
+
+  if (child->is_leaf) {
+    int moved = n - mid;
+    memcpy(right->keys, child->keys + mid, moved * sizeof(int));
+    memcpy(right->values, child->values + mid, moved * sizeof(int));
+    right->n_keys = moved;
+    child->n_keys = mid;
+    sep = right->keys[0];
+
+    // A nova folha entra na lista entre child e a seguinte
+    int next_page = child->siblings[1];
+    if (next_page != -1) {
+      node_t *next = bpool_pin(pool, next_page);
+      if (!next) {
+        bpool_unpin(pool, right, true);
+        return BTREE_ERROR_IO;
+      }
+
+      next->siblings[0] = right->bin_pos;
+      bpool_unpin(pool, next, true);
+    }
+
+    right->siblings[0] = child->bin_pos;
+    right->siblings[1] = next_page;
+    child->siblings[1] = right->bin_pos;
+  } else {
+    int moved = n - mid - 1;
+    sep = child->keys[mid];
+    memcpy(right->keys, child->keys + mid + 1, moved * sizeof(int));
+    memcpy(right->children, child->children + mid + 1,
+           (moved + 1) * sizeof(int));
+    right->n_keys = moved;
+    child->n_keys = mid;
+  }
+
+  int pn = parent->n_keys;
+  memmove(parent->keys + idx + 1, parent->keys + idx, (pn - idx) * sizeof(int));
+  memmove(parent->children + idx + 2, parent->children + idx + 1,
+          (pn - idx) * sizeof(int));
+  parent->keys[idx] = sep;
+  parent->children[idx + 1] = right->bin_pos;
+  parent->n_keys++;
+  stats_add(bpool_counters(pool), STATS_SPLITS, 1);
+
+  bpool_unpin(pool, right, true);
+  bpool_mark_dirty(pool, parent);
+  bpool_mark_dirty(pool, child);
+
+  return BTREE_SUCCESS;
+}
+
+int bplus_grow_root(int *root, size_t order, bpool_t *pool) {
+  if (!root || !pool)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  // Árvore vazia: a raiz é uma folha
+  if (*root == -1) {
+    node_t *leaf = bpool_new(pool, true);
+    if (!leaf)
+      return BTREE_ERROR_IO;
+
+    *root = leaf->bin_pos;
+    bpool_unpin(pool, leaf, true);
+
+    return BTREE_SUCCESS;
+  }
+
+  node_t *node = bpool_pin(pool, *root);
+  if (!node)
+    return BTREE_ERROR_IO;
+
+  // Outro thread pode ter dividido a raiz antes
+  if (node->n_keys < order - 1) {
+    bpool_unpin(pool, node, false);
+    return BTREE_SUCCESS;
+  }
+
+  // Raiz cheia: a árvore cresce para cima
+  node_t *new_root = bpool_new(pool, false);
+  if (!new_root) {
+    bpool_unpin(pool, node, false);
+    return BTREE_ERROR_IO;
+  }
+
+  new_root->children[0] = node->bin_pos;
+  new_root->level = node->level + 1;
+
+  int result = bplus_split_child(new_root, 0, node, pool);
+  if (result == BTREE_SUCCESS) {
+    *root = new_root->bin_pos;
+    stats_add(bpool_counters(pool), STATS_ROOT_SPLITS, 1);
+  }
+
+  bpool_unpin(pool, node, false);
+  bpool_unpin(pool, new_root, result == BTREE_SUCCESS);
+
+  return result;
+}
+
+int bplus_insert(int *root, int key, int value, size_t order, bpool_t *pool,
+                 bool *replaced, int *old_value) {
+  if (!root || !pool || !replaced)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  *replaced = false;
+
+  if (*root == -1)
+    return NODE_ROOT_FULL;
+
+  node_t *node = bpool_pin(pool, *root);
+  if (!node)
+    return BTREE_ERROR_IO;
+
+  if (node->n_keys == order - 1) {
+    bpool_unpin(pool, node, false);
+    return NODE_ROOT_FULL;
+  }
+
+  while (!node->is_leaf) {
+    int i = bplus_route(node, key);
+    node_t *child = bpool_pin(pool, node->children[i]);
+    if (!child) {
+      bpool_unpin(pool, node, false);
+      return BTREE_ERROR_IO;
+    }
+
+    if (child->n_keys == order - 1) {
+      int result = bplus_split_child(node, i, child, pool);
+      if (result != BTREE_SUCCESS) {
+        bpool_unpin(pool, child, false);
+        bpool_unpin(pool, node, false);
+        return result;
+      }
+
+      // A chave pode pertencer à metade nova
+      if (key >= node->keys[i]) {
+        bpool_unpin(pool, child, false);
+        child = bpool_pin(pool, node->children[i + 1]);
+        if (!child) {
+          bpool_unpin(pool, node, false);
+          return BTREE_ERROR_IO;
+        }
+      }
+    }
+
+    bpool_unpin(pool, node, false);
+    node = child;
+  }
+
+  int i = bplus_lower(node, key);
+  int n = node->n_keys;
+
+  if (i < n && node->keys[i] == key) {
+    if (old_value)
+      *old_value = node->values[i];
+
+    node->values[i] = value;
+    *replaced = true;
+  } else {
+    memmove(node->keys + i + 1, node->keys + i, (n - i) * sizeof(int));
+    memmove(node->values + i + 1, node->values + i, (n - i) * sizeof(int));
+    node->keys[i] = key;
+    node->values[i] = value;
+    node->n_keys++;
+  }
+
+  bpool_unpin(pool, node, true);
+
+  return BTREE_SUCCESS;
+}
+
+int bplus_insert_run(int *root, const int *keys, const int *values, size_t n,
+                     size_t order, bpool_t *pool, size_t *added) {
+  if (!root || !keys || !values || n == 0 || !pool || !added)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  bool replaced;
+  *added = 0;
+
+  // Árvore vazia ou raiz cheia: a primeira chave segue o caminho normal
+  node_t *node = *root == -1 ? NULL : bpool_pin(pool, *root);
+  if (!node || node->n_keys == order - 1) {
+    if (node)
+      bpool_unpin(pool, node, false);
+    else if (*root != -1)
+      return BTREE_ERROR_IO;
+
+    int result =
+        bplus_insert(root, keys[0], values[0], order, pool, &replaced, NULL);
+    *added = !replaced;
+
+    return result == BTREE_SUCCESS ? 1 : result;
+  }
+
+  bool bounded = false;
+  int hi = 0;
+
+  while (!node->is_leaf) {
+    int i = bplus_route(node, keys[0]);
+    node_t *child = bpool_pin(pool, node->children[i]);
+    if (!child) {
+      bpool_unpin(pool, node, false);
+      return BTREE_ERROR_IO;
+    }
+
+    if (child->n_keys == order - 1) {
+      int result = bplus_split_child(node, i, child, pool);
+      if (result != BTREE_SUCCESS) {
+        bpool_unpin(pool, child, false);
+        bpool_unpin(pool, node, false);
+        return result;
+      }
+
+      if (keys[0] >= node->keys[i]) {
+        i++;
+        bpool_unpin(pool, child, false);
+        child = bpool_pin(pool, node->children[i]);
+        if (!child) {
+          bpool_unpin(pool, node, false);
+          return BTREE_ERROR_IO;
+        }
+      }
+    }
+
+    // O separador à direita do filho é a menor chave fora dele
+    if (i < (int)node->n_keys) {
+      hi = node->keys[i];
+      bounded = true;
+    }
+
+    bpool_unpin(pool, node, false);
+    node = child;
+  }
+
+  // A folha não está cheia: a primeira chave sempre cabe
+  size_t j = 0;
+  while (j < n && (j == 0 || (node->n_keys < order - 1 &&
+                              (!bounded || keys[j] < hi)))) {
+    int i = bplus_lower(node, keys[j]);
+    int m = node->n_keys;
+
+    if (i < m && node->keys[i] == keys[j]) {
+      node->values[i] = values[j];
+    } else {
+      memmove(node->keys + i + 1, node->keys + i, (m - i) * sizeof(int));
+      memmove(node->values + i + 1, node->values + i, (m - i) * sizeof(int));
+      node->keys[i] = keys[j];
+      node->values[i] = values[j];
+      node->n_keys++;
+      (*added)++;
+    }
+
+    j++;
+  }
+
+  bpool_unpin(pool, node, true);
+
+  return j;
+}
+
+/**
+ * Move a última chave do irmão esquerdo para o início do filho
+ */
+static void bplus_borrow_left(node_t *parent, int idx, node_t *left,
+                              node_t *child) {
+  int n = child->n_keys;
+
+  memmove(child->keys + 1, child->keys, n * sizeof(int));
+
+  if (child->is_leaf) {
+    memmove(child->values + 1, child->values, n * sizeof(int));
+    child->keys[0] = left->keys[left->n_keys - 1];
+    child->values[0] = left->values[left->n_keys - 1];
+    parent->keys[idx - 1] = child->keys[0];
+  } else {
+    memmove(child->children + 1, child->children, (n + 1) * sizeof(int));
+    child->keys[0] = parent->keys[idx - 1];
+    child->children[0] = left->children[left->n_keys];
+    parent->keys[idx - 1] = left->keys[left->n_keys - 1];
+  }
+
+  child->n_keys++;
+  left->n_keys--;
+}
+
+/**
+ * Move a primeira chave do irmão direito para o fim do filho
+ */
+static void bplus_borrow_right(node_t *parent, int idx, node_t *child,
+                               node_t *right) {
+  int n = child->n_keys;
+  int rn = right->n_keys;
+
+  if (child->is_leaf) {
+    child->keys[n] = right->keys[0];
+    child->values[n] = right->values[0];
+    memmove(right->keys, right->keys + 1, (rn - 1) * sizeof(int));
+    memmove(right->values, right->values + 1, (rn - 1) * sizeof(int));
+    parent->keys[idx] = right->keys[0];
+  } else {
+    child->keys[n] = parent->keys[idx];
+    child->children[n + 1] = right->children[0];
+    parent->keys[idx] = right->keys[0];
+    memmove(right->keys, right->keys + 1, (rn - 1) * sizeof(int));
+    memmove(right->children, right->children + 1, rn * sizeof(int));
+  }
+
+  child->n_keys++;
+  right->n_keys--;
+}
+
+/**
+ * Junta o filho idx + 1 ao filho idx e libera a página do primeiro
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+static int bplus_merge(node_t *parent, int idx, node_t *left, node_t *right,
+                       bpool_t *pool) {
+  int n = left->n_keys;
+  int rn = right->n_keys;
+
+  if (left->is_leaf) {
+    // Retira a folha da direita da lista antes de alterar qualquer nó
+    int next_page = right->siblings[1];
+    if (next_page != -1) {
+      node_t *next = bpool_pin(pool, next_page);
+      if (!next)
+        return BTREE_ERROR_IO;
+
+      next->siblings[0] = left->bin_pos;
+      bpool_unpin(pool, next, true);
+    }
+
+    memcpy(left->keys + n, right->keys, rn * sizeof(int));
+    memcpy(left->values + n, right->values, rn * sizeof(int));
+    left->n_keys = n + rn;
+    left->siblings[1] = next_page;
+  } else {
+    left->keys[n] = parent->keys[idx];
+    memcpy(left->keys + n + 1, right->keys, rn * sizeof(int));
+    memcpy(left->children + n + 1, right->children, (rn + 1) * sizeof(int));
+    left->n_keys = n + 1 + rn;
+  }
+
+  int pn = parent->n_keys;
+  memmove(parent->keys + idx, parent->keys + idx + 1,
+          (pn - idx - 1) * sizeof(int));
+  memmove(parent->children + idx + 1, parent->children + idx + 2,
+          (pn - idx - 1) * sizeof(int));
+  parent->n_keys--;
+  stats_add(bpool_counters(pool), STATS_MERGES, 1);
+
+  bpool_mark_dirty(pool, parent);
+  bpool_mark_dirty(pool, left);
+  bpool_free(pool, right);
+
+  return BTREE_SUCCESS;
+}
+
+/**
+ * Fixa o filho idx garantindo que ele tenha mais que min chaves, com
+ * empréstimo de um irmão ou mescla
+ *
+ * @param parent Pai fixado
+ * @param idx Posição do filho em parent
+ * @param min Quantidade mínima de chaves de um nó
+ * @param pool Buffer pool da árvore
+ *
+ * @return Filho fixado onde a busca continua ou NULL em caso de erro
+ */
+static node_t *bplus_ensure_child(node_t *parent, int idx, int min,
+                                  bpool_t *pool) {
+  node_t *child = bpool_pin(pool, parent->children[idx]);
+  if (!child || (int)child->n_keys > min || parent->n_keys == 0)
+    return child;
+
+  bool has_left = idx > 0;
+  bool has_right = idx < (int)parent->n_keys;
+  node_t *left = has_left ? bpool_pin(pool, parent->children[idx - 1]) : NULL;
+  node_t *right =
+      has_right ? bpool_pin(pool, parent->children[idx + 1]) : NULL;
+
+  if ((has_left && !left) || (has_right && !right)) {
+    bpool_unpin(pool, left, false);
+    bpool_unpin(pool, right, false);
+    bpool_unpin(pool, child, false);
+    return NULL;
+  }
+
+  if (left && (int)left->n_keys > min) {
+    bplus_borrow_left(parent, idx, left, child);
+    stats_add(bpool_counters(pool), STATS_BORROWS_LEFT, 1);
+    bpool_unpin(pool, left, true);
+    bpool_unpin(pool, right, false);
+  } else if (right && (int)right->n_keys > min &&
+             (!right->is_leaf || right->n_keys > 1)) {
+    // Uma folha que ficasse vazia não teria chave para o separador
+    bplus_borrow_right(parent, idx, child, right);
+    stats_add(bpool_counters(pool), STATS_BORROWS_RIGHT, 1);
+    bpool_unpin(pool, left, false);
+    bpool_unpin(pool, right, true);
+  } else {
+    // Mescla com o irmão direito ou, na falta dele, com o esquerdo
+    node_t *l = right ? child : left;
+    node_t *r = right ? right : child;
+    bpool_unpin(pool, right ? left : NULL, false);
+
+    if (bplus_merge(parent, right ? idx : idx - 1, l, r, pool) !=
+        BTREE_SUCCESS) {
+      bpool_unpin(pool, l, false);
+      bpool_unpin(pool, r, false);
+      return NULL;
+    }
+
+    return l;
+  }
+
+  bpool_mark_dirty(pool, parent);
+  bpool_mark_dirty(pool, child);
+
+  return child;
+}
+
+int bplus_remove(int root, int key, size_t order, bpool_t *pool) {
+  if (!pool || root == -1)
+    return BTREE_ERROR_NOT_FOUND;
+
+  int min = node_min_degree(order) - 1;
+
+  node_t *node = bpool_pin(pool, root);
+  if (!node)
+    return BTREE_ERROR_IO;
+
+  while (!node->is_leaf) {
+    node_t *child = bplus_ensure_child(node, bplus_route(node, key), min, pool);
+    bpool_unpin(pool, node, false);
+    if (!child)
+      return BTREE_ERROR_IO;
+
+    node = child;
+  }
+
+  int i = bplus_lower(node, key);
+  int n = node->n_keys;
+
+  if (i == n || node->keys[i] != key) {
+    bpool_unpin(pool, node, false);
+    return BTREE_ERROR_NOT_FOUND;
+  }
+
+  memmove(node->keys + i, node->keys + i + 1, (n - i - 1) * sizeof(int));
+  memmove(node->values + i, node->values + i + 1, (n - i - 1) * sizeof(int));
+  node->n_keys--;
+
+  bpool_unpin(pool, node, true);
+
+  return BTREE_SUCCESS;
+}
+
+int bplus_bulk_level(bpool_t *pool, size_t order, int *keys, const int *values,
+                     const int *children, int *pages, size_t *m, size_t fill,
+                     unsigned level) {
+  bool leaves = children == NULL;
+  size_t n = *m;
+  size_t k;
+
+  // Folhas guardam todas as chaves; nos níveis internos, cada nó consome
+  // também um separador
+  if (leaves) {
+    size_t k_cap = (n + order - 2) / (order - 1);
+    k = n / fill;
+    if (k < k_cap)
+      k = k_cap;
+  } else {
+    size_t k_cap = (n + order) / order;
+    k = (n + 1) / (fill + 1);
+    if (k < k_cap)
+      k = k_cap;
+  }
+
+  if (k == 0)
+    k = 1;
+
+  size_t total = leaves ? n : n - (k - 1);
+  size_t base = total / k;
+  size_t extra = total % k;
+  size_t pos = 0, child = 0;
+  node_t *prev = NULL;
+
+  for (size_t j = 0; j < k; j++) {
+    size_t size = base + (j < extra);
+    if (size > order - 1) {
+      if (prev)
+        bpool_unpin(pool, prev, true);
+      return BTREE_ERROR_INVALID_PARAM;
+    }
+
+    node_t *node = bpool_new(pool, leaves);
+    if (!node) {
+      if (prev)
+        bpool_unpin(pool, prev, true);
+      return BTREE_ERROR_IO;
+    }
+
+    node->level = level;
+
+    memcpy(node->keys, keys + pos, size * sizeof(int));
+    node->n_keys = size;
+
+    if (leaves) {
+      memcpy(node->values, values + pos, size * sizeof(int));
+
+      // A primeira chave de cada folha, exceto a primeira, vai para cima
+      if (j > 0)
+        keys[j - 1] = keys[pos];
+
+      // Encadeia com a folha anterior, que ficou fixada até aqui
+      if (prev) {
+        prev->siblings[1] = node->bin_pos;
+        node->siblings[0] = prev->bin_pos;
+        bpool_unpin(pool, prev, true);
+      }
+
+      pos += size;
+      pages[j] = node->bin_pos;
+      prev = node;
+      continue;
+    }
+
+    memcpy(node->children, children + child, (size + 1) * sizeof(int));
+    pos += size;
+    child += size + 1;
+
+    if (j + 1 < k)
+      keys[j] = keys[pos++];
+
+    pages[j] = node->bin_pos;
+    bpool_unpin(pool, node, true);
+  }
+
+  if (prev)
+    bpool_unpin(pool, prev, true);
+
+  *m = k - 1;
+
+  return (int)k;
+}
@@ -0,0 +1,126 @@
+#ifndef BPLUS_H
+#define BPLUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "bpool.h"
+#include "btree.h"
+#include "node.h"
+
+/**
+ * Desce da raiz até a folha onde a chave está ou estaria
+ *
+ * @param root Página da raiz
+ * @param key Chave procurada
+ * @param pool Buffer pool da árvore
+ *
+ * @return Folha fixada no pool com o latch compartilhado ou NULL em caso de
+ * erro
+ */
+node_t *bplus_find_leaf(int root, int key, bpool_t *pool);
+
+/**
+ * Busca uma chave na árvore B+
+ *
+ * @param root Página da raiz
+ * @param key Chave procurada
+ * @param pos Ponteiro para armazenar a posição da chave na folha
+ * @param pool Buffer pool da árvore
+ *
+ * @return Folha fixada no pool que contém a chave ou NULL se não encontrada
+ */
+node_t *bplus_search(int root, int key, int *pos, bpool_t *pool);
+
+/**
+ * Cria a raiz de uma árvore B+ vazia ou divide a raiz cheia
+ *
+ * Chamada com o latch exclusivo da árvore quando uma inserção devolve
+ * NODE_ROOT_FULL; se outro thread já tiver dividido a raiz, nada é feito
+ *
+ * @param root Ponteiro para a página da raiz (-1 se a árvore estiver vazia)
+ * @param order Ordem da árvore
+ * @param pool Buffer pool da árvore
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int bplus_grow_root(int *root, size_t order, bpool_t *pool);
+
+/**
+ * Insere uma chave na árvore B+, dividindo nós cheios durante a descida
+ *
+ * Se a árvore estiver vazia ou a raiz estiver cheia, nada é alterado e
+ * NODE_ROOT_FULL é devolvido
+ *
+ * @param root Ponteiro para a página da raiz (-1 se a árvore estiver vazia)
+ * @param key Chave a ser inserida
+ * @param value Registro associado à chave
+ * @param order Ordem da árvore
+ * @param pool Buffer pool da árvore
+ * @param replaced Ponteiro para flag indicando se a chave já existia e apenas
+ * teve o registro substituído
+ * @param old_value Ponteiro para o registro anterior (pode ser NULL)
+ *
+ * @return BTREE_SUCCESS em caso de sucesso, NODE_ROOT_FULL ou código de erro
+ */
+int bplus_insert(int *root, int key, int value, size_t order, bpool_t *pool,
+                 bool *replaced, int *old_value);
+
+/**
+ * Insere ou atualiza uma sequência ordenada de chaves, começando pela primeira
+ *
+ * A descida segue a primeira chave; na folha, as chaves seguintes também são
+ * aplicadas enquanto houver espaço e elas forem menores que o separador que
+ * limita a folha à direita
+ *
+ * @param root Ponteiro para a página da raiz (-1 se a árvore estiver vazia)
+ * @param keys Chaves em ordem crescente, sem repetição
+ * @param values Registros associados às chaves
+ * @param n Quantidade de chaves (pelo menos uma)
+ * @param order Ordem da árvore
+ * @param pool Buffer pool da árvore
+ * @param added Ponteiro para a quantidade de chaves novas
+ *
+ * @return Quantidade de chaves aplicadas, NODE_ROOT_FULL ou código de erro
+ */
+int bplus_insert_run(int *root, const int *keys, const int *values, size_t n,
+                     size_t order, bpool_t *pool, size_t *added);
+
+/**
+ * Remove uma chave da árvore B+, garantindo durante a descida que cada filho
+ * visitado tenha mais chaves que o mínimo
+ *
+ * A raiz pode ficar sem chaves; cabe ao chamador substituí-la pelo único filho
+ *
+ * @param root Página da raiz
+ * @param key Chave a ser removida
+ * @param order Ordem da árvore
+ * @param pool Buffer pool da árvore
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_NOT_FOUND ou código de erro
+ */
+int bplus_remove(int root, int key, size_t order, bpool_t *pool);
+
+/**
+ * Constrói um nível da árvore B+ a partir de uma sequência ordenada
+ *
+ * Nas folhas, a primeira chave de cada folha exceto a primeira é copiada para
+ * o nível de cima; nos nós internos, a chave entre dois nós sobe
+ *
+ * @param pool Buffer pool da árvore
+ * @param order Ordem da árvore
+ * @param keys Chaves do nível; recebem as chaves do nível de cima
+ * @param values Registros das folhas ou NULL nos níveis internos
+ * @param children Páginas dos filhos (m + 1) ou NULL para as folhas
+ * @param pages Recebe as páginas dos nós criados (pode ser o próprio children)
+ * @param m Quantidade de chaves do nível; recebe a do nível de cima
+ * @param fill Chaves por nó desejadas
+ * @param level Altura dos nós do nível, 0 nas folhas
+ *
+ * @return Quantidade de nós criados ou código de erro
+ */
+int bplus_bulk_level(bpool_t *pool, size_t order, int *keys, const int *values,
+                     const int *children, int *pages, size_t *m, size_t fill,
+                     unsigned level);
+
+#endif // !BPLUS_H
@@ -0,0 +1,1238 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bpool.h"
+#include "node.h"
+#include "stats.h"
+#include "wal.h"
+
+typedef struct bpool_frame {
+  node_t *node;       // Nó carregado no frame
+  int page;           // Página carregada no frame ou -1 se livre
+  int next;           // Próximo frame no mesmo bucket ou -1
+  unsigned pin_count; // Quantidade de usuários fixando o frame
+  bool dirty;         // Flag indicando se o nó difere do arquivo
+  bool referenced;    // Bit de referência usado pelo algoritmo clock
+  bool in_txn;        // Flag indicando alteração ainda fora do log de redo
+  bool loading;       // Flag indicando leitura do arquivo em andamento
+  int64_t lsn;        // LSN do último registro com a imagem da página
+} bpool_frame_t;
+
+struct bpool {
+  storage_t *st; // Arquivo binário
+  size_t order;  // Ordem da árvore
+  bool bplus;    // Flag indicando o formato B+
+
+  const node_kernels_t *kernels; // Kernels especializados para a ordem
+
+  node_slab_t *slab;      // Alocador dos nós dos frames
+  bpool_frame_t *frames; // Frames do pool
+  size_t n_frames;       // Quantidade de frames
+  size_t clock_hand;     // Próximo frame candidato à remoção
+
+  int *buckets;     // Tabela hash página -> frame
+  size_t n_buckets; // Quantidade de buckets (potência de 2)
+
+  size_t n_pages; // Quantidade de páginas alocadas no arquivo
+  int free_head;  // Primeira página livre ou -1
+  size_t n_free;  // Quantidade de páginas livres
+  char *header;   // Página do superbloco
+
+  wal_t *wal;    // Log de redo ou NULL
+  int *txn;      // Frames alterados pela operação em andamento
+  size_t n_txn;  // Quantidade de frames em txn
+  bool unlogged; // Flag indicando registro no log suspenso
+
+  btree_cache_stats_t stats; // Contadores de acesso
+  stats_t *counters;         // Contadores de operações e de E/S da árvore
+
+  // Protege os frames, a tabela hash, a lista de páginas livres, a operação
+  // em andamento e os contadores; o conteúdo dos nós é protegido pelos latches
+  pthread_mutex_t lock;
+  pthread_cond_t loaded; // Sinalizada quando um frame termina de ser lido
+};
+
+/**
+ * Marca o início de uma alteração do nó para as leituras otimistas
+ *
+ * Só quem tem o nó só para si altera a versão: o dono do latch exclusivo ou,
+ * com o lock do pool, quem troca a página de um frame que ninguém fixou
+ */
+static void bpool_version_begin(node_t *node) {
+  __atomic_store_n(&node->version, node->version + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void bpool_version_end(node_t *node) {
+  __atomic_store_n(&node->version, node->version + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Marca o fim da posse exclusiva do nó
+ *
+ * As descidas com latches fixam com exclusividade nós que na maioria das
+ * vezes não alteram; sem alteração, a versão volta ao valor de antes do
+ * latch e as leituras otimistas que passaram pelo nó continuam válidas
+ */
+static void bpool_version_release(node_t *node) {
+  uint64_t v = node->version;
+  __atomic_store_n(&node->version, node->modified ? v + 1 : v - 1,
+                   __ATOMIC_RELEASE);
+}
+
+/**
+ * Obtém o latch de um nó fixado
+ *
+ * O latch exclusivo pode ser pedido de novo pelo thread que já o possui, como
+ * quando uma operação fixa outra vez um nó que ainda mantém fixado
+ */
+static void bpool_latch(node_t *node, bool exclusive) {
+  if (!exclusive) {
+    pthread_rwlock_rdlock(&node->latch);
+    return;
+  }
+
+  // Só o próprio thread grava seu identificador em owner
+  pthread_t self = pthread_self();
+  if (pthread_equal(__atomic_load_n(&node->owner, __ATOMIC_RELAXED), self)) {
+    node->depth++;
+    return;
+  }
+
+  pthread_rwlock_wrlock(&node->latch);
+  __atomic_store_n(&node->owner, self, __ATOMIC_RELAXED);
+  node->depth = 1;
+  node->modified = false;
+  bpool_version_begin(node);
+}
+
+/**
+ * Obtém o latch exclusivo de um nó fixado somente se ele estiver livre
+ *
+ * @return true se o latch foi obtido
+ */
+static bool bpool_try_latch(node_t *node) {
+  pthread_t self = pthread_self();
+  if (pthread_equal(__atomic_load_n(&node->owner, __ATOMIC_RELAXED), self)) {
+    node->depth++;
+    return true;
+  }
+
+  if (pthread_rwlock_trywrlock(&node->latch) != 0)
+    return false;
+
+  __atomic_store_n(&node->owner, self, __ATOMIC_RELAXED);
+  node->depth = 1;
+  node->modified = false;
+  bpool_version_begin(node);
+
+  return true;
+}
+
+static void bpool_unlatch(node_t *node) {
+  pthread_t owner = __atomic_load_n(&node->owner, __ATOMIC_RELAXED);
+
+  if (pthread_equal(owner, pthread_self())) {
+    if (--node->depth > 0)
+      return;
+
+    __atomic_store_n(&node->owner, (pthread_t)0, __ATOMIC_RELAXED);
+  }
+
+  pthread_rwlock_unlock(&node->latch);
+}
+
+static size_t bpool_hash(const bpool_t *pool, int page) {
+  return ((size_t)page * 2654435761u) & (pool->n_buckets - 1);
+}
+
+/**
+ * Procura o frame que contém uma página
+ *
+ * @return Índice do frame ou -1 se a página não estiver no pool
+ */
+static int bpool_lookup(const bpool_t *pool, int page) {
+  int f = pool->buckets[bpool_hash(pool, page)];
+
+  while (f != -1 && pool->frames[f].page != page)
+    f = pool->frames[f].next;
+
+  return f;
+}
+
+static void bpool_attach(bpool_t *pool, int f, int page) {
+  size_t b = bpool_hash(pool, page);
+
+  pool->frames[f].page = page;
+  pool->frames[f].next = pool->buckets[b];
+  pool->buckets[b] = f;
+}
+
+static void bpool_detach(bpool_t *pool, int f) {
+  int *link = &pool->buckets[bpool_hash(pool, pool->frames[f].page)];
+
+  while (*link != f)
+    link = &pool->frames[*link].next;
+
+  *link = pool->frames[f].next;
+  pool->frames[f].page = -1;
+  pool->frames[f].next = -1;
+}
+
+/**
+ * Marca o frame como sujo e, com o log de redo, como parte da operação em
+ * andamento
+ */
+static void bpool_dirty(bpool_t *pool, int f) {
+  bpool_frame_t *frame = &pool->frames[f];
+  frame->dirty = true;
+
+  if (pool->wal && !pool->unlogged && !frame->in_txn) {
+    frame->in_txn = true;
+    pool->txn[pool->n_txn++] = f;
+  }
+}
+
+static int bpool_write_header(bpool_t *pool) {
+  disk_superblock_t *sb = bpool_superblock(pool);
+  sb->n_pages = pool->n_pages;
+  sb->free_head = pool->free_head;
+  sb->n_free = pool->n_free;
+
+  return storage_write_page(pool->st, DISK_HEADER_PAGE, pool->header);
+}
+
+/**
+ * Escreve o frame no arquivo, caso esteja sujo
+ */
+static int bpool_write_back(bpool_t *pool, int f) {
+  bpool_frame_t *frame = &pool->frames[f];
+
+  if (frame->page == -1 || !frame->dirty)
+    return BTREE_SUCCESS;
+
+  // O registro com a imagem da página precisa chegar ao log antes dela
+  if (pool->wal && wal_sync(pool->wal, frame->lsn) != BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
+
+  if (disk_write(pool->st, frame->node, pool->order) < 0)
+    return BTREE_ERROR_IO;
+
+  frame->dirty = false;
+  pool->stats.writebacks++;
+  stats_page(pool->counters, frame->node->level, true);
+
+  return BTREE_SUCCESS;
+}
+
+// Página de um frame, para ordenar lotes de leitura e escrita
+typedef struct bpool_page_ref {
+  int page; // Página no arquivo
+  int f;    // Frame que a contém
+} bpool_page_ref_t;
+
+static int bpool_page_ref_cmp(const void *a, const void *b) {
+  int pa = ((const bpool_page_ref_t *)a)->page;
+  int pb = ((const bpool_page_ref_t *)b)->page;
+
+  return (pa > pb) - (pa < pb);
+}
+
+/**
+ * Agrupa páginas ordenadas em transferências de páginas consecutivas
+ *
+ * @param refs Páginas, em ordem crescente
+ * @param n Quantidade de páginas
+ * @param bufs Buffer de cada página, na ordem de refs
+ * @param ios Recebe as transferências (n posições)
+ *
+ * @return Quantidade de transferências
+ */
+static size_t bpool_runs(const bpool_page_ref_t *refs, size_t n, void **bufs,
+                         storage_io_t *ios) {
+  size_t n_ios = 0;
+
+  for (size_t i = 0; i < n;) {
+    size_t run = 1;
+
+    while (i + run < n && run < STORAGE_MAX_RUN &&
+           refs[i + run].page == refs[i].page + (int)run)
+      run++;
+
+    ios[n_ios++] = (storage_io_t){refs[i].page, run, bufs + i};
+    i += run;
+  }
+
+  return n_ios;
+}
+
+/**
+ * Escreve no arquivo, em ordem de página, os frames sujos que não pertencem à
+ * operação em andamento
+ *
+ * Páginas consecutivas, como as que uma divisão ou a carga em lote acrescenta
+ * ao fim do arquivo, seguem juntas em uma única escrita vetorizada, e todas as
+ * escritas vão juntas para storage_write_batch()
+ *
+ * @param pool Ponteiro para o pool
+ * @param unpinned Flag indicando que só frames não fixados são escritos, pois
+ * os demais podem estar sendo alterados
+ */
+static int bpool_write_dirty(bpool_t *pool, bool unpinned) {
+  size_t n_frames = pool->n_frames;
+  bpool_page_ref_t *refs = malloc(n_frames * sizeof(*refs));
+  void **bufs = malloc(n_frames * sizeof(*bufs));
+  storage_io_t *ios = malloc(n_frames * sizeof(*ios));
+
+  // Sem memória para ordenar, cada página é escrita separadamente
+  if (!refs || !bufs || !ios) {
+    free(refs);
+    free(bufs);
+    free(ios);
+
+    for (size_t f = 0; f < n_frames; f++)
+      if ((!unpinned || pool->frames[f].pin_count == 0) &&
+          !pool->frames[f].in_txn && bpool_write_back(pool, f) != BTREE_SUCCESS)
+        return BTREE_ERROR_IO;
+
+    return BTREE_SUCCESS;
+  }
+
+  size_t n = 0;
+  int64_t lsn = 0;
+
+  for (size_t f = 0; f < n_frames; f++) {
+    bpool_frame_t *frame = &pool->frames[f];
+    if (frame->page == -1 || !frame->dirty || frame->in_txn ||
+        (unpinned && frame->pin_count > 0))
+      continue;
+
+    refs[n].page = frame->page;
+    refs[n].f = f;
+    n++;
+
+    if (frame->lsn > lsn)
+      lsn = frame->lsn;
+  }
+
+  int result = BTREE_SUCCESS;
+
+  // Um único wal_sync cobre os registros de todas as páginas
+  if (n > 0 && pool->wal && wal_sync(pool->wal, lsn) != BTREE_SUCCESS)
+    result = BTREE_ERROR_IO;
+
+  if (n > 0 && result == BTREE_SUCCESS) {
+    qsort(refs, n, sizeof(*refs), bpool_page_ref_cmp);
+
+    for (size_t i = 0; i < n; i++) {
+      node_t *node = pool->frames[refs[i].f].node;
+      node_pack(node);
+      bufs[i] = node->page;
+    }
+
+    size_t n_ios = bpool_runs(refs, n, bufs, ios);
+    if (storage_write_batch(pool->st, ios, n_ios) != BTREE_SUCCESS)
+      result = BTREE_ERROR_IO;
+  }
+
+  if (result == BTREE_SUCCESS) {
+    for (size_t i = 0; i < n; i++) {
+      bpool_frame_t *frame = &pool->frames[refs[i].f];
+      frame->dirty = false;
+      stats_page(pool->counters, frame->node->level, true);
+    }
+
+    pool->stats.writebacks += n;
+  }
+
+  free(refs);
+  free(bufs);
+  free(ios);
+
+  return result;
+}
+
+/**
+ * Dobra a quantidade de frames do pool
+ *
+ * Usado apenas com o log de redo, quando todos os frames livres guardam
+ * alterações da operação em andamento, que não podem chegar ao arquivo antes
+ * do registro correspondente
+ *
+ * @return Índice do primeiro frame novo ou -1 em caso de erro
+ */
+static int bpool_grow(bpool_t *pool) {
+  size_t old_n = pool->n_frames;
+  size_t new_n = 2 * old_n;
+
+  bpool_frame_t *frames = realloc(pool->frames, new_n * sizeof(bpool_frame_t));
+  if (!frames)
+    return -1;
+  pool->frames = frames;
+
+  int *txn = realloc(pool->txn, new_n * sizeof(int));
+  if (!txn)
+    return -1;
+  pool->txn = txn;
+
+  size_t n_buckets = pool->n_buckets;
+  while (n_buckets < 2 * new_n)
+    n_buckets <<= 1;
+
+  int *buckets = realloc(pool->buckets, n_buckets * sizeof(int));
+  if (!buckets)
+    return -1;
+  pool->buckets = buckets;
+
+  // Os nós novos vêm de um único bloco
+  if (node_slab_reserve(pool->slab, new_n - old_n) != BTREE_SUCCESS)
+    return -1;
+
+  for (size_t f = old_n; f < new_n; f++) {
+    memset(&frames[f], 0, sizeof(bpool_frame_t));
+    frames[f].page = -1;
+    frames[f].next = -1;
+    frames[f].node = node_slab_alloc(pool->slab, false, 0);
+  }
+
+  pool->n_frames = new_n;
+  pool->stats.pool_pages = new_n;
+
+  // Refaz a tabela hash com a nova quantidade de buckets
+  pool->n_buckets = n_buckets;
+  for (size_t b = 0; b < n_buckets; b++)
+    buckets[b] = -1;
+
+  for (size_t f = 0; f < old_n; f++) {
+    int page = frames[f].page;
+    if (page != -1)
+      bpool_attach(pool, f, page);
+  }
+
+  return old_n;
+}
+
+/**
+ * Escolhe um frame livre, removendo do pool a página menos usada recentemente
+ * segundo o algoritmo clock
+ *
+ * @return Índice do frame ou -1 se todos os frames estiverem fixados
+ */
+static int bpool_victim(bpool_t *pool) {
+  // Duas voltas bastam: na primeira os bits de referência são zerados
+  for (size_t n = 0; n < 2 * pool->n_frames; n++) {
+    int f = pool->clock_hand;
+    bpool_frame_t *frame = &pool->frames[f];
+    pool->clock_hand = (pool->clock_hand + 1) % pool->n_frames;
+
+    if (frame->pin_count > 0 || frame->in_txn)
+      continue;
+
+    if (frame->page == -1)
+      return f;
+
+    if (frame->referenced) {
+      frame->referenced = false;
+      continue;
+    }
+
+    // Com várias escritas em andamento, as demais páginas sujas seguem no
+    // mesmo lote, e as próximas remoções encontram frames limpos
+    if (frame->dirty && storage_io_engine(pool->st) == BTREE_IO_URING &&
+        bpool_write_dirty(pool, true) != BTREE_SUCCESS)
+      return -1;
+
+    if (bpool_write_back(pool, f) != BTREE_SUCCESS)
+      return -1;
+
+    bpool_detach(pool, f);
+    pool->stats.evictions++;
+    return f;
+  }
+
+  return pool->n_txn > 0 ? bpool_grow(pool) : -1;
+}
+
+/**
+ * Libera a memória do pool sem escrever nada no arquivo
+ */
+static void bpool_release(bpool_t *pool) {
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->loaded);
+  node_slab_destroy(pool->slab);
+  free(pool->frames);
+  free(pool->buckets);
+  free(pool->header);
+  free(pool->txn);
+  free(pool);
+}
+
+/**
+ * Reaplica um registro do log de redo no arquivo binário
+ */
+static int bpool_redo(void *ctx, const disk_superblock_t *sb, size_t n_pages,
+                      const int32_t *pages, const char *images) {
+  bpool_t *pool = ctx;
+  size_t page_size = storage_page_size(pool->st);
+
+  const void *bufs[STORAGE_MAX_RUN];
+
+  // Páginas consecutivas do registro seguem em uma única escrita
+  for (size_t i = 0; i < n_pages;) {
+    size_t run = 0;
+
+    while (i + run < n_pages && run < STORAGE_MAX_RUN &&
+           pages[i + run] == pages[i] + (int32_t)run) {
+      bufs[run] = images + (i + run) * page_size;
+      run++;
+    }
+
+    if (storage_write_pages(pool->st, pages[i], bufs, run) != BTREE_SUCCESS)
+      return BTREE_ERROR_IO;
+
+    for (size_t k = 0; k < run; k++)
+      stats_page(pool->counters,
+                 ((const disk_node_header_t *)bufs[k])->level, true);
+
+    i += run;
+  }
+
+  disk_superblock_t *header = bpool_superblock(pool);
+  header->n_keys = sb->n_keys;
+  header->root = sb->root;
+
+  pool->n_pages = sb->n_pages;
+  pool->free_head = sb->free_head;
+  pool->n_free = sb->n_free;
+
+  return BTREE_SUCCESS;
+}
+
+/**
+ * Leva ao arquivo binário as operações registradas no log após o último
+ * checkpoint e esvazia o log
+ */
+static int bpool_recover(bpool_t *pool) {
+  int applied = wal_replay(pool->wal, bpool_redo, pool);
+  if (applied < 0)
+    return applied;
+
+  if (applied > 0) {
+    int sync = wal_durability(pool->wal) == BTREE_DURABILITY_FDATASYNC;
+
+    if (bpool_write_header(pool) != BTREE_SUCCESS ||
+        (sync ? storage_sync(pool->st) : storage_flush(pool->st)) !=
+            BTREE_SUCCESS)
+      return BTREE_ERROR_IO;
+  }
+
+  return wal_truncate(pool->wal);
+}
+
+bpool_t *bpool_create(storage_t *st, wal_t *wal, size_t order,
+                      btree_layout_t layout, const node_kernels_t *kernels,
+                      size_t n_frames, stats_t *counters) {
+  if (!st || !kernels || order < 3)
+    return NULL;
+
+  if (n_frames < BPOOL_MIN_FRAMES)
+    n_frames = BPOOL_MIN_FRAMES;
+
+  bpool_t *pool = calloc(1, sizeof(bpool_t));
+  if (!pool)
+    return NULL;
+
+  pool->st = st;
+  pool->order = order;
+  pool->bplus = layout == BTREE_LAYOUT_BPLUS;
+  pool->kernels = kernels;
+  pool->n_frames = n_frames;
+  pool->wal = wal;
+  pool->counters = counters;
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->loaded, NULL);
+
+  pool->n_buckets = 1;
+  while (pool->n_buckets < 2 * n_frames)
+    pool->n_buckets <<= 1;
+
+  size_t page_size = storage_page_size(st);
+
+  pool->frames = calloc(n_frames, sizeof(bpool_frame_t));
+  pool->buckets = malloc(pool->n_buckets * sizeof(int));
+  pool->header = calloc(1, page_size);
+  pool->txn = malloc(n_frames * sizeof(int));
+  pool->slab = node_slab_create(pool->bplus, order, page_size);
+  if (!pool->frames || !pool->buckets || !pool->header || !pool->txn ||
+      !pool->slab || node_slab_reserve(pool->slab, n_frames) != BTREE_SUCCESS) {
+    bpool_release(pool);
+    return NULL;
+  }
+
+  for (size_t b = 0; b < pool->n_buckets; b++)
+    pool->buckets[b] = -1;
+
+  for (size_t f = 0; f < n_frames; f++) {
+    pool->frames[f].page = -1;
+    pool->frames[f].next = -1;
+    pool->frames[f].node = node_slab_alloc(pool->slab, false, 0);
+  }
+
+  pool->stats.pool_pages = n_frames;
+
+  disk_superblock_t *sb = bpool_superblock(pool);
+
+  // Arquivo existente: valida o superbloco e recupera o estado das páginas
+  if (storage_size(st) >= page_size) {
+    if (storage_read_page(st, DISK_HEADER_PAGE, pool->header) !=
+            BTREE_SUCCESS ||
+        sb->magic != DISK_MAGIC || sb->version != DISK_VERSION ||
+        sb->page_size != page_size || sb->order != order ||
+        sb->layout != layout) {
+      bpool_release(pool);
+      return NULL;
+    }
+
+    pool->n_pages = sb->n_pages;
+    pool->free_head = sb->free_head;
+    pool->n_free = sb->n_free;
+
+    if (wal && bpool_recover(pool) != BTREE_SUCCESS) {
+      bpool_release(pool);
+      return NULL;
+    }
+  } else {
+    // Arquivo novo: somente o superbloco existe
+    sb->magic = DISK_MAGIC;
+    sb->version = DISK_VERSION;
+    sb->page_size = page_size;
+    sb->order = order;
+    sb->layout = layout;
+    sb->n_keys = 0;
+    sb->root = -1;
+
+    pool->n_pages = DISK_FIRST_NODE_PAGE;
+    pool->free_head = -1;
+    pool->n_free = 0;
+
+    // Um log restante não se refere a este arquivo
+    if (bpool_write_header(pool) != BTREE_SUCCESS ||
+        (wal && wal_truncate(wal) != BTREE_SUCCESS)) {
+      bpool_release(pool);
+      return NULL;
+    }
+  }
+
+  return pool;
+}
+
+void bpool_destroy(bpool_t *pool) {
+  if (!pool)
+    return;
+
+  bpool_flush(pool);
+  bpool_release(pool);
+}
+
+/**
+ * Fixa uma página, lendo-a do arquivo se necessário, sem obter seu latch
+ *
+ * A leitura acontece fora do lock do pool: o frame fica marcado como em
+ * leitura, e quem procurar a mesma página espera que ela termine
+ */
+static node_t *bpool_fix(bpool_t *pool, int page) {
+  if (!pool || page < DISK_FIRST_NODE_PAGE)
+    return NULL;
+
+  pthread_mutex_lock(&pool->lock);
+
+  if ((size_t)page >= pool->n_pages) {
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+  }
+
+  int f;
+  while ((f = bpool_lookup(pool, page)) != -1 && pool->frames[f].loading)
+    pthread_cond_wait(&pool->loaded, &pool->lock);
+
+  if (f != -1) {
+    bpool_frame_t *frame = &pool->frames[f];
+    frame->pin_count++;
+    frame->referenced = true;
+
+    node_t *node = frame->node;
+    pthread_mutex_unlock(&pool->lock);
+
+    stats_add(pool->counters, STATS_CACHE_HITS, 1);
+
+    return node;
+  }
+
+  f = bpool_victim(pool);
+  if (f == -1) {
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+  }
+
+  bpool_frame_t *frame = &pool->frames[f];
+  bpool_attach(pool, f, page);
+  frame->pin_count = 1;
+  frame->dirty = false;
+  frame->referenced = true;
+  frame->loading = true;
+
+  node_t *node = frame->node;
+  bpool_version_begin(node);
+  pthread_mutex_unlock(&pool->lock);
+
+  int result = disk_read(pool->st, node, pool->order, page);
+
+  stats_add(pool->counters, STATS_CACHE_MISSES, 1);
+  if (result == BTREE_SUCCESS)
+    stats_page(pool->counters, node->level, false);
+
+  // O pool pode ter crescido durante a leitura: o frame é procurado de novo
+  pthread_mutex_lock(&pool->lock);
+  frame = &pool->frames[f];
+  frame->loading = false;
+  bpool_version_end(node);
+
+  if (result != BTREE_SUCCESS) {
+    bpool_detach(pool, f);
+    frame->pin_count = 0;
+    node = NULL;
+  }
+
+  pthread_cond_broadcast(&pool->loaded);
+  pthread_mutex_unlock(&pool->lock);
+
+  return node;
+}
+
+/**
+ * Desfaz uma fixação de bpool_fix() cujo latch não foi obtido
+ */
+static void bpool_unfix(bpool_t *pool, node_t *node) {
+  pthread_mutex_lock(&pool->lock);
+
+  int f = bpool_lookup(pool, node->bin_pos);
+  if (f != -1 && pool->frames[f].pin_count > 0)
+    pool->frames[f].pin_count--;
+
+  pthread_mutex_unlock(&pool->lock);
+}
+
+node_t *bpool_pin(bpool_t *pool, int page) {
+  node_t *node = bpool_fix(pool, page);
+  if (node)
+    bpool_latch(node, true);
+
+  return node;
+}
+
+node_t *bpool_pin_shared(bpool_t *pool, int page) {
+  node_t *node = bpool_fix(pool, page);
+  if (node)
+    bpool_latch(node, false);
+
+  return node;
+}
+
+node_t *bpool_peek(bpool_t *pool, int page, uint64_t *version) {
+  if (!pool || !version || page < DISK_FIRST_NODE_PAGE)
+    return NULL;
+
+  pthread_mutex_lock(&pool->lock);
+
+  if ((size_t)page >= pool->n_pages) {
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+  }
+
+  int f = bpool_lookup(pool, page);
+  if (f != -1 && !pool->frames[f].loading) {
+    bpool_frame_t *frame = &pool->frames[f];
+    frame->referenced = true;
+
+    node_t *node = frame->node;
+    uint64_t v = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+    pthread_mutex_unlock(&pool->lock);
+
+    stats_add(pool->counters, STATS_CACHE_HITS, 1);
+
+    *version = v;
+    return v & 1 ? NULL : node;
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+
+  // Página ausente: é lida por uma fixação compartilhada, durante a qual a
+  // versão não muda
+  node_t *node = bpool_pin_shared(pool, page);
+  if (!node)
+    return NULL;
+
+  *version = __atomic_load_n(&node->version, __ATOMIC_ACQUIRE);
+  bpool_unpin(pool, node, false);
+
+  return node;
+}
+
+bool bpool_check(const node_t *node, uint64_t version) {
+  // As leituras do nó terminam antes da nova leitura da versão
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+  return __atomic_load_n(&node->version, __ATOMIC_RELAXED) == version;
+}
+
+node_t *bpool_upgrade(bpool_t *pool, int page, node_t *node,
+                      uint64_t version) {
+  node_t *pinned = bpool_pin(pool, page);
+  if (!pinned)
+    return NULL;
+
+  // A fixação exclusiva soma um à versão: qualquer outro valor indica uma
+  // alteração ou outra página no frame
+  if (pinned != node || pinned->version != version + 1) {
+    bpool_unpin(pool, pinned, false);
+    return NULL;
+  }
+
+  return node;
+}
+
+void bpool_prefetch(bpool_t *pool, int page) {
+  if (!pool || page < DISK_FIRST_NODE_PAGE)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+
+  if ((size_t)page >= pool->n_pages) {
+    pthread_mutex_unlock(&pool->lock);
+    return;
+  }
+
+  int f = bpool_lookup(pool, page);
+  const node_t *node = NULL;
+  const char *data = NULL;
+
+  // O frame pode ser recarregado depois que o lock é liberado; a antecipação
+  // usa os endereços lidos aqui
+  if (f != -1 && !pool->frames[f].loading) {
+    node = pool->frames[f].node;
+    data = node->page;
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+
+  if (f == -1) {
+    storage_prefetch(pool->st, page);
+    return;
+  }
+
+  // Cabeçalho e primeiras chaves, usados pela busca no nó
+  if (node) {
+    __builtin_prefetch(node);
+    __builtin_prefetch(data);
+    __builtin_prefetch(data + 64);
+  }
+}
+
+void bpool_prefetch_batch(bpool_t *pool, const int *pages, size_t n) {
+  if (!pool || !pages || n == 0)
+    return;
+
+  bpool_page_ref_t *refs = NULL;
+  void **bufs = NULL;
+  storage_io_t *ios = NULL;
+
+  if (storage_io_engine(pool->st) == BTREE_IO_URING) {
+    refs = malloc(n * sizeof(*refs));
+    bufs = malloc(n * sizeof(*bufs));
+    ios = malloc(n * sizeof(*ios));
+  }
+
+  // Sem leituras assíncronas, fica com o sistema operacional
+  if (!refs || !bufs || !ios) {
+    free(refs);
+    free(bufs);
+    free(ios);
+
+    for (size_t i = 0; i < n; i++)
+      bpool_prefetch(pool, pages[i]);
+
+    return;
+  }
+
+  size_t m = 0;
+
+  pthread_mutex_lock(&pool->lock);
+
+  // Os frames ficam fixados e em leitura, como em bpool_fix(), até o fim do
+  // lote
+  for (size_t i = 0; i < n && m < pool->n_frames / 2; i++) {
+    int page = pages[i];
+    if (page < DISK_FIRST_NODE_PAGE || (size_t)page >= pool->n_pages ||
+        bpool_lookup(pool, page) != -1)
+      continue;
+
+    int f = bpool_victim(pool);
+    if (f == -1)
+      break;
+
+    bpool_frame_t *frame = &pool->frames[f];
+    bpool_attach(pool, f, page);
+    frame->pin_count = 1;
+    frame->dirty = false;
+    frame->referenced = true;
+    frame->loading = true;
+    bpool_version_begin(frame->node);
+
+    refs[m++] = (bpool_page_ref_t){page, f};
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+
+  qsort(refs, m, sizeof(*refs), bpool_page_ref_cmp);
+
+  for (size_t i = 0; i < m; i++)
+    bufs[i] = pool->frames[refs[i].f].node->buf;
+
+  size_t n_ios = bpool_runs(refs, m, bufs, ios);
+  int result = storage_read_batch(pool->st, ios, n_ios);
+
+  stats_add(pool->counters, STATS_CACHE_MISSES, m);
+
+  pthread_mutex_lock(&pool->lock);
+
+  for (size_t i = 0; i < m; i++) {
+    int f = refs[i].f;
+    bpool_frame_t *frame = &pool->frames[f];
+
+    if (result == BTREE_SUCCESS) {
+      disk_unpack(frame->node, frame->node->buf, pool->order, refs[i].page);
+      stats_page(pool->counters, frame->node->level, false);
+    }
+
+    frame->loading = false;
+    frame->pin_count--;
+    bpool_version_end(frame->node);
+
+    if (result != BTREE_SUCCESS)
+      bpool_detach(pool, f);
+  }
+
+  pthread_cond_broadcast(&pool->loaded);
+  pthread_mutex_unlock(&pool->lock);
+
+  free(refs);
+  free(bufs);
+  free(ios);
+}
+
+node_t *bpool_new(bpool_t *pool, bool is_leaf) {
+  if (!pool)
+    return NULL;
+
+  pthread_mutex_lock(&pool->lock);
+
+  // Reaproveita a primeira página da lista de páginas livres
+  while (pool->free_head != -1) {
+    int page = pool->free_head;
+    pthread_mutex_unlock(&pool->lock);
+
+    node_t *node = bpool_fix(pool, page);
+    if (!node)
+      return NULL;
+
+    // O latch não é esperado: quem aloca segura os nós de uma divisão, e a
+    // página pode já ter saído da lista e estar com quem espera por eles.
+    // Nesse caso o arquivo cresce uma página
+    if (!bpool_try_latch(node)) {
+      bpool_unfix(pool, node);
+      pthread_mutex_lock(&pool->lock);
+      break;
+    }
+
+    // Com o latch exclusivo, a página só continua no início da lista se
+    // nenhum outro thread a retirou antes
+    pthread_mutex_lock(&pool->lock);
+    if (pool->free_head != page) {
+      pthread_mutex_unlock(&pool->lock);
+      bpool_unpin(pool, node, false);
+      pthread_mutex_lock(&pool->lock);
+      continue;
+    }
+
+    pool->free_head = node->children[0];
+    pool->n_free--;
+    pool->stats.reused++;
+    pthread_mutex_unlock(&pool->lock);
+
+    node_init(node, is_leaf, pool->order, node->bin_pos);
+    bpool_mark_dirty(pool, node);
+
+    return node;
+  }
+
+  int f = bpool_victim(pool);
+  if (f == -1) {
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+  }
+
+  int page = pool->n_pages++;
+  stats_add(pool->counters, STATS_FILE_GROWTH, 1);
+
+  bpool_frame_t *frame = &pool->frames[f];
+  bpool_version_begin(frame->node);
+  node_init(frame->node, is_leaf, pool->order, page);
+  bpool_version_end(frame->node);
+
+  bpool_attach(pool, f, page);
+  frame->pin_count = 1;
+  frame->referenced = true;
+  bpool_dirty(pool, f);
+
+  node_t *node = frame->node;
+  pthread_mutex_unlock(&pool->lock);
+
+  bpool_latch(node, true);
+
+  return node;
+}
+
+void bpool_free(bpool_t *pool, node_t *node) {
+  if (!pool || !node)
+    return;
+
+  // Página livre: nó interno vazio encadeado pelo primeiro filho
+  node_init(node, false, pool->order, node->bin_pos);
+
+  pthread_mutex_lock(&pool->lock);
+  node->children[0] = pool->free_head;
+  pool->free_head = node->bin_pos;
+  pool->n_free++;
+  pthread_mutex_unlock(&pool->lock);
+
+  bpool_unpin(pool, node, true);
+}
+
+void bpool_unpin(bpool_t *pool, node_t *node, bool dirty) {
+  if (!pool || !node)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+
+  int f = bpool_lookup(pool, node->bin_pos);
+  if (f == -1 || pool->frames[f].pin_count == 0) {
+    pthread_mutex_unlock(&pool->lock);
+    return;
+  }
+
+  // A versão fica par de novo antes de o frame poder receber outra página
+  if (pthread_equal(__atomic_load_n(&node->owner, __ATOMIC_RELAXED),
+                    pthread_self())) {
+    node->modified |= dirty;
+    if (node->depth == 1)
+      bpool_version_release(node);
+  }
+
+  pool->frames[f].pin_count--;
+  if (dirty)
+    bpool_dirty(pool, f);
+
+  pthread_mutex_unlock(&pool->lock);
+
+  // Até aqui o nó não é mais alterado: o frame pode ser escolhido para outra
+  // página antes do latch ser liberado, mas quem o fixar espera pelo latch
+  bpool_unlatch(node);
+}
+
+void bpool_mark_dirty(bpool_t *pool, node_t *node) {
+  if (!pool || !node)
+    return;
+
+  if (pthread_equal(__atomic_load_n(&node->owner, __ATOMIC_RELAXED),
+                    pthread_self()))
+    node->modified = true;
+
+  pthread_mutex_lock(&pool->lock);
+
+  int f = bpool_lookup(pool, node->bin_pos);
+  if (f != -1)
+    bpool_dirty(pool, f);
+
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void bpool_set_unlogged(bpool_t *pool, bool unlogged) {
+  if (pool)
+    pool->unlogged = unlogged;
+}
+
+disk_superblock_t *bpool_superblock(bpool_t *pool) {
+  return pool ? (disk_superblock_t *)pool->header : NULL;
+}
+
+/**
+ * bpool_commit() com o lock do pool já obtido
+ */
+static int bpool_commit_locked(bpool_t *pool) {
+  if (!pool->wal || pool->n_txn == 0)
+    return BTREE_SUCCESS;
+
+  // O superbloco do registro precisa refletir as páginas alocadas
+  disk_superblock_t sb = *bpool_superblock(pool);
+  sb.n_pages = pool->n_pages;
+  sb.free_head = pool->free_head;
+  sb.n_free = pool->n_free;
+
+  if (wal_begin(pool->wal, &sb, pool->n_txn) != BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
+
+  for (size_t i = 0; i < pool->n_txn; i++) {
+    bpool_frame_t *frame = &pool->frames[pool->txn[i]];
+    node_pack(frame->node);
+
+    if (wal_add_page(pool->wal, frame->page, frame->node->page) !=
+        BTREE_SUCCESS)
+      return BTREE_ERROR_IO;
+  }
+
+  int64_t lsn = wal_end(pool->wal);
+  if (lsn < 0)
+    return BTREE_ERROR_IO;
+
+  for (size_t i = 0; i < pool->n_txn; i++) {
+    bpool_frame_t *frame = &pool->frames[pool->txn[i]];
+    frame->in_txn = false;
+    frame->lsn = lsn;
+  }
+
+  pool->n_txn = 0;
+
+  return BTREE_SUCCESS;
+}
+
+int bpool_commit(bpool_t *pool) {
+  if (!pool)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  pthread_mutex_lock(&pool->lock);
+  int result = bpool_commit_locked(pool);
+  pthread_mutex_unlock(&pool->lock);
+
+  return result;
+}
+
+/**
+ * bpool_flush() com o lock do pool já obtido
+ */
+static int bpool_flush_locked(bpool_t *pool) {
+  if (bpool_commit_locked(pool) != BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
+
+  if (bpool_write_dirty(pool, false) != BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
+
+  if (bpool_write_header(pool) != BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
+
+  if (!pool->wal)
+    return storage_flush(pool->st);
+
+  // Checkpoint: o log só pode ser descartado depois que o arquivo estiver
+  // no mesmo nível de durabilidade que ele
+  int sync = wal_durability(pool->wal) == BTREE_DURABILITY_FDATASYNC;
+  if ((sync ? storage_sync(pool->st) : storage_flush(pool->st)) !=
+      BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
+
+  return wal_truncate(pool->wal);
+}
+
+int bpool_flush(bpool_t *pool) {
+  if (!pool)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  pthread_mutex_lock(&pool->lock);
+  int result = bpool_flush_locked(pool);
+  pthread_mutex_unlock(&pool->lock);
+
+  return result;
+}
+
+const node_kernels_t *bpool_kernels(const bpool_t *pool) {
+  return pool ? pool->kernels : NULL;
+}
+
+size_t bpool_page_count(bpool_t *pool) {
+  if (!pool)
+    return 0;
+
+  pthread_mutex_lock(&pool->lock);
+  size_t n_pages = pool->n_pages;
+  pthread_mutex_unlock(&pool->lock);
+
+  return n_pages;
+}
+
+bool bpool_txn_full(bpool_t *pool) {
+  if (!pool || !pool->wal)
+    return false;
+
+  pthread_mutex_lock(&pool->lock);
+  bool full =
+      2 * pool->n_txn >= pool->n_frames || pool->n_txn >= BPOOL_TXN_PAGES;
+  pthread_mutex_unlock(&pool->lock);
+
+  return full;
+}
+
+size_t bpool_wal_size(bpool_t *pool) {
+  if (!pool || !pool->wal)
+    return 0;
+
+  // Remoções de páginas de outros threads também descarregam o log
+  pthread_mutex_lock(&pool->lock);
+  size_t size = wal_size(pool->wal);
+  pthread_mutex_unlock(&pool->lock);
+
+  return size;
+}
+
+size_t bpool_free_count(bpool_t *pool) {
+  if (!pool)
+    return 0;
+
+  pthread_mutex_lock(&pool->lock);
+  size_t n_free = pool->n_free;
+  pthread_mutex_unlock(&pool->lock);
+
+  return n_free;
+}
+
+void bpool_stats(bpool_t *pool, btree_cache_stats_t *stats) {
+  if (!pool || !stats)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  *stats = pool->stats;
+  pthread_mutex_unlock(&pool->lock);
+
+  // Acertos e faltas são contados por thread, fora do lock
+  btree_stats_t counters;
+  stats_read(pool->counters, &counters);
+  stats->hits = counters.cache_hits;
+  stats->misses = counters.cache_misses;
+}
+
+stats_t *bpool_counters(const bpool_t *pool) {
+  return pool ? pool->counters : NULL;
+}
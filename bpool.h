@@ -0,0 +1,304 @@
+#ifndef BPOOL_H
+#define BPOOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "btree.h"
+#include "kernels.h"
+#include "node.h"
+#include "stats.h"
+#include "storage.h"
+#include "wal.h"
+
+// Quantidade mínima de frames: o pior caso de uma operação (merge ou split
+// com pai, filho e irmão) precisa de poucos nós fixados ao mesmo tempo
+#define BPOOL_MIN_FRAMES 8
+
+// Páginas alteradas a partir das quais uma operação longa deve ser efetivada,
+// bem abaixo do limite de páginas de um registro do log de redo
+#define BPOOL_TXN_PAGES 1024
+
+/**
+ * Buffer pool
+ *
+ * O pool pode ser usado por vários threads. Cada página fixada tem um latch de
+ * leitura e escrita, obtido por bpool_pin() (exclusivo) ou bpool_pin_shared()
+ * (compartilhado) e liberado por bpool_unpin(); um thread pode fixar de novo,
+ * no modo exclusivo, uma página que já mantém fixada nesse modo. O estado do
+ * pool fica sob um lock interno, e a leitura de uma página ausente acontece
+ * fora dele
+ *
+ * Páginas também podem ser lidas sem latch (bpool_peek()): cada nó tem uma
+ * versão, ímpar durante uma fixação exclusiva, que muda a cada fixação
+ * exclusiva liberada como suja (bpool_unpin() ou bpool_mark_dirty()) e a
+ * cada troca de página no frame; a leitura só vale se a versão não tiver
+ * mudado ao final (bpool_check())
+ *
+ * bpool_commit() e bpool_flush() não podem ser concorrentes com alterações de
+ * nós feitas por outros threads
+ */
+typedef struct bpool bpool_t;
+
+/**
+ * Cria um buffer pool na frente do arquivo binário
+ *
+ * Se o arquivo já existir, o superbloco é lido e validado contra a ordem, o
+ * formato dos nós e o tamanho de página informados e os registros do log de
+ * redo são reaplicados; caso contrário, um superbloco novo é escrito
+ *
+ * @param st Arquivo binário
+ * @param wal Log de redo ou NULL para escrever as páginas sem registro
+ * @param order Ordem da árvore
+ * @param layout Formato dos nós
+ * @param kernels Kernels de movimentação de chaves escolhidos para a ordem
+ * @param n_frames Capacidade do pool, em páginas
+ * @param counters Contadores da árvore, que recebem os acessos, leituras e
+ * escritas de páginas (pode ser NULL)
+ *
+ * @return Ponteiro para o pool ou NULL em caso de erro
+ */
+bpool_t *bpool_create(storage_t *st, wal_t *wal, size_t order,
+                      btree_layout_t layout, const node_kernels_t *kernels,
+                      size_t n_frames, stats_t *counters);
+
+/**
+ * Escreve as páginas sujas no arquivo e libera o pool
+ *
+ * @param pool Ponteiro para o pool
+ */
+void bpool_destroy(bpool_t *pool);
+
+/**
+ * Fixa uma página no pool, lendo-a do arquivo se necessário, com o latch
+ * exclusivo
+ *
+ * O nó retornado permanece válido até a chamada correspondente de
+ * bpool_unpin(), que também libera o latch
+ *
+ * @param pool Ponteiro para o pool
+ * @param page Posição da página no arquivo
+ *
+ * @return Ponteiro para o nó ou NULL em caso de erro
+ */
+node_t *bpool_pin(bpool_t *pool, int page);
+
+/**
+ * Fixa uma página no pool com o latch compartilhado, para leitura
+ *
+ * @param pool Ponteiro para o pool
+ * @param page Posição da página no arquivo
+ *
+ * @return Ponteiro para o nó ou NULL em caso de erro
+ */
+node_t *bpool_pin_shared(bpool_t *pool, int page);
+
+/**
+ * Obtém o nó de uma página para leitura otimista, sem fixá-lo nem obter seu
+ * latch; uma página fora do pool é lida antes
+ *
+ * O nó pode ser alterado ou receber outra página a qualquer momento: tudo o
+ * que for lido dele deve ser confirmado com bpool_check() antes de ser usado,
+ * e nenhum ponteiro ou tamanho lido pode ser seguido sem verificação
+ *
+ * @param pool Ponteiro para o pool
+ * @param page Posição da página no arquivo
+ * @param version Recebe a versão do nó
+ *
+ * @return Ponteiro para o nó ou NULL em caso de erro ou se o nó estiver sendo
+ * alterado
+ */
+node_t *bpool_peek(bpool_t *pool, int page, uint64_t *version);
+
+/**
+ * Confirma uma leitura otimista
+ *
+ * @param node Nó obtido por bpool_peek()
+ * @param version Versão devolvida por bpool_peek()
+ *
+ * @return true se o nó não mudou desde bpool_peek()
+ */
+bool bpool_check(const node_t *node, uint64_t version);
+
+/**
+ * Fixa com o latch exclusivo uma página lida de forma otimista, desde que ela
+ * não tenha mudado desde bpool_peek()
+ *
+ * @param pool Ponteiro para o pool
+ * @param page Página passada a bpool_peek()
+ * @param node Nó devolvido por bpool_peek()
+ * @param version Versão devolvida por bpool_peek()
+ *
+ * @return node fixado ou NULL se a página mudou ou em caso de erro
+ */
+node_t *bpool_upgrade(bpool_t *pool, int page, node_t *node,
+                      uint64_t version);
+
+/**
+ * Antecipa o acesso a uma página sem fixá-la
+ *
+ * Se a página estiver no pool, o início do nó é trazido para o cache da CPU;
+ * caso contrário, o sistema operacional é avisado para lê-la em segundo plano
+ *
+ * @param pool Ponteiro para o pool
+ * @param page Número da página
+ */
+void bpool_prefetch(bpool_t *pool, int page);
+
+/**
+ * Antecipa o acesso a várias páginas sem fixá-las
+ *
+ * Com o io_uring, as páginas ausentes são lidas para o pool em um único lote,
+ * com várias leituras em andamento, ocupando no máximo metade dos frames; sem
+ * ele, cada página passa por bpool_prefetch()
+ *
+ * @param pool Ponteiro para o pool
+ * @param pages Números das páginas
+ * @param n Quantidade de páginas
+ */
+void bpool_prefetch_batch(bpool_t *pool, const int *pages, size_t n);
+
+/**
+ * Aloca uma nova página e a fixa no pool com o latch exclusivo
+ *
+ * Páginas da lista de páginas livres são reaproveitadas antes que o arquivo
+ * cresça, a menos que a primeira delas esteja fixada por outro thread. A
+ * página já nasce suja, de modo que será escrita no arquivo mesmo que não
+ * seja alterada
+ *
+ * @param pool Ponteiro para o pool
+ * @param is_leaf Flag indicando se o novo nó é folha
+ *
+ * @return Ponteiro para o novo nó ou NULL em caso de erro
+ */
+node_t *bpool_new(bpool_t *pool, bool is_leaf);
+
+/**
+ * Libera uma página fixada por bpool_pin() ou bpool_new()
+ *
+ * @param pool Ponteiro para o pool
+ * @param node Nó fixado
+ * @param dirty Flag indicando se o nó foi alterado
+ */
+void bpool_unpin(bpool_t *pool, node_t *node, bool dirty);
+
+/**
+ * Devolve uma página fixada à lista de páginas livres
+ *
+ * O pin é liberado e o nó não deve mais ser usado pelo chamador
+ *
+ * @param pool Ponteiro para o pool
+ * @param node Nó fixado cuja página deixa de fazer parte da árvore
+ */
+void bpool_free(bpool_t *pool, node_t *node);
+
+/**
+ * Marca uma página fixada como suja sem liberá-la
+ *
+ * @param pool Ponteiro para o pool
+ * @param node Nó fixado
+ */
+void bpool_mark_dirty(bpool_t *pool, node_t *node);
+
+/**
+ * Suspende ou retoma o registro das páginas alteradas no log de redo
+ *
+ * Usado por operações que escrevem somente páginas fora da árvore persistida
+ * e terminam com um checkpoint, como a carga em lote
+ *
+ * @param pool Ponteiro para o pool
+ * @param unlogged Flag indicando se o registro fica suspenso
+ */
+void bpool_set_unlogged(bpool_t *pool, bool unlogged);
+
+/**
+ * Retorna o superbloco mantido em memória pelo pool
+ *
+ * Alterações feitas pelo chamador são gravadas no próximo bpool_flush()
+ *
+ * @param pool Ponteiro para o pool
+ */
+disk_superblock_t *bpool_superblock(bpool_t *pool);
+
+/**
+ * Encerra a operação em andamento, gravando no log de redo um registro com as
+ * páginas alteradas desde a última chamada
+ *
+ * Sem log de redo não faz nada. Até o commit, as páginas alteradas não são
+ * escritas no arquivo; se não houver frame livre, o pool cresce
+ *
+ * @param pool Ponteiro para o pool
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int bpool_commit(bpool_t *pool);
+
+/**
+ * Escreve todas as páginas sujas e o superbloco no arquivo
+ *
+ * Com o log de redo, é um checkpoint: o log é esvaziado ao final
+ *
+ * @param pool Ponteiro para o pool
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int bpool_flush(bpool_t *pool);
+
+/**
+ * Retorna os kernels de movimentação de chaves da árvore
+ *
+ * @param pool Ponteiro para o pool
+ */
+const node_kernels_t *bpool_kernels(const bpool_t *pool);
+
+/**
+ * Indica se a operação em andamento já alterou metade dos frames do pool ou
+ * BPOOL_TXN_PAGES páginas
+ *
+ * Operações longas devem ser efetivadas nesse ponto, pois frames ainda fora
+ * do log de redo não podem ser removidos do pool
+ *
+ * @param pool Ponteiro para o pool
+ */
+bool bpool_txn_full(bpool_t *pool);
+
+/**
+ * Retorna o tamanho atual do log de redo ou 0 sem log
+ *
+ * @param pool Ponteiro para o pool
+ */
+size_t bpool_wal_size(bpool_t *pool);
+
+/**
+ * Retorna a quantidade de páginas alocadas no arquivo
+ *
+ * @param pool Ponteiro para o pool
+ */
+size_t bpool_page_count(bpool_t *pool);
+
+/**
+ * Retorna a quantidade de páginas na lista de páginas livres
+ *
+ * @param pool Ponteiro para o pool
+ */
+size_t bpool_free_count(bpool_t *pool);
+
+/**
+ * Copia os contadores do pool
+ *
+ * @param pool Ponteiro para o pool
+ * @param stats Estrutura que receberá os contadores
+ */
+void bpool_stats(bpool_t *pool, btree_cache_stats_t *stats);
+
+/**
+ * Retorna os contadores de operações e de E/S da árvore, onde as rotinas dos
+ * nós contam divisões, mesclas e empréstimos
+ *
+ * @param pool Ponteiro para o pool
+ *
+ * @return Contadores passados a bpool_create() ou NULL
+ */
+stats_t *bpool_counters(const bpool_t *pool);
+
+#endif // !BPOOL_H
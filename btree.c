@@ -1,278 +1,335 @@
-#include <math.h>
+#define _GNU_SOURCE
+
+#include <limits.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "bplus.h"
+#include "bpool.h"
 #include "btree.h"
+#include "kernels.h"
+#include "keys.h"
+#include "node.h"
+#include "stats.h"
+#include "wal.h"
+
+size_t node_disk_size(size_t order, bool bplus) {
+  // Na B+, a folha (irmãos + pares) é o maior dos dois formatos
+  if (bplus)
+    return sizeof(disk_node_header_t) + sizeof(int) * 2 * order;
+
+  return sizeof(disk_node_header_t) + sizeof(int) * (3 * order - 2);
+}
 
-struct node {
-  size_t n_keys; // Quantidade de chaves armazenadas
-  int *keys;     // Array de chaves
-  int *values;   // Array de registros
+size_t node_max_order(size_t page_size, bool bplus) {
+  // Folha B+: cabeçalho + 2 irmãos + (order - 1) chaves e registros
+  if (bplus)
+    return (page_size - sizeof(disk_node_header_t)) / (2 * sizeof(int));
 
-  size_t bin_pos; // Posição no arquivo binário
-  int *children;  // Array offsets para leitura dos filhos em arquivo binário
+  // Cabeçalho + (order - 1) chaves + (order - 1) registros + order filhos
+  return (page_size - sizeof(disk_node_header_t) + 2 * sizeof(int)) /
+         (3 * sizeof(int));
+}
 
-  bool is_leaf; // Flag indicando se um nó é folha
-};
+/**
+ * Aponta os arrays do nó para dentro de uma página
+ *
+ * @param node Nó
+ * @param page Página no formato do arquivo
+ * @param order Ordem da árvore
+ */
+static void node_bind(node_t *node, char *page, size_t order) {
+  node->page = page;
+
+  // B+: folhas sem filhos e nós internos sem registros
+  if (node->bplus) {
+    int *base = (int *)(page + sizeof(disk_node_header_t));
+
+    if (node->is_leaf) {
+      node->siblings = base;
+      node->keys = base + 2;
+      node->values = node->keys + (order - 1);
+      node->children = NULL;
+    } else {
+      node->siblings = NULL;
+      node->keys = base;
+      node->values = NULL;
+      node->children = node->keys + (order - 1);
+    }
 
-size_t get_next_bin_pos(FILE *fp) {
-  size_t n_nodes;
-  fseek(fp, 0, SEEK_SET);
-  fread(&n_nodes, sizeof(size_t), 1, fp);
-  return n_nodes;
-}
+    return;
+  }
 
-void update_node_count(FILE *fp) {
-  size_t n_nodes;
-  fseek(fp, 0, SEEK_SET);
-  fread(&n_nodes, sizeof(size_t), 1, fp);
-  n_nodes++;
-  fseek(fp, 0, SEEK_SET);
-  fwrite(&n_nodes, sizeof(size_t), 1, fp);
+  node->siblings = NULL;
+  node->keys = (int *)(page + sizeof(disk_node_header_t));
+  node->values = node->keys + (order - 1);
+  node->children = node->values + (order - 1);
 }
 
-size_t calculate_offset(size_t bin_pos, size_t order) {
-  if (order < 3)
-    return (size_t)-1;
+int disk_read(storage_t *st, node_t *node, size_t order, size_t file_pos) {
+  if (!st || !node || order < 3)
+    return BTREE_ERROR_INVALID_PARAM;
 
-  size_t static_var = sizeof(size_t) + sizeof(bool) + sizeof(size_t);
-  size_t key_size = sizeof(int) * (order - 1);
-  size_t value_size = sizeof(int) * (order - 1);
-  size_t child_size = sizeof(int) * order;
+  // No mmap a página já está em memória; nos demais backends, uma leitura
+  char *page = storage_map_page(st, file_pos);
+  if (!page) {
+    if (storage_read_page(st, file_pos, node->buf) != BTREE_SUCCESS)
+      return BTREE_ERROR_IO;
 
-  return bin_pos * (static_var + key_size + value_size + child_size);
-}
+    page = node->buf;
+  }
 
-node_t *node_create(bool is_leaf, size_t order, size_t bin_pos);
+  disk_unpack(node, page, order, file_pos);
 
-void node_free(node_t *node);
+  return BTREE_SUCCESS;
+}
 
-node_t *disk_read(FILE *fp, size_t order, size_t file_pos) {
-  if (!fp || order < 3)
-    return NULL;
+void disk_unpack(node_t *node, char *page, size_t order, size_t file_pos) {
+  const disk_node_header_t *header = (const disk_node_header_t *)page;
+  node->n_keys = header->n_keys;
+  node->is_leaf = header->flags & NODE_FLAG_LEAF;
+  node->level = header->level;
+  node->bin_pos = file_pos;
 
-  long offset = calculate_offset(file_pos, order);
-  if (offset < 0 || fseek(fp, offset, SEEK_SET) != 0)
-    return NULL;
+  // O formato dos arrays depende de o nó ser folha
+  node_bind(node, page, order);
+}
 
-  size_t n_keys, bin_pos;
-  bool is_leaf;
+void node_pack(node_t *node) {
+  disk_node_header_t *header = (disk_node_header_t *)node->page;
+  header->n_keys = node->n_keys;
+  header->flags = node->is_leaf ? NODE_FLAG_LEAF : 0;
+  header->level = node->level;
+}
 
-  if (fread(&n_keys, sizeof(size_t), 1, fp) != 1 ||
-      fread(&is_leaf, sizeof(bool), 1, fp) != 1 ||
-      fread(&bin_pos, sizeof(size_t), 1, fp) != 1)
-    return NULL;
+int disk_write(storage_t *st, node_t *node, size_t order) {
+  if (!st || !node || order < 3)
+    return BTREE_ERROR_INVALID_PARAM;
 
-  node_t *r_node = node_create(is_leaf, order, file_pos);
-  if (!r_node)
-    return NULL;
+  node_pack(node);
 
-  if (fread(r_node->keys, sizeof(int), order - 1, fp) != order - 1 ||
-      fread(r_node->values, sizeof(int), order - 1, fp) != order - 1 ||
-      fread(r_node->children, sizeof(int), order, fp) != order) {
-    node_free(r_node);
-    return NULL;
-  }
+  // O buffer só é descarregado em bpool_flush() ou no commit do log
+  if (storage_write_page(st, node->bin_pos, node->page) != BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
 
-  return r_node;
+  return (int)node->bin_pos;
 }
 
-int disk_write(FILE *fp, node_t *node, size_t order) {
-  if (!fp || !node || order < 3)
-    return BTREE_ERROR_INVALID_PARAM;
+void node_init(node_t *node, bool is_leaf, size_t order, size_t bin_pos) {
+  node->n_keys = 0;
+  node->is_leaf = is_leaf;
+  node->level = 0;
+  node->bin_pos = bin_pos;
 
-  long offset = calculate_offset(node->bin_pos, order);
-  if (offset < 0 || fseek(fp, offset, SEEK_SET) != 0)
-    return BTREE_ERROR_IO;
+  // Nós novos sempre começam na página própria
+  node_bind(node, node->buf, order);
 
-  if (fwrite(&node->n_keys, sizeof(size_t), 1, fp) != 1 ||
-      fwrite(&node->is_leaf, sizeof(bool), 1, fp) != 1 ||
-      fwrite(&node->bin_pos, sizeof(size_t), 1, fp) != 1)
-    return BTREE_ERROR_IO;
+  for (size_t i = 0; i < order - 1; i++)
+    node->keys[i] = -1;
 
-  if (fwrite(node->keys, sizeof(int), order - 1, fp) != order - 1 ||
-      fwrite(node->values, sizeof(int), order - 1, fp) != order - 1 ||
-      fwrite(node->children, sizeof(int), order, fp) != order)
-    return BTREE_ERROR_IO;
+  if (node->values)
+    for (size_t i = 0; i < order - 1; i++)
+      node->values[i] = -1;
 
-  // Força atualização do buffer
-  fflush(fp);
+  if (node->children)
+    for (size_t i = 0; i < order; i++)
+      node->children[i] = -1;
 
-  return (int)node->bin_pos;
+  if (node->siblings)
+    node->siblings[0] = node->siblings[1] = -1;
 }
 
-/**
- * Destrói recursivamente o nó e seus filhos da memória e do arquivo binário
- *
- * @param node Ponteiro válido para o nó a ser destruído
- * @param order Ordem da árvore
- * @param fp Ponteiro para o arquivo aberto
- */
-void node_destroy(node_t *node, size_t order, FILE *fp) {
-  if (!node)
-    return;
+void node_latch_init(pthread_rwlock_t *latch) {
+  pthread_rwlockattr_t attr;
+  pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+  pthread_rwlockattr_setkind_np(&attr,
+                                PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+  pthread_rwlock_init(latch, &attr);
+  pthread_rwlockattr_destroy(&attr);
+}
 
-  if (node->children && !node->is_leaf) {
-    for (int i = 0; i <= node->n_keys; i++)
-      if (node->children[i] != -1) {
-        node_t *child = disk_read(fp, order, node->children[i]);
-        if (child) {
-          int child_pos = node->children[i];
-          node->children[i] = -1;
-          disk_write(fp, node, order);
+// Nós alocados por bloco quando a lista livre se esgota sem reserva prévia
+#define NODE_SLAB_CHUNK 8
 
-          node_destroy(child, order, fp);
-        }
-      }
-  }
+// Cabeçalho de um bloco, guardado no próprio bloco após os nós
+typedef struct node_slab_chunk {
+  struct node_slab_chunk *next; // Bloco alocado anteriormente
+  void *mem;                    // Início da alocação do bloco
+  size_t n;                     // Quantidade de nós do bloco
+} node_slab_chunk_t;
 
-  if (node->children)
-    free(node->children);
+struct node_slab {
+  size_t order;     // Ordem da árvore
+  size_t page_size; // Tamanho das páginas, em bytes
+  bool bplus;       // Flag indicando o formato B+
 
-  if (node->keys)
-    free(node->keys);
+  node_slab_chunk_t *chunks; // Blocos alocados, do mais recente ao primeiro
 
-  if (node->values)
-    free(node->values);
+  node_t **free;  // Pilha de nós livres
+  size_t n_free;  // Quantidade de nós livres
+  size_t n_total; // Quantidade de nós em todos os blocos
+};
+
+node_slab_t *node_slab_create(bool bplus, size_t order, size_t page_size) {
+  if (order < 3 || order > node_max_order(page_size, bplus))
+    return NULL;
 
-  free(node);
+  node_slab_t *slab = calloc(1, sizeof(node_slab_t));
+  if (!slab)
+    return NULL;
+
+  slab->order = order;
+  slab->page_size = page_size;
+  slab->bplus = bplus;
+
+  return slab;
 }
 
-/**
- * Libera memória alocada pelo nó
- *
- * @param node Ponteiro para o nó a ser liberado
- */
-void node_free(node_t *node) {
-  if (!node)
+void node_slab_destroy(node_slab_t *slab) {
+  if (!slab)
     return;
 
-  if (node->children)
-    free(node->children);
+  node_slab_chunk_t *chunk = slab->chunks;
+  while (chunk) {
+    node_slab_chunk_t *next = chunk->next;
+    node_t *nodes = (node_t *)chunk - chunk->n;
 
-  if (node->keys)
-    free(node->keys);
+    for (size_t i = 0; i < chunk->n; i++)
+      pthread_rwlock_destroy(&nodes[i].latch);
 
-  if (node->values)
-    free(node->values);
+    free(chunk->mem);
+    chunk = next;
+  }
 
-  free(node);
+  free(slab->free);
+  free(slab);
 }
 
-/**
- * Cria um novo nó e aloca memória para ele
- *
- * @param is_leaf Flag indicando se é um nó folha
- * @param order Ordem da árvore (i.e. quantidade máxima de filhos de um nó)
- *
- * @return Ponteiro para o novo nó ou NULL em caso de erro
- */
-node_t *node_create(bool is_leaf, size_t order, size_t bin_pos) {
-  if (order < 3)
-    return NULL;
+int node_slab_reserve(node_slab_t *slab, size_t n) {
+  if (!slab)
+    return BTREE_ERROR_INVALID_PARAM;
 
-  node_t *new_node = malloc(sizeof(node_t));
-  if (!new_node)
-    return NULL;
+  if (slab->n_free >= n)
+    return BTREE_SUCCESS;
 
-  new_node->n_keys = 0;
-  new_node->is_leaf = is_leaf;
-  new_node->bin_pos = bin_pos;
+  n -= slab->n_free;
 
-  new_node->keys = malloc((order - 1) * sizeof(int));
-  if (!new_node->keys) {
-    free(new_node);
-    return NULL;
-  }
+  // A pilha comporta todos os nós, livres ou não
+  node_t **stack = realloc(slab->free, (slab->n_total + n) * sizeof(node_t *));
+  if (!stack)
+    return BTREE_ERROR_ALLOC;
 
-  for (size_t i = 0; i < order - 1; i++)
-    new_node->keys[i] = -1;
+  slab->free = stack;
 
-  new_node->values = malloc((order - 1) * sizeof(int));
-  if (!new_node->values) {
-    free(new_node->keys);
-    free(new_node);
-    return NULL;
+  // Páginas alinhadas ao próprio tamanho, como as páginas do arquivo, e logo
+  // depois os cabeçalhos dos nós e o do bloco
+  size_t pages = n * slab->page_size;
+  size_t size = pages + n * sizeof(node_t) + sizeof(node_slab_chunk_t);
+
+  void *mem;
+  if (posix_memalign(&mem, slab->page_size, size) != 0)
+    return BTREE_ERROR_ALLOC;
+
+  // Zera a folga entre o fim de cada nó e o fim da página
+  memset(mem, 0, size);
+
+  node_t *nodes = (node_t *)((char *)mem + pages);
+  node_slab_chunk_t *chunk = (node_slab_chunk_t *)(nodes + n);
+  chunk->mem = mem;
+  chunk->n = n;
+  chunk->next = slab->chunks;
+  slab->chunks = chunk;
+
+  // Empilha em ordem inversa para que os nós saiam na ordem das páginas
+  for (size_t i = n; i-- > 0;) {
+    nodes[i].bplus = slab->bplus;
+    nodes[i].buf = (char *)mem + i * slab->page_size;
+    node_latch_init(&nodes[i].latch);
+    slab->free[slab->n_free++] = &nodes[i];
   }
 
-  for (size_t i = 0; i < order - 1; i++)
-    new_node->values[i] = -1;
+  slab->n_total += n;
 
-  new_node->children = malloc(order * sizeof(int));
-  if (!new_node->children) {
-    free(new_node->keys);
-    free(new_node->values);
-    free(new_node);
+  return BTREE_SUCCESS;
+}
+
+node_t *node_slab_alloc(node_slab_t *slab, bool is_leaf, size_t bin_pos) {
+  if (!slab)
     return NULL;
-  }
 
-  for (size_t i = 0; i < order; i++)
-    new_node->children[i] = -1;
+  if (slab->n_free == 0 &&
+      node_slab_reserve(slab, NODE_SLAB_CHUNK) != BTREE_SUCCESS)
+    return NULL;
+
+  node_t *node = slab->free[--slab->n_free];
+  node_init(node, is_leaf, slab->order, bin_pos);
+
+  return node;
+}
+
+void node_slab_free(node_slab_t *slab, node_t *node) {
+  if (!slab || !node)
+    return;
 
-  return new_node;
+  slab->free[slab->n_free++] = node;
 }
 
 /**
- * Obtém a chave na posição i do nó
+ * Calcula o grau mínimo t da árvore
  *
- * @param node Ponteiro para o nó
- * @param i Índice da chave
+ * Com t = ⌊order/2⌋, a mescla de dois irmãos com t - 1 chaves mais a chave do
+ * pai nunca ultrapassa order - 1 chaves, inclusive para ordens ímpares
+ *
+ * @param order Ordem da árvore
  *
- * @return A chave na posição i ou -1 se a posição for inválida
+ * @return Grau mínimo da árvore
  */
-int node_keyat(node_t *node, int i) {
-  if (!node || i < 0 || i >= node->n_keys)
-    return -1;
-
-  return node->keys[i];
-}
+int node_min_degree(size_t order) { return order / 2; }
 
 /**
  * Busca uma chave na árvore
  *
- * @param node Raiz da subárvore onde buscar
+ * Os nós são fixados com o latch compartilhado, e cada filho é fixado antes
+ * de o pai ser liberado (latch coupling)
+ *
+ * @param page Página da raiz da subárvore onde buscar
  * @param key Chave a ser buscada
  * @param pos Ponteiro para armazenar a posição encontrada
  *
- * @return Ponteiro para o nó contendo a chave ou NULL se não encontrada
+ * @return Nó fixado no pool contendo a chave ou NULL se não encontrada
  */
-node_t *node_search(node_t *node, int key, int *pos, FILE *fp, size_t order) {
-  if (!node || !pos || !fp)
+node_t *node_search(int page, int key, int *pos, bpool_t *pool, size_t order) {
+  if (!pos || !pool || page == -1)
     return NULL;
 
-  int i = 0;
+  node_t *node = bpool_pin_shared(pool, page);
 
-  while (i < node->n_keys && key > node_keyat(node, i))
-    i++;
+  while (node) {
+    int i = keys_lower_bound(node->keys, node->n_keys, key);
 
-  // Chave encontrada
-  if (i < node->n_keys && key == node_keyat(node, i)) {
-    *pos = i;
-    return node;
-  }
-
-  if (node->is_leaf)
-    return NULL;
-
-  if (node->children[i] == -1)
-    return NULL;
-
-  node_t *child = disk_read(fp, order, node->children[i]);
-  if (!child)
-    return NULL;
-
-  node_t *result = node_search(child, key, pos, fp, order);
+    // Chave encontrada
+    if (i < node->n_keys && key == node->keys[i]) {
+      *pos = i;
+      return node;
+    }
 
-  if (child != result)
-    node_free(child);
+    node_t *child =
+        node->is_leaf ? NULL : bpool_pin_shared(pool, node->children[i]);
+    bpool_unpin(pool, node, false);
+    node = child;
+  }
 
-  return result;
+  return NULL;
 }
 
 /**
- * Divide um nó filho quando está cheio
+ * Divide um nó filho cheio
  *
  * @param parent Nó pai
  * @param idx Índice do filho a ser dividido
@@ -282,249 +339,372 @@ node_t *node_search(node_t *node, int key, int *pos, FILE *fp, size_t order) {
  * @return BTREE_SUCCESS em caso de sucesso ou código de erro
  */
 int node_split_child(node_t *parent, int idx, size_t order, node_t *child,
-                     FILE *fp) {
-  if (!parent || !child || !fp || idx < 0 || idx > parent->n_keys)
+                     bpool_t *pool) {
+  if (!parent || !child || !pool || idx < 0 || idx > parent->n_keys ||
+      child->n_keys != (int)order - 1)
     return BTREE_ERROR_INVALID_PARAM;
 
-  // Determina próxima posição livre no arquivo
-  size_t new_node_pos = get_next_bin_pos(fp);
-
-  node_t *new_node = node_create(child->is_leaf, order, new_node_pos);
+  // Aloca o novo nó na próxima posição livre do arquivo
+  node_t *new_node = bpool_new(pool, child->is_leaf);
 
   if (!new_node)
     return BTREE_ERROR_ALLOC;
 
-  int t = ceil(order / 2.0);
-  new_node->n_keys = child->n_keys - t; // Metade das chaves vai para o novo nó
-
-  // Copia as chaves do nó filho para novo nó
-  for (int i = 0; i < new_node->n_keys; i++) {
-    new_node->keys[i] = child->keys[t + i];
-    new_node->values[i] = child->values[t + i];
-
-    // Limpar nó original
-    child->keys[t + i] = -1;
-    child->values[t + i] = -1;
-  }
-
-  // Se não for folha, copia os ponteiros para filhos também
-  if (!child->is_leaf)
-    for (int i = 0; i <= new_node->n_keys; i++) {
-      new_node->children[i] = child->children[t + i];
-
-      // Limpar nó original
-      child->children[t + i] = -1;
-    }
+  new_node->level = child->level;
 
-  // Atualiza o número de chaves no filho
-  child->n_keys = t - 1;
+  // Metade das chaves vai para o novo nó e a do meio sobe para o pai
+  bpool_kernels(pool)->split(parent, idx, child, new_node, order);
+  stats_add(bpool_counters(pool), STATS_SPLITS, 1);
 
-  // Move os ponteiros para filhos no pai para abrir espaço
-  for (int i = parent->n_keys; i > idx; i--)
-    parent->children[i + 1] = parent->children[i];
+  // Os três nós serão escritos no arquivo quando saírem do pool
+  bpool_mark_dirty(pool, child);
+  bpool_mark_dirty(pool, parent);
+  bpool_unpin(pool, new_node, true);
 
-  // Liga o novo nó ao pai
-  parent->children[idx + 1] = new_node->bin_pos;
-
-  // Move as chaves no pai para abrir espaço
-  for (int i = parent->n_keys - 1; i >= idx; i--) {
-    parent->keys[i + 1] = parent->keys[i];
-    parent->values[i + 1] = parent->values[i];
-  }
+  return BTREE_SUCCESS;
+}
 
-  // Insere a chave do meio do filho no pai
-  parent->keys[idx] = child->keys[t - 1];
-  parent->values[idx] = child->values[t - 1];
-  parent->n_keys++;
+/**
+ * Substitui o registro da chave na posição i de um nó e o libera do pool
+ *
+ * @return BTREE_SUCCESS
+ */
+static int node_replace(node_t *node, int i, int value, bpool_t *pool,
+                        bool *replaced, int *old_value) {
+  if (old_value)
+    *old_value = node->values[i];
 
-  child->keys[t - 1] = -1;
-  child->values[t - 1] = -1;
+  node->values[i] = value;
+  *replaced = true;
+  bpool_unpin(pool, node, true);
 
-  node_print(child, stdout);
-  printf("Child position: %ld\n", child->bin_pos);
-  printf("\n");
+  return BTREE_SUCCESS;
+}
 
-  int write_result;
-  write_result = disk_write(fp, child, order);
-  if (write_result < 0) {
-    node_free(new_node);
-    return BTREE_ERROR_IO;
-  }
+/**
+ * Insere uma chave na posição i de uma folha com espaço e a libera do pool
+ *
+ * @return BTREE_SUCCESS
+ */
+static int node_leaf_insert(node_t *node, int i, int key, int value,
+                            bpool_t *pool) {
+  int tail = node->n_keys - i;
 
-  node_print(new_node, stdout);
-  printf("new_node position: %ld\n", new_node->bin_pos);
-  printf("\n");
+  memmove(&node->keys[i + 1], &node->keys[i], tail * sizeof(int));
+  memmove(&node->values[i + 1], &node->values[i], tail * sizeof(int));
 
-  write_result = disk_write(fp, new_node, order);
-  if (write_result < 0) {
-    node_free(new_node);
-    return BTREE_ERROR_IO;
-  }
+  node->keys[i] = key;
+  node->values[i] = value;
+  node->n_keys++;
 
-  node_print(parent, stdout);
-  printf("parent position: %ld\n", parent->bin_pos);
-  printf("\n");
-  write_result = disk_write(fp, parent, order);
-  if (write_result < 0) {
-    node_free(new_node);
-    return BTREE_ERROR_IO;
-  }
+  bpool_unpin(pool, node, true);
 
-  node_free(new_node);
   return BTREE_SUCCESS;
 }
 
 /**
- * Insere uma chave em um nó não cheio
+ * Insere ou atualiza uma chave a partir de um nó não cheio
  *
- * @param node Nó onde inserir
+ * Uma única descida procura a chave e divide os filhos cheios pelo caminho:
+ * se a chave for encontrada em algum nível, só o registro é substituído.
+ * Como os filhos cheios são divididos antes da descida, nenhum nó precisa do
+ * pai depois disso: cada pai é liberado assim que o filho está fixado
+ *
+ * @param node Nó fixado onde inserir, liberado ao final
  * @param key Chave a ser inserida
  * @param order Ordem da árvore
+ * @param replaced Ponteiro para flag indicando se a chave já existia
+ * @param old_value Ponteiro para o registro anterior (pode ser NULL)
  *
  * @return BTREE_SUCCESS em caso de sucesso ou código de erro
  */
 int node_insert_non_full(node_t *node, int key, int value, size_t order,
-                         FILE *fp) {
-  if (!node || !fp)
+                         bpool_t *pool, bool *replaced, int *old_value) {
+  if (!node || !pool || !replaced)
     return BTREE_ERROR_INVALID_PARAM;
 
-  int i = node->n_keys - 1;
-
-  if (node->is_leaf) {
-    // Encontra a posição correta e insere a chave
-    while (i >= 0 && key < node->keys[i]) {
-      node->keys[i + 1] = node->keys[i];
-      node->values[i + 1] = node->values[i];
-      i--;
-    }
-
-    node->keys[i + 1] = key;
-    node->values[i + 1] = value;
-    node->n_keys++;
+  *replaced = false;
 
-    if (disk_write(fp, node, order) < 0)
-      return BTREE_ERROR_IO;
+  // Desce até a folha, dividindo os filhos cheios pelo caminho
+  while (true) {
+    int i = keys_lower_bound(node->keys, node->n_keys, key);
 
-    return BTREE_SUCCESS;
-  } else {
-    // Encontra o filho onde a chave deve ser inserida
-    while (i >= 0 && key < node->keys[i])
-      i--;
+    if (i < node->n_keys && node->keys[i] == key)
+      return node_replace(node, i, value, pool, replaced, old_value);
 
-    i++;
+    if (node->is_leaf)
+      break;
 
     // Carrega filho do disco
-    node_t *child = disk_read(fp, order, node->children[i]);
-    if (!child)
+    node_t *child = bpool_pin(pool, node->children[i]);
+    if (!child) {
+      bpool_unpin(pool, node, false);
       return BTREE_ERROR_IO;
+    }
 
     // Divide o filho, se cheio
     if (child->n_keys == order - 1) {
-      int result = node_split_child(node, i, order, child, fp);
+      int result = node_split_child(node, i, order, child, pool);
       if (result != BTREE_SUCCESS) {
-        node_free(child);
+        bpool_unpin(pool, child, false);
+        bpool_unpin(pool, node, false);
         return result;
       }
 
-      node_t *updated_node = disk_read(fp, order, node->bin_pos);
-      if (!updated_node)
-        return BTREE_ERROR_IO;
-
-      *node = *updated_node;
-      node_free(updated_node);
+      // A chave do meio, que subiu, pode ser a procurada
+      if (node->keys[i] == key) {
+        bpool_unpin(pool, child, false);
+        return node_replace(node, i, value, pool, replaced, old_value);
+      }
 
       // Decide qual dos filhos vai conter a chave
       if (node->keys[i] < key) {
         i++;
-        node_free(child);
-        child = disk_read(fp, order, node->children[i]);
-        if (!child)
+        bpool_unpin(pool, child, false);
+        child = bpool_pin(pool, node->children[i]);
+        if (!child) {
+          bpool_unpin(pool, node, false);
           return BTREE_ERROR_IO;
+        }
       }
     }
 
-    // Insere a chave recursivamente no filho apropriado
-    int result = node_insert_non_full(child, key, value, order, fp);
+    // Continua a inserção no filho apropriado
+    bpool_unpin(pool, node, false);
+    node = child;
+  }
 
-    node_free(child);
-    return result;
+  // A chave não existe: insere na posição encontrada na folha
+  int i = keys_lower_bound(node->keys, node->n_keys, key);
+
+  return node_leaf_insert(node, i, key, value, pool);
+}
+
+/**
+ * Cria a raiz de uma árvore vazia ou divide a raiz cheia, fazendo a árvore
+ * crescer um nível
+ *
+ * Chamada com o latch exclusivo da árvore quando uma inserção devolve
+ * NODE_ROOT_FULL; se outro thread já tiver dividido a raiz, nada é feito
+ *
+ * @param root Ponteiro para a página da raiz (-1 se a árvore estiver vazia)
+ * @param order Ordem da árvore
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int node_grow_root(int *root, size_t order, bpool_t *pool) {
+  if (!root || !pool)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  // Árvore vazia: a raiz começa como uma folha sem chaves
+  if (*root == -1) {
+    node_t *leaf = bpool_new(pool, true);
+    if (!leaf)
+      return BTREE_ERROR_ALLOC;
+
+    *root = leaf->bin_pos;
+    bpool_unpin(pool, leaf, true);
+
+    return BTREE_SUCCESS;
+  }
+
+  node_t *old_root = bpool_pin(pool, *root);
+  if (!old_root)
+    return BTREE_ERROR_IO;
+
+  if (old_root->n_keys < order - 1) {
+    bpool_unpin(pool, old_root, false);
+    return BTREE_SUCCESS;
+  }
+
+  node_t *new_root = bpool_new(pool, false);
+  if (!new_root) {
+    bpool_unpin(pool, old_root, false);
+    return BTREE_ERROR_ALLOC;
+  }
+
+  new_root->children[0] = old_root->bin_pos;
+  new_root->level = old_root->level + 1;
+
+  int result = node_split_child(new_root, 0, order, old_root, pool);
+  if (result == BTREE_SUCCESS) {
+    *root = new_root->bin_pos;
+    stats_add(bpool_counters(pool), STATS_ROOT_SPLITS, 1);
   }
+
+  bpool_unpin(pool, new_root, result == BTREE_SUCCESS);
+  bpool_unpin(pool, old_root, false);
+
+  return result;
 }
 
 /**
  * Insere uma chave na árvore
  *
- * @param root Ponteiro para o ponteiro da raiz
+ * A raiz não é trocada aqui: se a árvore estiver vazia ou a raiz estiver
+ * cheia, nada é alterado e NODE_ROOT_FULL é devolvido para que o chamador
+ * use node_grow_root() e tente de novo
+ *
+ * @param root Ponteiro para a página da raiz (-1 se a árvore estiver vazia)
  * @param key Chave a ser inserida
  * @param order Ordem da árvore
+ * @param replaced Ponteiro para flag indicando se a chave já existia e apenas
+ * teve o registro substituído
+ * @param old_value Ponteiro para o registro anterior (pode ser NULL)
  *
- * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ * @return BTREE_SUCCESS em caso de sucesso, NODE_ROOT_FULL ou código de erro
  */
-int node_insert(node_t **root, int key, int value, size_t order, FILE *fp) {
-  if (!root || !fp)
+int node_insert(int *root, int key, int value, size_t order, bpool_t *pool,
+                bool *replaced, int *old_value) {
+  if (!root || !pool || !replaced)
     return BTREE_ERROR_INVALID_PARAM;
 
-  // Verifica se chave já existe
-  int pos;
-  if (*root) {
-    node_t *found = node_search(*root, key, &pos, fp, order);
-    if (found) {
-      found->values[pos] = value;
-      int result = disk_write(fp, found, order);
-      if (found != *root)
-        node_free(found);
-      return (result < 0) ? BTREE_ERROR_IO : BTREE_SUCCESS;
-    }
+  *replaced = false;
+
+  if (*root == -1)
+    return NODE_ROOT_FULL;
+
+  node_t *node = bpool_pin(pool, *root);
+  if (!node)
+    return BTREE_ERROR_IO;
+
+  // Uma atualização de chave da raiz não precisa dividi-la
+  int i = keys_lower_bound(node->keys, node->n_keys, key);
+  if (i < node->n_keys && node->keys[i] == key)
+    return node_replace(node, i, value, pool, replaced, old_value);
+
+  if (node->n_keys == order - 1) {
+    bpool_unpin(pool, node, false);
+    return NODE_ROOT_FULL;
   }
 
-  // Se a raiz for NULL, cria uma nova raiz
-  if (!(*root)) {
-    // Determina posição do nó no arquivo
-    fseek(fp, 0, SEEK_END);
-    size_t root_pos = ftell(fp) / calculate_offset(1, order);
+  // A raiz continua fixada: outro thread não pode enchê-la antes da descida
+  return node_insert_non_full(node, key, value, order, pool, replaced,
+                              old_value);
+}
 
-    *root = node_create(true, order, root_pos);
-    if (!(*root))
-      return BTREE_ERROR_ALLOC;
+/**
+ * Insere ou atualiza uma sequência ordenada de chaves, começando pela primeira
+ *
+ * A descida segue a primeira chave, dividindo os filhos cheios pelo caminho.
+ * Ao chegar à folha, as chaves seguintes também são aplicadas nela enquanto
+ * houver espaço e elas forem menores que a chave do ancestral que limita a
+ * folha à direita: nenhum ancestral pode conter essas chaves
+ *
+ * @param root Ponteiro para a página da raiz (-1 se a árvore estiver vazia)
+ * @param keys Chaves em ordem crescente, sem repetição
+ * @param values Registros associados às chaves
+ * @param n Quantidade de chaves (pelo menos uma)
+ * @param order Ordem da árvore
+ * @param added Ponteiro para a quantidade de chaves novas
+ *
+ * @return Quantidade de chaves aplicadas, NODE_ROOT_FULL ou código de erro
+ */
+int node_insert_run(int *root, const int *keys, const int *values, size_t n,
+                    size_t order, bpool_t *pool, size_t *added) {
+  if (!root || !keys || !values || n == 0 || !pool || !added)
+    return BTREE_ERROR_INVALID_PARAM;
 
-    (*root)->keys[0] = key;
-    (*root)->values[0] = value;
-    (*root)->n_keys = 1;
+  bool replaced;
+  *added = 0;
 
-    if (disk_write(fp, *root, order) < 0) {
-      node_free(*root);
-      *root = NULL;
+  // Árvore vazia ou raiz cheia: a primeira chave segue o caminho normal
+  node_t *node = *root == -1 ? NULL : bpool_pin(pool, *root);
+  if (!node || node->n_keys == order - 1) {
+    if (node)
+      bpool_unpin(pool, node, false);
+    else if (*root != -1)
       return BTREE_ERROR_IO;
-    }
 
-    return BTREE_SUCCESS;
+    // Sem espaço na raiz, o resultado é NODE_ROOT_FULL
+    int result =
+        node_insert(root, keys[0], values[0], order, pool, &replaced, NULL);
+    *added = !replaced;
+
+    return result == BTREE_SUCCESS ? 1 : result;
   }
 
-  // Se raiz estiver cheia, cria nova raiz
-  if ((*root)->n_keys == order - 1) {
-    // Determina posição arquivo binário
-    fseek(fp, 0, SEEK_END);
-    size_t new_root_pos = ftell(fp) / calculate_offset(1, order);
+  int key = keys[0];
+  bool bounded = false;
+  int hi = 0;
 
-    node_t *new_root = node_create(false, order, new_root_pos);
-    if (!new_root)
-      return BTREE_ERROR_ALLOC;
+  while (true) {
+    int i = keys_lower_bound(node->keys, node->n_keys, key);
 
-    new_root->children[0] = (*root)->bin_pos;
+    if (i < node->n_keys && node->keys[i] == key) {
+      node_replace(node, i, values[0], pool, &replaced, NULL);
+      return 1;
+    }
 
-    int result = node_split_child(new_root, 0, order, *root, fp);
-    if (result != BTREE_SUCCESS) {
-      node_free(new_root);
-      return result;
+    if (node->is_leaf)
+      break;
+
+    node_t *child = bpool_pin(pool, node->children[i]);
+    if (!child) {
+      bpool_unpin(pool, node, false);
+      return BTREE_ERROR_IO;
+    }
+
+    if (child->n_keys == order - 1) {
+      int result = node_split_child(node, i, order, child, pool);
+      if (result != BTREE_SUCCESS) {
+        bpool_unpin(pool, child, false);
+        bpool_unpin(pool, node, false);
+        return result;
+      }
+
+      if (node->keys[i] == key) {
+        bpool_unpin(pool, child, false);
+        node_replace(node, i, values[0], pool, &replaced, NULL);
+        return 1;
+      }
+
+      if (node->keys[i] < key) {
+        i++;
+        bpool_unpin(pool, child, false);
+        child = bpool_pin(pool, node->children[i]);
+        if (!child) {
+          bpool_unpin(pool, node, false);
+          return BTREE_ERROR_IO;
+        }
+      }
+    }
+
+    // A chave à direita do filho limita as chaves que cabem nele
+    if (i < node->n_keys) {
+      hi = node->keys[i];
+      bounded = true;
     }
 
-    node_free(*root);
-    *root = new_root;
+    bpool_unpin(pool, node, false);
+    node = child;
+  }
+
+  // A folha não está cheia: a primeira chave sempre cabe
+  size_t j = 0;
+  while (j < n && (j == 0 || (node->n_keys < order - 1 &&
+                              (!bounded || keys[j] < hi)))) {
+    int i = keys_lower_bound(node->keys, node->n_keys, keys[j]);
+
+    if (i < node->n_keys && node->keys[i] == keys[j]) {
+      node->values[i] = values[j];
+    } else {
+      int tail = node->n_keys - i;
+      memmove(&node->keys[i + 1], &node->keys[i], tail * sizeof(int));
+      memmove(&node->values[i + 1], &node->values[i], tail * sizeof(int));
+
+      node->keys[i] = keys[j];
+      node->values[i] = values[j];
+      node->n_keys++;
+      (*added)++;
+    }
 
-    return node_insert_non_full(*root, key, value, order, fp);
+    j++;
   }
 
-  return node_insert_non_full(*root, key, value, order, fp);
+  bpool_unpin(pool, node, true);
+
+  return j;
 }
 
 /**
@@ -539,11 +719,9 @@ int node_key_idx(node_t *node, int key) {
   if (!node)
     return -1;
 
-  for (int i = 0; i < node->n_keys; i++)
-    if (node->keys[i] == key)
-      return i;
+  int i = keys_lower_bound(node->keys, node->n_keys, key);
 
-  return -1;
+  return i < node->n_keys && node->keys[i] == key ? i : -1;
 }
 
 /**
@@ -552,44 +730,52 @@ int node_key_idx(node_t *node, int key) {
  * @param node Nó contendo a chave
  * @param idx Índice da chave
  * @param pred Ponteiro para armazenar o predecessor
+ * @param value Ponteiro para armazenar o registro do predecessor
  *
  * @return BTREE_SUCCESS em caso de sucesso ou código de erro
  */
-int node_predecessor(node_t *node, int idx, int *pred, FILE *fp, size_t order) {
-  if (!node || !pred || !fp || idx < 0 || idx >= node->n_keys)
+int node_predecessor(node_t *node, int idx, int *pred, int *value,
+                     bpool_t *pool, size_t order) {
+  if (!node || !pred || !value || !pool || idx < 0 || idx >= node->n_keys)
     return BTREE_ERROR_INVALID_PARAM;
 
   if (node->is_leaf)
     return BTREE_ERROR_INVALID_PARAM;
 
   // Vai para o filho à esquerda da chave
-  node_t *curr = disk_read(fp, order, node->children[idx]);
+  node_t *curr = bpool_pin(pool, node->children[idx]);
   if (!curr)
     return BTREE_ERROR_IO;
 
+  // Com ordem 3 (t = 1) nós vazios são válidos: o predecessor é a última chave
+  // do nó não vazio mais profundo no caminho mais à direita
+  bool found = false;
+
   // Desce até o elemento mais à direita (maior valor)
-  while (!curr->is_leaf) {
+  while (true) {
+    if (curr->n_keys > 0) {
+      *pred = curr->keys[curr->n_keys - 1];
+      *value = curr->values[curr->n_keys - 1];
+      found = true;
+    }
+
+    if (curr->is_leaf)
+      break;
+
     if (curr->children[curr->n_keys] == -1) {
-      node_free(curr);
+      bpool_unpin(pool, curr, false);
       return BTREE_ERROR_INVALID_PARAM;
     }
 
-    node_t *next = disk_read(fp, order, curr->children[curr->n_keys]);
-    node_free(curr);
+    node_t *next = bpool_pin(pool, curr->children[curr->n_keys]);
+    bpool_unpin(pool, curr, false);
     if (!next)
       return BTREE_ERROR_IO;
     curr = next;
   }
 
-  if (curr->n_keys <= 0) {
-    node_free(curr);
-    return BTREE_ERROR_INVALID_PARAM;
-  }
-
-  *pred = curr->keys[curr->n_keys - 1];
-
-  node_free(curr);
-  return BTREE_SUCCESS;
+  bpool_unpin(pool, curr, false);
+  return found ? BTREE_SUCCESS : BTREE_ERROR_INVALID_PARAM;
 }
 
 /**
@@ -598,44 +784,51 @@ int node_predecessor(node_t *node, int idx, int *pred, FILE *fp, size_t order) {
  * @param node Nó contendo a chave
  * @param idx Índice da chave
  * @param succ Ponteiro para armazenar o sucessor
+ * @param value Ponteiro para armazenar o registro do sucessor
  *
  * @return BTREE_SUCCESS em caso de sucesso ou código de erro
  */
-int node_successor(node_t *node, int idx, int *succ, FILE *fp, size_t order) {
-  if (!node || !succ || !fp || idx < 0 || idx >= node->n_keys)
+int node_successor(node_t *node, int idx, int *succ, int *value,
+                   bpool_t *pool, size_t order) {
+  if (!node || !succ || !value || !pool || idx < 0 || idx >= node->n_keys)
     return BTREE_ERROR_INVALID_PARAM;
 
   if (node->is_leaf)
     return BTREE_ERROR_INVALID_PARAM;
 
   // Vai para o filho à direita da chave
-  node_t *curr = disk_read(fp, order, node->children[idx + 1]);
+  node_t *curr = bpool_pin(pool, node->children[idx + 1]);
   if (!curr)
     return BTREE_ERROR_IO;
 
+  // Assim como no predecessor, nós vazios no caminho são ignorados
+  bool found = false;
+
   // Desce até o elemento mais à esquerda (menor valor)
-  while (!curr->is_leaf) {
+  while (true) {
+    if (curr->n_keys > 0) {
+      *succ = curr->keys[0];
+      *value = curr->values[0];
+      found = true;
+    }
+
+    if (curr->is_leaf)
+      break;
+
     if (curr->children[0] == -1) {
-      node_free(curr);
+      bpool_unpin(pool, curr, false);
       return BTREE_ERROR_INVALID_PARAM;
     }
 
-    node_t *next = disk_read(fp, order, curr->children[0]);
-    node_free(curr);
+    node_t *next = bpool_pin(pool, curr->children[0]);
+    bpool_unpin(pool, curr, false);
     if (!next)
       return BTREE_ERROR_IO;
     curr = next;
   }
 
-  if (curr->n_keys <= 0) {
-    node_free(curr);
-    return BTREE_ERROR_INVALID_PARAM;
-  }
-
-  *succ = curr->keys[0];
-
-  node_free(curr);
-  return BTREE_SUCCESS;
+  bpool_unpin(pool, curr, false);
+  return found ? BTREE_SUCCESS : BTREE_ERROR_INVALID_PARAM;
 }
 
 /**
@@ -647,75 +840,32 @@ int node_successor(node_t *node, int idx, int *succ, FILE *fp, size_t order) {
  *
  * @return BTREE_SUCCESS em caso de sucesso ou código de erro
  */
-int node_merge(node_t *parent, int idx, size_t order, FILE *fp) {
-  if (!parent || !fp || idx < 0 || idx >= parent->n_keys)
+int node_merge(node_t *parent, int idx, size_t order, bpool_t *pool) {
+  if (!parent || !pool || idx < 0 || idx >= parent->n_keys)
     return BTREE_ERROR_INVALID_PARAM;
 
-  node_t *l_child = disk_read(fp, order, parent->children[idx]);
+  node_t *l_child = bpool_pin(pool, parent->children[idx]);
   if (!l_child)
     return BTREE_ERROR_IO;
 
-  node_t *r_child = disk_read(fp, order, parent->children[idx + 1]);
+  node_t *r_child = bpool_pin(pool, parent->children[idx + 1]);
   if (!r_child) {
-    node_free(l_child);
+    bpool_unpin(pool, l_child, false);
     return BTREE_ERROR_IO;
   }
 
-  int t = ceil(order / 2.0);
-
-  // Move a chave do pai para o filho à esquerda
-  l_child->keys[l_child->n_keys] = parent->keys[idx];
-  l_child->values[l_child->n_keys] = parent->values[idx];
-
-  // Move todas as chaves do filho à direita para o filho à esquerda
-  for (int i = 0; i < r_child->n_keys; i++) {
-    l_child->keys[l_child->n_keys + 1 + i] = r_child->keys[i];
-    l_child->values[l_child->n_keys + 1 + i] = r_child->values[i];
-  }
+  // A chave do pai e as do filho à direita vão para o filho à esquerda
+  bpool_kernels(pool)->merge(parent, idx, l_child, r_child, order);
+  stats_add(bpool_counters(pool), STATS_MERGES, 1);
 
-  // Move também ponteiros para filhos, se não for folha
-  if (!l_child->is_leaf)
-    for (int i = 0; i <= r_child->n_keys; i++)
-      l_child->children[l_child->n_keys + 1 + i] = r_child->children[i];
+  bpool_mark_dirty(pool, parent);
+  bpool_unpin(pool, l_child, true);
 
-  // Atualiza número de chaves filho à esquerda
-  l_child->n_keys += r_child->n_keys + 1;
+  // O filho à direita foi absorvido: sua página volta para a lista livre
+  bpool_free(pool, r_child);
 
-  // Remove chave do pai e ajusta ponteiros
-  for (int i = idx; i < parent->n_keys - 1; i++) {
-    parent->keys[i] = parent->keys[i + 1];
-    parent->values[i] = parent->values[i + 1];
-  }
-
-  for (int i = idx + 1; i < parent->n_keys; i++)
-    parent->children[i] = parent->children[i + 1];
-
-  parent->keys[parent->n_keys - 1] = -1;
-  parent->values[parent->n_keys - 1] = -1;
-  parent->children[parent->n_keys] = -1;
-  parent->n_keys--;
-
-  int r_child_pos = r_child->bin_pos;
-
-  int result = disk_write(fp, l_child, order);
-  if (result < 0) {
-    node_free(l_child);
-    node_free(r_child);
-    return BTREE_ERROR_IO;
-  }
-
-  result = disk_write(fp, parent, order);
-  if (result < 0) {
-    node_free(l_child);
-    node_free(r_child);
-    return BTREE_ERROR_IO;
-  }
-
-  node_free(l_child);
-  node_free(r_child);
-
-  return BTREE_SUCCESS;
-}
+  return BTREE_SUCCESS;
+}
 
 /**
  * Remove uma chave de um nó folha
@@ -725,8 +875,8 @@ int node_merge(node_t *parent, int idx, size_t order, FILE *fp) {
  *
  * @return BTREE_SUCCESS em caso de sucesso ou código de erro
  */
-int node_remove_from_leaf(node_t *node, int idx, FILE *fp, size_t order) {
-  if (!node || !fp || idx < 0 || idx >= node->n_keys)
+int node_remove_from_leaf(node_t *node, int idx, bpool_t *pool, size_t order) {
+  if (!node || !pool || idx < 0 || idx >= node->n_keys)
     return BTREE_ERROR_INVALID_PARAM;
 
   // Move todas as chaves à frente de node->keys[idx] uma posição para trás
@@ -739,121 +889,96 @@ int node_remove_from_leaf(node_t *node, int idx, FILE *fp, size_t order) {
   node->values[node->n_keys - 1] = -1;
   node->n_keys--;
 
-  if (disk_write(fp, node, order) < 0)
-    return BTREE_ERROR_IO;
+  bpool_mark_dirty(pool, node);
 
   return BTREE_SUCCESS;
 }
 
-/**
- * Remove uma chave da árvore
- *
- * @param node Raiz da subárvore onde buscar e remover
- * @param key Chave a ser removida
- * @param order Ordem da árvore
- *
- * @return BTREE_SUCCESS em caso de sucesso ou código de erro
- */
-int node_remove(node_t *node, int key, size_t order, FILE *fp);
-
 /**
  * Remove uma chave de um nó interno
  *
+ * A remoção continua em um dos filhos do nó: a página e a chave a serem
+ * removidas em seguida são devolvidas em next_page e next_key
+ *
  * @param node Nó de onde remover
  * @param idx Índice da chave
  * @param order Ordem da chave
+ * @param next_page Ponteiro para a página onde a remoção continua
+ * @param next_key Ponteiro para a chave que deve ser removida a seguir
  *
  * @return BTREE_SUCCESS em caso de sucesso ou código de erro
  */
-int node_remove_from_internal(node_t *node, int idx, size_t order, FILE *fp) {
-  if (!node || !fp || idx < 0 || idx >= node->n_keys)
+int node_remove_from_internal(node_t *node, int idx, size_t order,
+                              bpool_t *pool, int *next_page, int *next_key) {
+  if (!node || !pool || idx < 0 || idx >= node->n_keys)
     return BTREE_ERROR_INVALID_PARAM;
 
   int key = node->keys[idx];
-  int t = ceil(order / 2.0);
+  int t = node_min_degree(order);
 
   // Carrega filho esquerdo
-  node_t *left_child = disk_read(fp, order, node->children[idx]);
+  node_t *left_child = bpool_pin(pool, node->children[idx]);
   if (!left_child)
     return BTREE_ERROR_IO;
 
   // Caso 2a: O filho à esquerda tem pelo menos t chaves
   if (left_child->n_keys >= t) {
-    int pred;
-    int result = node_predecessor(node, idx, &pred, fp, order);
-    node_free(left_child);
+    int pred, value;
+    int result = node_predecessor(node, idx, &pred, &value, pool, order);
+    bpool_unpin(pool, left_child, false);
 
     if (result != BTREE_SUCCESS)
       return result;
 
     node->keys[idx] = pred;
-    node->values[idx] = pred;
+    node->values[idx] = value;
+    bpool_mark_dirty(pool, node);
 
-    // Atualiza nó na memória
-    result = disk_write(fp, node, order);
-    if (result < 0)
-      return BTREE_ERROR_IO;
-
-    node_t *child = disk_read(fp, order, node->children[idx]);
-    if (!child)
-      return BTREE_ERROR_IO;
-
-    result = node_remove(child, pred, order, fp);
-    node_free(child);
-    return result;
+    *next_page = node->children[idx];
+    *next_key = pred;
+    return BTREE_SUCCESS;
   }
 
-  node_free(left_child);
+  bpool_unpin(pool, left_child, false);
 
-  node_t *right_child = disk_read(fp, order, node->children[idx + 1]);
+  node_t *right_child = bpool_pin(pool, node->children[idx + 1]);
   if (!right_child)
     return BTREE_ERROR_IO;
 
   // Caso 2b: O filho à direita tem pelo menos t chaves
   if (right_child->n_keys >= t) {
-    int succ;
-    int result = node_successor(node, idx, &succ, fp, order);
-    node_free(right_child);
+    int succ, value;
+    int result = node_successor(node, idx, &succ, &value, pool, order);
+    bpool_unpin(pool, right_child, false);
 
     if (result != BTREE_SUCCESS)
       return result;
 
     node->keys[idx] = succ;
-    node->values[idx] = succ;
-
-    result = disk_write(fp, node, order);
-    if (result < 0)
-      return BTREE_ERROR_IO;
+    node->values[idx] = value;
+    bpool_mark_dirty(pool, node);
 
-    node_t *child = disk_read(fp, order, node->children[idx + 1]);
-    if (!child)
-      return BTREE_ERROR_IO;
-
-    result = node_remove(child, succ, order, fp);
-    node_free(child);
-    return result;
+    *next_page = node->children[idx + 1];
+    *next_key = succ;
+    return BTREE_SUCCESS;
   }
 
-  node_free(right_child);
+  bpool_unpin(pool, right_child, false);
 
   // Caso 2c: Ambos os filhos têm menos de t chaves
 
   // Mescla os filhos e depois remove a chave do filho mesclado
-  int result = node_merge(node, idx, order, fp);
+  int result = node_merge(node, idx, order, pool);
   if (result != BTREE_SUCCESS)
     return result;
 
-  node_t *child = disk_read(fp, order, node->children[idx]);
-  if (!child)
-    return BTREE_ERROR_IO;
-
-  result = node_remove(child, key, order, fp);
-  node_free(child);
-  return result;
+  *next_page = node->children[idx];
+  *next_key = key;
+  return BTREE_SUCCESS;
 }
 
 /**
- * Garante que o filho na posição idx tenha pelo menos ⌈order/2⌉ - 1 chaves
+ * Garante que o filho na posição idx tenha pelo menos t chaves
  *
  * @param node Nó pai
  * @param idx Índice do filho
@@ -861,218 +986,138 @@ int node_remove_from_internal(node_t *node, int idx, size_t order, FILE *fp) {
  *
  * @return BTREE_SUCCESS em caso de sucesso ou código de erro
  */
-int node_ensure_min_keys(node_t *node, int idx, size_t order, FILE *fp) {
-  if (!node || !fp || idx < 0 || idx > node->n_keys)
+int node_ensure_min_keys(node_t *node, int idx, size_t order, bpool_t *pool) {
+  if (!node || !pool || idx < 0 || idx > node->n_keys)
     return BTREE_ERROR_INVALID_PARAM;
 
-  node_t *child = disk_read(fp, order, node->children[idx]);
+  // Raiz esvaziada por uma mescla de outro thread, ainda não trocada pelo
+  // filho em btree_collapse(): o filho único não tem irmão para emprestar
+  if (node->n_keys == 0)
+    return BTREE_SUCCESS;
+
+  node_t *child = bpool_pin(pool, node->children[idx]);
   if (!child)
     return BTREE_ERROR_IO;
 
-  int t = ceil(order / 2.0);
+  int t = node_min_degree(order);
 
   if (child->n_keys >= t) {
-    node_free(child);
+    bpool_unpin(pool, child, false);
     return BTREE_SUCCESS;
   }
 
   // Caso 3a-esq: Empresta uma chave do irmão à esquerda
   if (idx > 0) {
-    node_t *l_sibling = disk_read(fp, order, node->children[idx - 1]);
+    node_t *l_sibling = bpool_pin(pool, node->children[idx - 1]);
     if (!l_sibling) {
-      node_free(child);
+      bpool_unpin(pool, child, false);
       return BTREE_ERROR_IO;
     }
 
     if (l_sibling->n_keys >= t) {
-      // Move todas as chaves uma posição para a direita
-      for (int i = child->n_keys - 1; i >= 0; i--) {
-        child->keys[i + 1] = child->keys[i];
-        child->values[i + 1] = child->values[i];
-      }
-
-      if (!child->is_leaf)
-        for (int i = child->n_keys; i >= 0; i--)
-          child->children[i + 1] = child->children[i];
-
-      child->keys[0] = node->keys[idx - 1];
-      child->values[0] = node->values[idx - 1];
-
-      // O primeiro filho recebe o último filho do pai, se não for folha
-      if (!child->is_leaf)
-        child->children[0] = l_sibling->children[l_sibling->n_keys];
-
-      node->keys[idx - 1] = l_sibling->keys[l_sibling->n_keys - 1];
-      node->values[idx - 1] = l_sibling->values[l_sibling->n_keys - 1];
+      bpool_kernels(pool)->borrow_left(node, idx, child, l_sibling, order);
+      stats_add(bpool_counters(pool), STATS_BORROWS_LEFT, 1);
 
-      // Limpa vetores no irmão
-      l_sibling->keys[l_sibling->n_keys - 1] = -1;
-      l_sibling->values[l_sibling->n_keys - 1] = -1;
-      if (!l_sibling->is_leaf)
-        l_sibling->children[l_sibling->n_keys] = -1;
-
-      child->n_keys++;
-      l_sibling->n_keys--;
-
-      int result = disk_write(fp, child, order);
-      if (result < 0) {
-        node_free(child);
-        node_free(l_sibling);
-        return BTREE_ERROR_IO;
-      }
-
-      result = disk_write(fp, l_sibling, order);
-      if (result < 0) {
-        node_free(child);
-        node_free(l_sibling);
-        return BTREE_ERROR_IO;
-      }
-
-      result = disk_write(fp, node, order);
-      if (result < 0) {
-        node_free(child);
-        node_free(l_sibling);
-        return BTREE_ERROR_IO;
-      }
-
-      node_free(child);
-      node_free(l_sibling);
+      bpool_mark_dirty(pool, node);
+      bpool_unpin(pool, child, true);
+      bpool_unpin(pool, l_sibling, true);
       return BTREE_SUCCESS;
     }
 
-    node_free(l_sibling);
+    bpool_unpin(pool, l_sibling, false);
   }
 
   // Caso 3a-dir: Empresta uma chave do irmão à direita
   if (idx < node->n_keys) {
     // Carrega o irmão direito
-    node_t *r_sibling = disk_read(fp, order, node->children[idx + 1]);
+    node_t *r_sibling = bpool_pin(pool, node->children[idx + 1]);
     if (!r_sibling) {
-      node_free(child);
+      bpool_unpin(pool, child, false);
       return BTREE_ERROR_IO;
     }
 
     if (r_sibling->n_keys >= t) {
-      // Última chave do filho recebe chave do pai
-      child->keys[child->n_keys] = node->keys[idx];
-      child->values[child->n_keys] = node->values[idx];
-
-      // Se não for folha, também recebe o filho
-      if (!child->is_leaf)
-        child->children[child->n_keys + 1] = r_sibling->children[0];
-
-      // Pai recebe primeira chave de r_sibling
-      node->keys[idx] = r_sibling->keys[0];
-      node->values[idx] = r_sibling->values[0];
-
-      // Move as chaves no irmão
-      for (int i = 1; i < r_sibling->n_keys; i++) {
-        r_sibling->keys[i - 1] = r_sibling->keys[i];
-        r_sibling->values[i - 1] = r_sibling->values[i];
-      }
-
-      // Move também ponteiros para filhos, se não for folha
-      if (!r_sibling->is_leaf)
-        for (int i = 1; i <= r_sibling->n_keys; i++)
-          r_sibling->children[i - 1] = r_sibling->children[i];
-
-      // Limpa valores no irmão
-      r_sibling->keys[r_sibling->n_keys - 1] = -1;
-      r_sibling->values[r_sibling->n_keys - 1] = -1;
-      if (!r_sibling->is_leaf)
-        r_sibling->children[r_sibling->n_keys] = -1;
-
-      child->n_keys++;
-      r_sibling->n_keys--;
-
-      // Escreve as alterações em disco
-      int result = disk_write(fp, child, order);
-      if (result < 0) {
-        node_free(child);
-        node_free(r_sibling);
-        return BTREE_ERROR_IO;
-      }
-
-      result = disk_write(fp, r_sibling, order);
-      if (result < 0) {
-        node_free(child);
-        node_free(r_sibling);
-        return BTREE_ERROR_IO;
-      }
-
-      result = disk_write(fp, node, order);
-      if (result < 0) {
-        node_free(child);
-        node_free(r_sibling);
-        return BTREE_ERROR_IO;
-      }
+      bpool_kernels(pool)->borrow_right(node, idx, child, r_sibling, order);
+      stats_add(bpool_counters(pool), STATS_BORROWS_RIGHT, 1);
 
-      node_free(child);
-      node_free(r_sibling);
+      bpool_mark_dirty(pool, node);
+      bpool_unpin(pool, child, true);
+      bpool_unpin(pool, r_sibling, true);
       return BTREE_SUCCESS;
     }
 
-    node_free(r_sibling);
+    bpool_unpin(pool, r_sibling, false);
   }
 
   // Caso 3b: Mescla com um irmão
-  node_free(child);
+  bpool_unpin(pool, child, false);
 
   if (idx < node->n_keys)
-    return node_merge(node, idx, order, fp);
+    return node_merge(node, idx, order, pool);
   else
-    return node_merge(node, idx - 1, order, fp);
+    return node_merge(node, idx - 1, order, pool);
 }
 
-int node_remove(node_t *node, int key, size_t order, FILE *fp) {
-  if (!node || !fp)
+/**
+ * Remove uma chave da árvore
+ *
+ * @param page Página da raiz da subárvore onde buscar e remover
+ * @param key Chave a ser removida
+ * @param order Ordem da árvore
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int node_remove(int page, int key, size_t order, bpool_t *pool) {
+  if (!pool || page == -1)
     return BTREE_ERROR_NOT_FOUND;
 
-  int idx = 0;
-  while (idx < node->n_keys && key > node->keys[idx])
-    idx++;
+  node_t *node = bpool_pin(pool, page);
 
-  // Casos 1 e 2
-  if (idx < node->n_keys && key == node->keys[idx]) {
-    // Caso 1: Nó folha -> simplesmente remove chave
-    if (node->is_leaf)
-      return node_remove_from_leaf(node, idx, fp, order);
-    // Casos 2
-    else
-      return node_remove_from_internal(node, idx, order, fp);
-  }
+  while (node) {
+    int idx = keys_lower_bound(node->keys, node->n_keys, key);
+    int result;
 
-  // Se for nó folha, chave não está na árvore
-  if (node->is_leaf)
-    return BTREE_ERROR_NOT_FOUND;
+    if (idx < node->n_keys && key == node->keys[idx]) {
+      // Caso 1: Nó folha -> simplesmente remove chave
+      if (node->is_leaf) {
+        result = node_remove_from_leaf(node, idx, pool, order);
+        bpool_unpin(pool, node, false);
+        return result;
+      }
 
-  bool is_last = idx == node->n_keys;
+      // Casos 2: a remoção continua em um dos filhos
+      result = node_remove_from_internal(node, idx, order, pool, &page, &key);
+    } else {
+      // Se for nó folha, chave não está na árvore
+      if (node->is_leaf) {
+        bpool_unpin(pool, node, false);
+        return BTREE_ERROR_NOT_FOUND;
+      }
 
-  // Garantir que o filho onde a busca continua tenha pelo menos ⌈order/2⌉
-  // chaves
-  int result = node_ensure_min_keys(node, idx, order, fp);
-  if (result != BTREE_SUCCESS)
-    return result;
+      bool is_last = idx == node->n_keys;
 
-  node_t *updated_node = disk_read(fp, order, node->bin_pos);
-  if (!updated_node)
-    return BTREE_ERROR_IO;
+      // Garantir que o filho onde a busca continua tenha pelo menos t chaves
+      result = node_ensure_min_keys(node, idx, order, pool);
 
-  if (is_last && idx > updated_node->n_keys)
-    idx--;
+      if (is_last && idx > node->n_keys)
+        idx--;
 
-  node_t *child = disk_read(fp, order, updated_node->children[idx]);
-  if (!child) {
-    node_free(updated_node);
-    return BTREE_ERROR_IO;
-  }
+      page = node->children[idx];
+    }
 
-  result = node_remove(child, key, order, fp);
+    if (result != BTREE_SUCCESS) {
+      bpool_unpin(pool, node, false);
+      return result;
+    }
 
-  node_free(child);
-  node_free(updated_node);
+    // O filho já tem chaves de sobra e não precisa mais do pai: ele é
+    // fixado antes de o pai ser liberado (latch coupling)
+    node_t *child = bpool_pin(pool, page);
+    bpool_unpin(pool, node, false);
+    node = child;
+  }
 
-  return result;
+  return BTREE_ERROR_IO;
 }
 
 void node_print(node_t *node, FILE *output_fptr) {
@@ -1089,129 +1134,2010 @@ void node_print(node_t *node, FILE *output_fptr) {
 }
 
 struct btree {
-  size_t order;   // Ordem da árvore
-  node_t *root;   // Ponteiro para o nó raiz
-  size_t n_nodes; // Número de nós na árvore
-  FILE *fp;       // Ponteiro para o arquivo
+  size_t order;  // Ordem da árvore
+  bool bplus;    // Flag indicando o formato B+
+  int root;      // Página do nó raiz ou -1 se a árvore estiver vazia
+  size_t n_keys; // Número de chaves na árvore
+  storage_t *st; // Arquivo binário
+  bpool_t *pool; // Buffer pool na frente do arquivo
+
+  stats_t *counters; // Contadores de operações e de E/S
+
+  wal_t *wal;            // Log de redo ou NULL
+  size_t wal_checkpoint; // Tamanho do log que dispara um checkpoint
+
+  // Contador de alterações, incrementado no início e no fim de cada escrita;
+  // usado para revalidar cursores e buscas em lote
+  size_t version;
+  size_t writers; // Escritas em andamento
+
+  // Compartilhado pelas operações pontuais, que se coordenam pelos latches
+  // das páginas; exclusivo para trocar a raiz, nos cursores, na carga em lote
+  // e na gravação das páginas
+  pthread_rwlock_t latch;
+
+  // Com o log de redo, serializa as escritas: um registro do log contém as
+  // páginas de uma única operação
+  pthread_mutex_t wal_lock;
 };
 
+typedef struct cursor_frame {
+  int page; // Página do nó
+  int idx;  // Chave atual no topo da pilha; filho percorrido nos demais
+} cursor_frame_t;
+
+struct btree_cursor {
+  btree_t *tree; // Árvore percorrida
+
+  cursor_frame_t *path; // Caminho da raiz até o nó da chave atual
+  size_t depth;         // Quantidade de nós no caminho
+  size_t capacity;      // Capacidade de path
+
+  bool valid;     // Flag indicando se o cursor está sobre uma chave
+  int key;        // Chave atual
+  int value;      // Registro da chave atual
+  size_t version; // Versão da árvore quando o caminho foi montado
+
+  // B+: leitura antecipada das folhas a partir do nó interno acima delas
+  int ra_parent;   // Nó cujos filhos são antecipados ou -1
+  int ra_next;     // Próximo filho de ra_parent a antecipar
+  int ra_left;     // Folhas antecipadas ainda não alcançadas pelo percurso
+  bool ra_forward; // Sentido da leitura antecipada
+};
+
+// Filhos antecipados de uma vez pelos cursores
+#define CURSOR_READAHEAD 16
+
+/**
+ * Copia a raiz e a quantidade de chaves para o superbloco mantido pelo pool
+ *
+ * @param tree Ponteiro para árvore B
+ */
+static void btree_sync_superblock(btree_t *tree) {
+  disk_superblock_t *sb = bpool_superblock(tree->pool);
+
+  sb->root = tree->root;
+  sb->n_keys = __atomic_load_n(&tree->n_keys, __ATOMIC_RELAXED);
+}
+
+/**
+ * Encerra uma operação de escrita: registra as páginas alteradas no log de
+ * redo e faz um checkpoint quando o log passa do limite configurado
+ *
+ * @param tree Ponteiro para árvore B
+ * @param result Resultado da operação
+ *
+ * @return result ou o código de erro do log
+ */
+static int btree_commit(btree_t *tree, int result) {
+  __atomic_add_fetch(&tree->version, 1, __ATOMIC_SEQ_CST);
+
+  if (!tree->wal)
+    return result;
+
+  btree_sync_superblock(tree);
+
+  if (bpool_commit(tree->pool) != BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
+
+  if (bpool_wal_size(tree->pool) >= tree->wal_checkpoint &&
+      bpool_flush(tree->pool) != BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
+
+  return result;
+}
+
+/**
+ * Grava as páginas alteradas e o superbloco no arquivo
+ *
+ * @param tree Ponteiro para árvore B
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+static int btree_checkpoint(btree_t *tree) {
+  btree_sync_superblock(tree);
+
+  return bpool_flush(tree->pool);
+}
+
+/**
+ * Obtém o latch exclusivo da árvore, sem nenhuma outra operação em andamento
+ *
+ * @param tree Ponteiro para árvore B
+ */
+static void btree_lock(btree_t *tree) {
+  if (tree->wal)
+    pthread_mutex_lock(&tree->wal_lock);
+
+  pthread_rwlock_wrlock(&tree->latch);
+}
+
+static void btree_unlock(btree_t *tree) {
+  pthread_rwlock_unlock(&tree->latch);
+
+  if (tree->wal)
+    pthread_mutex_unlock(&tree->wal_lock);
+}
+
+/**
+ * Inicia uma escrita pontual com o latch compartilhado da árvore
+ *
+ * O wal_lock é obtido antes do latch: uma escrita esperando por ele não
+ * segura o latch e não impede a troca de raiz da escrita em andamento
+ *
+ * @param tree Ponteiro para árvore B
+ */
+static void btree_write_begin(btree_t *tree) {
+  if (tree->wal)
+    pthread_mutex_lock(&tree->wal_lock);
+
+  pthread_rwlock_rdlock(&tree->latch);
+  __atomic_add_fetch(&tree->writers, 1, __ATOMIC_SEQ_CST);
+  __atomic_add_fetch(&tree->version, 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Efetiva e encerra uma escrita iniciada por btree_write_begin()
+ *
+ * @return result ou o código de erro do log
+ */
+static int btree_write_end(btree_t *tree, int result) {
+  result = btree_commit(tree, result);
+
+  __atomic_sub_fetch(&tree->writers, 1, __ATOMIC_SEQ_CST);
+  pthread_rwlock_unlock(&tree->latch);
+
+  if (tree->wal)
+    pthread_mutex_unlock(&tree->wal_lock);
+
+  return result;
+}
+
+/**
+ * Cria ou divide a raiz no meio de uma escrita, trocando o latch
+ * compartilhado da árvore pelo exclusivo
+ *
+ * O latch é liberado antes da troca: outra escrita pode dividir a raiz nesse
+ * intervalo, e a operação que pediu a troca deve ser repetida
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+static int btree_grow(btree_t *tree) {
+  pthread_rwlock_unlock(&tree->latch);
+  pthread_rwlock_wrlock(&tree->latch);
+
+  int result = tree->bplus
+                   ? bplus_grow_root(&tree->root, tree->order, tree->pool)
+                   : node_grow_root(&tree->root, tree->order, tree->pool);
+
+  pthread_rwlock_unlock(&tree->latch);
+  pthread_rwlock_rdlock(&tree->latch);
+
+  return result;
+}
+
+/**
+ * Se uma mescla deixou a raiz interna sem chaves, substitui-a pelo seu único
+ * filho, trocando o latch compartilhado da árvore pelo exclusivo
+ *
+ * Em ordens pequenas o filho também pode ter ficado sem chaves, e a troca se
+ * repete até a raiz ser uma folha ou ter chaves
+ */
+static void btree_collapse(btree_t *tree) {
+  node_t *root = bpool_pin_shared(tree->pool, tree->root);
+  bool empty = root && !root->is_leaf && root->n_keys == 0;
+  bpool_unpin(tree->pool, root, false);
+
+  if (!empty)
+    return;
+
+  pthread_rwlock_unlock(&tree->latch);
+  pthread_rwlock_wrlock(&tree->latch);
+
+  // Outra remoção pode ter feito a troca no intervalo
+  root = bpool_pin(tree->pool, tree->root);
+  while (root && !root->is_leaf && root->n_keys == 0) {
+    tree->root = root->children[0];
+    bpool_free(tree->pool, root);
+    root = bpool_pin(tree->pool, tree->root);
+  }
+
+  if (root)
+    bpool_unpin(tree->pool, root, false);
+
+  pthread_rwlock_unlock(&tree->latch);
+  pthread_rwlock_rdlock(&tree->latch);
+}
+
+void btree_options_init(btree_options_t *opts) {
+  if (!opts)
+    return;
+
+  opts->page_size = BTREE_PAGE_4K;
+  opts->layout = BTREE_LAYOUT_BTREE;
+  opts->pool_pages = BTREE_DEFAULT_POOL_PAGES;
+  opts->backend = BTREE_BACKEND_PREAD;
+  opts->mmap_reserve = BTREE_DEFAULT_MMAP_RESERVE;
+  opts->mmap_chunk = BTREE_DEFAULT_MMAP_CHUNK;
+  opts->mmap_sync = false;
+  opts->io_engine = BTREE_IO_SYNC;
+  opts->io_depth = BTREE_DEFAULT_IO_DEPTH;
+  opts->wal = false;
+  opts->durability = BTREE_DURABILITY_FLUSH;
+  opts->wal_group_ops = BTREE_DEFAULT_WAL_GROUP_OPS;
+  opts->wal_checkpoint = BTREE_DEFAULT_WAL_CHECKPOINT;
+}
+
 btree_t *btree_create(size_t order, const char *filename, const char *mode) {
-  if (order < 3 || !filename || !mode)
+  return btree_create_ex(order, filename, mode, NULL);
+}
+
+btree_t *btree_create_ex(size_t order, const char *filename, const char *mode,
+                         const btree_options_t *opts) {
+  if (!filename || !mode)
+    return NULL;
+
+  btree_options_t defaults;
+  if (!opts) {
+    btree_options_init(&defaults);
+    opts = &defaults;
+  }
+
+  size_t max_order = btree_max_order(opts->page_size, opts->layout);
+  if (order == BTREE_ORDER_AUTO)
+    order = max_order;
+
+  if (order < 3 || order > max_order)
     return NULL;
 
   btree_t *tree = malloc(sizeof(btree_t));
   if (!tree)
     return NULL;
 
-  tree->fp = fopen(filename, mode);
-  if (!tree->fp) {
+  tree->counters = stats_create();
+  if (!tree->counters) {
+    free(tree);
+    return NULL;
+  }
+
+  tree->st = storage_open(filename, mode, opts, tree->counters);
+  if (!tree->st) {
+    stats_destroy(tree->counters);
+    free(tree);
+    return NULL;
+  }
+
+  tree->wal = NULL;
+  tree->wal_checkpoint = opts->wal_checkpoint;
+  if (opts->wal) {
+    // O log acompanha o arquivo: é descartado quando o arquivo é truncado
+    tree->wal = wal_open(filename, mode[0] == 'w', opts, opts->page_size,
+                         tree->counters);
+    if (!tree->wal) {
+      storage_close(tree->st);
+      stats_destroy(tree->counters);
+      free(tree);
+      return NULL;
+    }
+  }
+
+  // Kernels compilados para a ordem, se houver, ou a versão genérica
+  tree->pool =
+      bpool_create(tree->st, tree->wal, order, opts->layout,
+                   node_kernels_for(order), opts->pool_pages, tree->counters);
+  if (!tree->pool) {
+    wal_close(tree->wal);
+    storage_close(tree->st);
+    stats_destroy(tree->counters);
     free(tree);
     return NULL;
   }
 
+  // Em um arquivo existente, a raiz é recuperada do superbloco
+  const disk_superblock_t *sb = bpool_superblock(tree->pool);
+
   tree->order = order;
-  tree->root = NULL;
-  tree->n_nodes = 0;
+  tree->bplus = opts->layout == BTREE_LAYOUT_BPLUS;
+  tree->root = sb->root;
+  tree->n_keys = sb->n_keys;
+  tree->version = 0;
+  tree->writers = 0;
+
+  node_latch_init(&tree->latch);
+  pthread_mutex_init(&tree->wal_lock, NULL);
 
   return tree;
 }
 
+btree_t *btree_open(const char *filename, const btree_options_t *opts) {
+  if (!filename)
+    return NULL;
+
+  btree_options_t o;
+  if (opts)
+    o = *opts;
+  else
+    btree_options_init(&o);
+
+  // Lê apenas o início do superbloco para descobrir ordem e tamanho de página
+  FILE *fp = fopen(filename, "rb");
+  if (!fp)
+    return NULL;
+
+  disk_superblock_t sb;
+  size_t read = fread(&sb, sizeof(sb), 1, fp);
+  fclose(fp);
+
+  if (read != 1 || sb.magic != DISK_MAGIC || sb.version != DISK_VERSION)
+    return NULL;
+
+  o.page_size = sb.page_size;
+  o.layout = sb.layout;
+
+  return btree_create_ex(sb.order, filename, "r+b", &o);
+}
+
 void btree_destroy(btree_t *tree) {
   if (!tree)
     return;
 
-  if (tree->root)
-    node_destroy(tree->root, tree->order, tree->fp);
+  // Escreve as páginas alteradas e o superbloco antes de fechar o arquivo
+  if (tree->pool) {
+    btree_sync_superblock(tree);
+    bpool_destroy(tree->pool);
+  }
+
+  wal_close(tree->wal);
 
-  if (tree->fp)
-    fclose(tree->fp);
+  if (tree->st)
+    storage_close(tree->st);
 
+  stats_destroy(tree->counters);
+  pthread_rwlock_destroy(&tree->latch);
+  pthread_mutex_destroy(&tree->wal_lock);
   free(tree);
 }
 
 node_t *btree_search(btree_t *tree, int key, int *pos) {
-  return node_search(tree->root, key, pos, tree->fp, tree->order);
-}
+  uint64_t start = stats_now();
 
-int btree_insert(btree_t *tree, int key, int value) {
-  int result = node_insert(&tree->root, key, value, tree->order, tree->fp);
-  if (result == BTREE_SUCCESS) {
-    tree->n_nodes++;
-    update_node_count(tree->fp);
-  }
+  pthread_rwlock_rdlock(&tree->latch);
 
-  return result;
-}
+  node_t *node;
+  if (tree->bplus)
+    node = bplus_search(tree->root, key, pos, tree->pool);
+  else
+    node = node_search(tree->root, key, pos, tree->pool, tree->order);
 
-int btree_remove(btree_t *tree, int key) {
-  int result = node_remove(tree->root, key, tree->order, tree->fp);
-  if (result == BTREE_SUCCESS)
-    tree->n_nodes--;
+  // O nó continua no pool até que outra operação precise do frame
+  if (node)
+    bpool_unpin(tree->pool, node, false);
 
-  return result;
-}
+  pthread_rwlock_unlock(&tree->latch);
+
+  stats_record(tree->counters, BTREE_OP_SEARCH, start);
 
-void enqueue(node_t **queue, node_t *node, int *rear) {
-  queue[(*rear)++] = node;
+  return node;
 }
 
-int btree_print(btree_t *tree, FILE *output_fptr) {
-  if (!tree || !tree->fp)
-    return BTREE_ERROR_INVALID_PARAM;
+// Descidas otimistas interrompidas por alterações antes de a operação seguir
+// pelo caminho com latches
+#define BTREE_OPTIMISTIC_TRIES 4
 
-  fprintf(output_fptr, "-- ARVORE B\n");
+// Resultado de btree_descend()
+typedef struct btree_peek {
+  node_t *node;     // Nó onde a chave está ou estaria, não fixado
+  uint64_t version; // Versão de node lida na descida
+  int pos;          // Posição da chave em node ou onde ela seria inserida
+  bool found;       // Flag indicando se a chave está em node
+  bool latched;     // Flag indicando que a operação precisa dos latches
+} btree_peek_t;
 
-  if (!tree->root)
-    return BTREE_ERROR_INVALID_PARAM;
+/**
+ * Desce sem latches até o nó onde a chave está ou estaria: na árvore B, o
+ * primeiro nó que contém a chave ou a folha; na B+, sempre a folha
+ *
+ * Cada filho é obtido com bpool_peek() entre duas confirmações do pai: se o
+ * filho mudou de página no intervalo, o pai também mudou. Tamanhos e
+ * ponteiros são verificados antes do uso, pois um nó pode ser lido no meio de
+ * uma alteração
+ *
+ * As descidas com latches dividem os nós cheios e completam os nós com o
+ * mínimo de chaves por onde passam. Para que a árvore fique igual à que elas
+ * deixariam, um nó fora de [lo, hi] chaves (a raiz só acima de hi) encerra a
+ * descida com peek->latched
+ *
+ * @param tree Ponteiro para árvore B
+ * @param key Chave procurada
+ * @param lo Mínimo de chaves de um nó que não seja a raiz
+ * @param hi Máximo de chaves de um nó
+ * @param peek Recebe o nó, que ainda precisa ser confirmado com bpool_check()
+ * ou bpool_upgrade() depois de lido
+ *
+ * @return true se a descida chegou ao nó; false se ela deve ser repetida ou,
+ * com peek->latched, seguir pelo caminho com latches
+ */
+static bool btree_descend(btree_t *tree, int key, int lo, int hi,
+                          btree_peek_t *peek) {
+  bpool_t *pool = tree->pool;
+  uint64_t v;
+  node_t *node = bpool_peek(pool, tree->root, &v);
+  bool root = true;
+
+  peek->latched = false;
+
+  while (node) {
+    size_t n = node->n_keys;
+    const int *keys = node->keys;
+    bool leaf = node->is_leaf;
+
+    if (n >= tree->order || !keys)
+      return false;
+
+    if ((int)n > hi || (!root && (int)n < lo)) {
+      peek->latched = true;
+      return false;
+    }
 
-  node_print(tree->root, output_fptr);
-  fprintf(output_fptr, "\n");
+    int i;
+    if (tree->bplus && !leaf) {
+      i = keys_upper_bound(keys, n, key);
+    } else {
+      i = keys_lower_bound(keys, n, key);
+      peek->found = i < (int)n && keys[i] == key;
+
+      if (peek->found || leaf) {
+        peek->node = node;
+        peek->version = v;
+        peek->pos = i;
+        return true;
+      }
+    }
 
-  node_t **queue = calloc(tree->n_nodes, sizeof(node_t *));
-  if (!queue)
-    return BTREE_ERROR_ALLOC;
-  int front = 0, rear = 0;
-  int level = 1;
-  int nodes_curr_lvl = 0;
-  int nodes_nxt_lvl = 0;
+    const int *children = node->children;
+    if (!children)
+      return false;
 
-  if (!tree->root->is_leaf) {
-    for (int i = 0; i <= tree->root->n_keys; i++) {
-      node_t *child = disk_read(tree->fp, tree->order, tree->root->children[i]);
-      if (!child) {
-        free(queue);
-        return BTREE_ERROR_IO;
-      }
+    int page = children[i];
+    if (!bpool_check(node, v))
+      return false;
 
-      enqueue(queue, child, &rear);
-      nodes_nxt_lvl++;
-    }
+    uint64_t child_v;
+    node_t *child = bpool_peek(pool, page, &child_v);
+    if (!child || !bpool_check(node, v))
+      return false;
+
+    node = child;
+    v = child_v;
+    root = false;
   }
 
-  while (front < rear) {
-    if (nodes_curr_lvl == 0) {
+  return false;
+}
+
+/**
+ * btree_get() sem latches nas páginas
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_NOT_FOUND ou NODE_RESTART se as
+ * tentativas se esgotaram
+ */
+static int btree_get_optimistic(btree_t *tree, int key, int *value_out) {
+  if (tree->root == -1)
+    return BTREE_ERROR_NOT_FOUND;
+
+  for (int tries = 0; tries < BTREE_OPTIMISTIC_TRIES; tries++) {
+    btree_peek_t peek;
+    int value = 0;
+
+    if (!btree_descend(tree, key, 0, tree->order - 1, &peek))
+      continue;
+
+    if (peek.found) {
+      const int *values = peek.node->values;
+      if (!values)
+        continue;
+
+      value = values[peek.pos];
+    }
+
+    if (!bpool_check(peek.node, peek.version))
+      continue;
+
+    if (!peek.found)
+      return BTREE_ERROR_NOT_FOUND;
+
+    if (value_out)
+      *value_out = value;
+
+    return BTREE_SUCCESS;
+  }
+
+  return NODE_RESTART;
+}
+
+/**
+ * Insere ou atualiza uma chave fixando apenas o nó alterado, e só se ele não
+ * mudou desde a descida sem latches
+ *
+ * Se algum nó do caminho estiver cheio, a inserção fica com a descida com
+ * latches, que o divide
+ *
+ * @return BTREE_SUCCESS ou NODE_RESTART se a inserção deve seguir pela
+ * descida com latches
+ */
+static int btree_upsert_optimistic(btree_t *tree, int key, int value,
+                                   bool *found, int *old_value) {
+  if (tree->root == -1)
+    return NODE_RESTART;
+
+  for (int tries = 0; tries < BTREE_OPTIMISTIC_TRIES; tries++) {
+    btree_peek_t peek;
+
+    if (!btree_descend(tree, key, 0, tree->order - 2, &peek)) {
+      if (peek.latched)
+        return NODE_RESTART;
+
+      continue;
+    }
+
+    // A página só é usada se a versão for confirmada pela fixação
+    int page = peek.node->bin_pos;
+    node_t *node = bpool_upgrade(tree->pool, page, peek.node, peek.version);
+    if (!node)
+      continue;
+
+    *found = peek.found;
+    if (peek.found)
+      return node_replace(node, peek.pos, value, tree->pool, found,
+                          old_value);
+
+    return node_leaf_insert(node, peek.pos, key, value, tree->pool);
+  }
+
+  return NODE_RESTART;
+}
+
+/**
+ * Remove uma chave de uma folha fixando apenas a folha, e só se ela não mudou
+ * desde a descida sem latches
+ *
+ * Chaves de nós internos da árvore B e caminhos com nós no mínimo de chaves
+ * precisam de troca pela antecessora, empréstimo ou mescla, que ficam com a
+ * descida com latches
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_NOT_FOUND ou NODE_RESTART se a remoção
+ * deve seguir pela descida com latches
+ */
+static int btree_remove_optimistic(btree_t *tree, int key) {
+  if (tree->root == -1)
+    return BTREE_ERROR_NOT_FOUND;
+
+  int min = node_min_degree(tree->order);
+
+  for (int tries = 0; tries < BTREE_OPTIMISTIC_TRIES; tries++) {
+    btree_peek_t peek;
+
+    if (!btree_descend(tree, key, min, tree->order - 1, &peek)) {
+      if (peek.latched)
+        return NODE_RESTART;
+
+      continue;
+    }
+
+    if (!peek.found) {
+      if (!bpool_check(peek.node, peek.version))
+        continue;
+
+      return BTREE_ERROR_NOT_FOUND;
+    }
+
+    int page = peek.node->bin_pos;
+    node_t *node = bpool_upgrade(tree->pool, page, peek.node, peek.version);
+    if (!node)
+      continue;
+
+    if (!node->is_leaf) {
+      bpool_unpin(tree->pool, node, false);
+      return NODE_RESTART;
+    }
+
+    int result = node_remove_from_leaf(node, peek.pos, tree->pool, tree->order);
+    bpool_unpin(tree->pool, node, false);
+
+    return result;
+  }
+
+  return NODE_RESTART;
+}
+
+/**
+ * btree_get() com o latch compartilhado da árvore já obtido
+ */
+static int btree_lookup(btree_t *tree, int key, int *value_out) {
+  // A descida só fixa frames do pool; nada é alocado
+  int pos;
+  node_t *node;
+  if (tree->bplus)
+    node = bplus_search(tree->root, key, &pos, tree->pool);
+  else
+    node = node_search(tree->root, key, &pos, tree->pool, tree->order);
+
+  if (!node)
+    return BTREE_ERROR_NOT_FOUND;
+
+  if (value_out)
+    *value_out = node->values[pos];
+
+  bpool_unpin(tree->pool, node, false);
+
+  return BTREE_SUCCESS;
+}
+
+int btree_get(btree_t *tree, int key, int *value_out) {
+  if (!tree)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  uint64_t start = stats_now();
+
+  pthread_rwlock_rdlock(&tree->latch);
+
+  // Com páginas muito disputadas, a busca segue com latch coupling
+  int result = btree_get_optimistic(tree, key, value_out);
+  if (result == NODE_RESTART)
+    result = btree_lookup(tree, key, value_out);
+
+  pthread_rwlock_unlock(&tree->latch);
+
+  stats_record(tree->counters, BTREE_OP_SEARCH, start);
+
+  return result;
+}
+
+bool btree_contains(btree_t *tree, int key) {
+  return btree_get(tree, key, NULL) == BTREE_SUCCESS;
+}
+
+// Busca pendente de btree_get_batch()
+typedef struct get_lookup {
+  int key;    // Chave procurada
+  int page;   // Página a visitar no nível atual
+  size_t idx; // Posição da chave na entrada
+} get_lookup_t;
+
+static int get_lookup_cmp(const void *a, const void *b) {
+  const get_lookup_t *la = a, *lb = b;
+
+  if (la->key != lb->key)
+    return la->key < lb->key ? -1 : 1;
+
+  return la->idx < lb->idx ? -1 : la->idx > lb->idx;
+}
+
+/**
+ * Busca as chaves de btree_get_batch() nível a nível, com o latch
+ * compartilhado da árvore já obtido
+ *
+ * As páginas são fixadas uma de cada vez, sem latch coupling entre os níveis
+ *
+ * @return Quantidade de chaves encontradas ou código de erro
+ */
+static int btree_get_levels(btree_t *tree, const int *keys, size_t n,
+                            int *values, bool *found) {
+  if (tree->root == -1)
+    return 0;
+
+  get_lookup_t *look = malloc(n * sizeof(get_lookup_t));
+  int *level = malloc(n * sizeof(int));
+  if (!look || !level) {
+    free(look);
+    free(level);
+    return BTREE_ERROR_ALLOC;
+  }
+
+  // Em ordem de chave, buscas que passam pela mesma página ficam vizinhas em
+  // todos os níveis
+  for (size_t i = 0; i < n; i++)
+    look[i] = (get_lookup_t){keys[i], tree->root, i};
+
+  qsort(look, n, sizeof(get_lookup_t), get_lookup_cmp);
+
+  bpool_t *pool = tree->pool;
+  size_t m = n;
+  int hits = 0;
+
+  // Todas as buscas avançam um nível por vez
+  while (m > 0) {
+    // Antecipa as páginas distintas do nível antes de visitar a primeira
+    size_t distinct = 0;
+    for (size_t i = 0; i < m; i++)
+      if (i == 0 || look[i].page != look[i - 1].page)
+        level[distinct++] = look[i].page;
+
+    bpool_prefetch_batch(pool, level, distinct);
+
+    size_t pending = 0;
+
+    for (size_t i = 0; i < m;) {
+      int page = look[i].page;
+      node_t *node = bpool_pin_shared(pool, page);
+      if (!node) {
+        free(look);
+        free(level);
+        return BTREE_ERROR_IO;
+      }
+
+      // Uma fixação atende todas as buscas que passam pela página
+      for (; i < m && look[i].page == page; i++) {
+        int key = look[i].key;
+        int child;
+
+        // B+: os registros só estão nas folhas, e a rota segue bplus_route()
+        if (tree->bplus && !node->is_leaf) {
+          child = keys_upper_bound(node->keys, node->n_keys, key);
+        } else {
+          int pos = keys_lower_bound(node->keys, node->n_keys, key);
+          if (pos < (int)node->n_keys && node->keys[pos] == key) {
+            values[look[i].idx] = node->values[pos];
+            found[look[i].idx] = true;
+            hits++;
+            continue;
+          }
+
+          if (node->is_leaf)
+            continue;
+
+          child = pos;
+        }
+
+        // Uma página liberada por escrita concorrente não tem filhos
+        if (node->children[child] == -1)
+          continue;
+
+        look[pending] = look[i];
+        look[pending].page = node->children[child];
+        pending++;
+      }
+
+      bpool_unpin(pool, node, false);
+    }
+
+    m = pending;
+  }
+
+  free(look);
+  free(level);
+
+  return hits;
+}
+
+int btree_get_batch(btree_t *tree, const int *keys, size_t n, int *values,
+                    bool *found) {
+  if (!tree || (n > 0 && (!keys || !values || !found)))
+    return BTREE_ERROR_INVALID_PARAM;
+
+  for (size_t i = 0; i < n; i++)
+    found[i] = false;
+
+  if (n == 0)
+    return 0;
+
+  pthread_rwlock_rdlock(&tree->latch);
+
+  // A versão é lida antes da quantidade de escritas: uma escrita que começar
+  // depois da leitura altera a versão
+  size_t version = __atomic_load_n(&tree->version, __ATOMIC_SEQ_CST);
+  size_t writers = __atomic_load_n(&tree->writers, __ATOMIC_SEQ_CST);
+
+  int hits = btree_get_levels(tree, keys, n, values, found);
+
+  // Entre dois níveis, uma divisão ou mescla concorrente pode levar uma chave
+  // para fora da subárvore visitada: as que faltaram são buscadas de novo
+  if (hits >= 0 &&
+      (writers > 0 ||
+       __atomic_load_n(&tree->version, __ATOMIC_SEQ_CST) != version)) {
+    for (size_t i = 0; i < n; i++)
+      if (!found[i] &&
+          btree_lookup(tree, keys[i], &values[i]) == BTREE_SUCCESS) {
+        found[i] = true;
+        hits++;
+      }
+  }
+
+  pthread_rwlock_unlock(&tree->latch);
+
+  return hits;
+}
+
+int btree_upsert(btree_t *tree, int key, int value, bool *replaced,
+                 int *old_value) {
+  if (!tree)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  uint64_t start = stats_now();
+
+  btree_write_begin(tree);
+
+  bool found;
+  int result = btree_upsert_optimistic(tree, key, value, &found, old_value);
+
+  // Divisões e páginas muito disputadas ficam com a descida com latches
+  while (result == NODE_RESTART) {
+    if (tree->bplus)
+      result = bplus_insert(&tree->root, key, value, tree->order, tree->pool,
+                            &found, old_value);
+    else
+      result = node_insert(&tree->root, key, value, tree->order, tree->pool,
+                           &found, old_value);
+
+    if (result != NODE_ROOT_FULL)
+      break;
+
+    // A raiz precisa ser criada ou dividida antes da inserção
+    result = btree_grow(tree);
+    if (result == BTREE_SUCCESS)
+      result = NODE_RESTART;
+  }
+
+  if (result == BTREE_SUCCESS && !found)
+    __atomic_add_fetch(&tree->n_keys, 1, __ATOMIC_RELAXED);
+
+  if (replaced)
+    *replaced = result == BTREE_SUCCESS && found;
+
+  result = btree_write_end(tree, result);
+  stats_record(tree->counters, BTREE_OP_INSERT, start);
+
+  return result;
+}
+
+int btree_insert(btree_t *tree, int key, int value) {
+  return btree_upsert(tree, key, value, NULL, NULL);
+}
+
+int btree_remove(btree_t *tree, int key) {
+  if (!tree)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  uint64_t start = stats_now();
+
+  btree_write_begin(tree);
+
+  int result = btree_remove_optimistic(tree, key);
+  if (result == NODE_RESTART)
+    result = tree->bplus
+                 ? bplus_remove(tree->root, key, tree->order, tree->pool)
+                 : node_remove(tree->root, key, tree->order, tree->pool);
+
+  if (result == BTREE_SUCCESS)
+    __atomic_sub_fetch(&tree->n_keys, 1, __ATOMIC_RELAXED);
+
+  // Se a raiz ficou sem chaves após uma mescla, seu único filho vira a raiz
+  btree_collapse(tree);
+
+  result = btree_write_end(tree, result);
+  stats_record(tree->counters, BTREE_OP_REMOVE, start);
+
+  return result;
+}
+
+typedef struct bulk_pair {
+  int key;
+  int value;
+  size_t seq; // Posição na entrada, para manter o último registro repetido
+} bulk_pair_t;
+
+static int bulk_pair_cmp(const void *a, const void *b) {
+  const bulk_pair_t *pa = a, *pb = b;
+
+  if (pa->key != pb->key)
+    return pa->key < pb->key ? -1 : 1;
+
+  return pa->seq < pb->seq ? -1 : pa->seq > pb->seq;
+}
+
+/**
+ * Ordena pares chave/registro, mantendo o último registro de chaves repetidas
+ *
+ * Entradas já ordenadas são copiadas direto; as demais passam por qsort
+ *
+ * @param out_keys Recebe as chaves ordenadas, sem repetição (n posições)
+ * @param out_values Recebe os registros correspondentes (n posições)
+ * @param m Recebe a quantidade de pares distintos
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+static int bulk_sort(const int *keys, const int *values, size_t n,
+                     int *out_keys, int *out_values, size_t *m) {
+  bool sorted = true;
+  for (size_t i = 1; i < n && sorted; i++)
+    sorted = keys[i - 1] < keys[i];
+
+  if (sorted) {
+    memcpy(out_keys, keys, n * sizeof(int));
+    memcpy(out_values, values, n * sizeof(int));
+    *m = n;
+    return BTREE_SUCCESS;
+  }
+
+  bulk_pair_t *pairs = malloc(n * sizeof(bulk_pair_t));
+  if (!pairs)
+    return BTREE_ERROR_ALLOC;
+
+  for (size_t i = 0; i < n; i++)
+    pairs[i] = (bulk_pair_t){keys[i], values[i], i};
+
+  qsort(pairs, n, sizeof(bulk_pair_t), bulk_pair_cmp);
+
+  *m = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (i + 1 < n && pairs[i + 1].key == pairs[i].key)
+      continue;
+
+    out_keys[*m] = pairs[i].key;
+    out_values[*m] = pairs[i].value;
+    (*m)++;
+  }
+
+  free(pairs);
+
+  return BTREE_SUCCESS;
+}
+
+/**
+ * Constrói um nível da árvore a partir de uma sequência ordenada
+ *
+ * A sequência é dividida em nós com a separação de uma chave entre nós
+ * vizinhos; essas chaves formam a sequência do nível de cima
+ *
+ * @param tree Ponteiro para árvore B
+ * @param keys Chaves do nível; recebem os separadores do nível de cima
+ * @param values Registros do nível; recebem os separadores do nível de cima
+ * @param children Páginas dos filhos (m + 1) ou NULL para as folhas
+ * @param pages Recebe as páginas dos nós criados (pode ser o próprio children)
+ * @param m Quantidade de chaves do nível; recebe a do nível de cima
+ * @param fill Chaves por nó desejadas
+ * @param level Altura dos nós do nível, 0 nas folhas
+ *
+ * @return Quantidade de nós criados ou código de erro
+ */
+static int btree_bulk_level(btree_t *tree, int *keys, int *values,
+                            const int *children, int *pages, size_t *m,
+                            size_t fill, unsigned level) {
+  size_t max_keys = tree->order - 1;
+  size_t n = *m;
+
+  // Cada nó com fill chaves consome também um separador
+  size_t k = (n + 1) / (fill + 1);
+  size_t k_cap = (n + 1 + tree->order - 1) / tree->order;
+  if (k < k_cap)
+    k = k_cap;
+  if (k == 0)
+    k = 1;
+
+  size_t base = (n - (k - 1)) / k;
+  size_t extra = (n - (k - 1)) % k;
+  size_t pos = 0, child = 0;
+
+  for (size_t j = 0; j < k; j++) {
+    size_t size = base + (j < extra);
+    if (size > max_keys)
+      return BTREE_ERROR_INVALID_PARAM;
+
+    node_t *node = bpool_new(tree->pool, children == NULL);
+    if (!node)
+      return BTREE_ERROR_IO;
+
+    node->level = level;
+    memcpy(node->keys, keys + pos, size * sizeof(int));
+    memcpy(node->values, values + pos, size * sizeof(int));
+    if (children)
+      memcpy(node->children, children + child, (size + 1) * sizeof(int));
+    node->n_keys = size;
+
+    pos += size;
+    child += size + 1;
+
+    // Separadores e páginas ocupam posições já lidas da sequência
+    if (j + 1 < k) {
+      keys[j] = keys[pos];
+      values[j] = values[pos];
+      pos++;
+    }
+
+    pages[j] = node->bin_pos;
+    bpool_unpin(tree->pool, node, true);
+  }
+
+  *m = k - 1;
+
+  return (int)k;
+}
+
+/**
+ * Devolve para a lista livre as páginas de uma árvore sem chaves
+ *
+ * Remover todas as chaves não remove todas as páginas: em ordens pequenas o
+ * mínimo de chaves por nó é zero, e as folhas vazias e os separadores da
+ * árvore B+ continuam no lugar. As páginas só são liberadas depois de todas
+ * as folhas serem conferidas
+ *
+ * @param tree Ponteiro para árvore B, com o latch exclusivo
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_INVALID_PARAM se alguma folha tiver
+ * chaves ou código de erro
+ */
+static int btree_free_empty(btree_t *tree) {
+  if (tree->root == -1)
+    return BTREE_SUCCESS;
+
+  size_t cap = 64, n = 0;
+  int *pages = malloc(cap * sizeof(int));
+  if (!pages)
+    return BTREE_ERROR_ALLOC;
+
+  // Percorre a árvore em largura, com as páginas visitadas no próprio vetor
+  int result = BTREE_SUCCESS;
+  pages[n++] = tree->root;
+
+  for (size_t i = 0; i < n && result == BTREE_SUCCESS; i++) {
+    node_t *node = bpool_pin_shared(tree->pool, pages[i]);
+    if (!node) {
+      result = BTREE_ERROR_IO;
+      break;
+    }
+
+    // Na árvore B as chaves dos nós internos também são registros
+    if (node->is_leaf || !tree->bplus) {
+      if (node->n_keys > 0)
+        result = BTREE_ERROR_INVALID_PARAM;
+    }
+
+    if (result == BTREE_SUCCESS && !node->is_leaf) {
+      size_t children = node->n_keys + 1;
+
+      if (n + children > cap) {
+        while (n + children > cap)
+          cap *= 2;
+
+        int *grown = realloc(pages, cap * sizeof(int));
+        if (grown)
+          pages = grown;
+        else
+          result = BTREE_ERROR_ALLOC;
+      }
+
+      if (result == BTREE_SUCCESS) {
+        memcpy(&pages[n], node->children, children * sizeof(int));
+        n += children;
+      }
+    }
+
+    bpool_unpin(tree->pool, node, false);
+  }
+
+  // A raiz é a primeira a ser liberada: com uma falha no meio, a árvore
+  // continua sem chaves e as páginas restantes ficam fora da lista livre
+  size_t freed = 0;
+
+  for (; freed < n && result == BTREE_SUCCESS; freed++) {
+    node_t *node = bpool_pin(tree->pool, pages[freed]);
+    if (!node) {
+      result = BTREE_ERROR_IO;
+      break;
+    }
+
+    bpool_free(tree->pool, node);
+  }
+
+  if (freed > 0)
+    tree->root = -1;
+
+  free(pages);
+
+  return result;
+}
+
+/**
+ * btree_bulk_load() com o latch exclusivo da árvore já obtido
+ */
+static int btree_bulk_load_locked(btree_t *tree, const int *keys,
+                                  const int *values, size_t n, double fill) {
+  if (tree->n_keys > 0)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  if (n == 0)
+    return BTREE_SUCCESS;
+
+  // Uma árvore esvaziada por remoções ainda tem páginas: as páginas voltam
+  // para a lista livre e a carga começa sem raiz
+  int result = btree_free_empty(tree);
+  if (result != BTREE_SUCCESS)
+    return result;
+
+  // Chaves por nó: fração da capacidade, respeitando a ocupação mínima
+  size_t max_keys = tree->order - 1;
+  size_t min_keys = node_min_degree(tree->order) - 1;
+  size_t per_node = fill * max_keys + 0.5;
+  if (per_node < min_keys)
+    per_node = min_keys;
+  if (per_node < 1)
+    per_node = 1;
+
+  size_t m = 0;
+  int *level_keys = malloc(n * sizeof(int));
+  int *level_values = malloc(n * sizeof(int));
+  int *pages = malloc((n + 1) * sizeof(int));
+  if (!level_keys || !level_values || !pages ||
+      bulk_sort(keys, values, n, level_keys, level_values, &m) !=
+          BTREE_SUCCESS) {
+    free(level_keys);
+    free(level_values);
+    free(pages);
+    return BTREE_ERROR_ALLOC;
+  }
+
+  size_t n_keys = m;
+
+  // Com o log de redo, as páginas novas ficam fora do log: a carga começa e
+  // termina com um checkpoint, e o superbloco só passa a apontar para elas
+  // no final. O primeiro checkpoint também grava a raiz liberada acima, cujas
+  // páginas a carga pode reaproveitar
+  if (tree->wal) {
+    if (btree_checkpoint(tree) != BTREE_SUCCESS) {
+      free(level_keys);
+      free(level_values);
+      free(pages);
+      return BTREE_ERROR_IO;
+    }
+
+    bpool_set_unlogged(tree->pool, true);
+  }
+
+  // Folhas e, em seguida, níveis internos até restar um único nó
+  unsigned level = 0;
+  if (tree->bplus) {
+    result = bplus_bulk_level(tree->pool, tree->order, level_keys, level_values,
+                              NULL, pages, &m, per_node, level);
+    while (result > 1)
+      result = bplus_bulk_level(tree->pool, tree->order, level_keys, NULL,
+                                pages, pages, &m, per_node, ++level);
+  } else {
+    result = btree_bulk_level(tree, level_keys, level_values, NULL, pages, &m,
+                              per_node, level);
+    while (result > 1)
+      result = btree_bulk_level(tree, level_keys, level_values, pages, pages,
+                                &m, per_node, ++level);
+  }
+
+  if (result == 1) {
+    tree->root = pages[0];
+    tree->n_keys = n_keys;
+    __atomic_add_fetch(&tree->version, 1, __ATOMIC_SEQ_CST);
+    result = BTREE_SUCCESS;
+  }
+
+  free(level_keys);
+  free(level_values);
+  free(pages);
+
+  if (tree->wal) {
+    bpool_set_unlogged(tree->pool, false);
+
+    if (result == BTREE_SUCCESS)
+      result = btree_checkpoint(tree);
+  }
+
+  return result;
+}
+
+int btree_bulk_load(btree_t *tree, const int *keys, const int *values,
+                    size_t n, double fill) {
+  if (!tree || (n > 0 && (!keys || !values)) || !(fill > 0 && fill <= 1))
+    return BTREE_ERROR_INVALID_PARAM;
+
+  uint64_t start = stats_now();
+
+  btree_lock(tree);
+  int result = btree_bulk_load_locked(tree, keys, values, n, fill);
+  btree_unlock(tree);
+
+  stats_record(tree->counters, BTREE_OP_BULK, start);
+
+  return result;
+}
+
+int btree_insert_batch(btree_t *tree, const int *keys, const int *values,
+                       size_t n) {
+  if (!tree || (n > 0 && (!keys || !values)))
+    return BTREE_ERROR_INVALID_PARAM;
+
+  if (n == 0)
+    return BTREE_SUCCESS;
+
+  uint64_t start = stats_now();
+
+  size_t m = 0;
+  int *batch_keys = malloc(n * sizeof(int));
+  int *batch_values = malloc(n * sizeof(int));
+  if (!batch_keys || !batch_values ||
+      bulk_sort(keys, values, n, batch_keys, batch_values, &m) !=
+          BTREE_SUCCESS) {
+    free(batch_keys);
+    free(batch_values);
+    stats_record(tree->counters, BTREE_OP_BULK, start);
+    return BTREE_ERROR_ALLOC;
+  }
+
+  int result = BTREE_SUCCESS;
+
+  btree_write_begin(tree);
+
+  for (size_t i = 0; i < m;) {
+    size_t added;
+    int applied;
+    if (tree->bplus)
+      applied = bplus_insert_run(&tree->root, batch_keys + i, batch_values + i,
+                                 m - i, tree->order, tree->pool, &added);
+    else
+      applied = node_insert_run(&tree->root, batch_keys + i, batch_values + i,
+                                m - i, tree->order, tree->pool, &added);
+
+    if (applied == NODE_ROOT_FULL) {
+      result = btree_grow(tree);
+      if (result != BTREE_SUCCESS)
+        break;
+      continue;
+    }
+
+    if (applied < 0) {
+      result = applied;
+      break;
+    }
+
+    __atomic_add_fetch(&tree->n_keys, added, __ATOMIC_RELAXED);
+    i += applied;
+
+    // Efetiva parte do lote antes que as páginas alteradas ocupem o pool
+    if (i < m && bpool_txn_full(tree->pool)) {
+      result = btree_commit(tree, BTREE_SUCCESS);
+      if (result != BTREE_SUCCESS)
+        break;
+    }
+  }
+
+  free(batch_keys);
+  free(batch_values);
+
+  result = btree_write_end(tree, result);
+  stats_record(tree->counters, BTREE_OP_BULK, start);
+
+  return result;
+}
+
+btree_cursor_t *btree_cursor_open(btree_t *tree) {
+  if (!tree)
+    return NULL;
+
+  btree_cursor_t *cur = calloc(1, sizeof(btree_cursor_t));
+  if (!cur)
+    return NULL;
+
+  cur->tree = tree;
+  cur->ra_parent = -1;
+
+  return cur;
+}
+
+void btree_cursor_close(btree_cursor_t *cur) {
+  if (!cur)
+    return;
+
+  free(cur->path);
+  free(cur);
+}
+
+static int cursor_push(btree_cursor_t *cur, int page, int idx) {
+  if (cur->depth == cur->capacity) {
+    size_t capacity = cur->capacity ? 2 * cur->capacity : 16;
+    cursor_frame_t *path = realloc(cur->path, capacity * sizeof(*path));
+    if (!path)
+      return BTREE_ERROR_ALLOC;
+
+    cur->path = path;
+    cur->capacity = capacity;
+  }
+
+  cur->path[cur->depth++] = (cursor_frame_t){page, idx};
+
+  return BTREE_SUCCESS;
+}
+
+/**
+ * Posiciona o cursor na chave idx do nó no topo do caminho
+ */
+static int cursor_load(btree_cursor_t *cur, node_t *node, int idx) {
+  cur->path[cur->depth - 1].idx = idx;
+  cur->key = node->keys[idx];
+  cur->value = node->values[idx];
+  cur->valid = true;
+  cur->version = __atomic_load_n(&cur->tree->version, __ATOMIC_SEQ_CST);
+
+  bpool_unpin(cur->tree->pool, node, false);
+
+  return BTREE_SUCCESS;
+}
+
+static int cursor_end(btree_cursor_t *cur) {
+  cur->depth = 0;
+  cur->valid = false;
+
+  return BTREE_ERROR_NOT_FOUND;
+}
+
+/**
+ * Antecipa os filhos de um nó interno que o cursor visitará a partir de idx,
+ * no sentido do percurso
+ */
+static void cursor_readahead(btree_cursor_t *cur, const node_t *node, int idx,
+                             bool forward) {
+  if (node->is_leaf)
+    return;
+
+  int pages[CURSOR_READAHEAD];
+  int n = 0, step = forward ? 1 : -1;
+
+  for (int i = idx; i >= 0 && i <= (int)node->n_keys && n < CURSOR_READAHEAD;
+       i += step)
+    pages[n++] = node->children[i];
+
+  bpool_prefetch_batch(cur->tree->pool, pages, n);
+}
+
+/**
+ * Antecipa, no sentido do percurso, as próximas CURSOR_READAHEAD folhas
+ * filhas de ra_parent
+ */
+static void cursor_leaf_readahead(btree_cursor_t *cur) {
+  bpool_t *pool = cur->tree->pool;
+  node_t *node = bpool_pin_shared(pool, cur->ra_parent);
+  if (!node) {
+    cur->ra_parent = -1;
+    return;
+  }
+
+  int pages[CURSOR_READAHEAD];
+  int n = 0, step = cur->ra_forward ? 1 : -1, i = cur->ra_next;
+
+  for (; i >= 0 && i <= (int)node->n_keys && n < CURSOR_READAHEAD; i += step)
+    pages[n++] = node->children[i];
+
+  bpool_unpin(pool, node, false);
+
+  // As folhas seguintes têm outro pai, que o percurso não conhece
+  cur->ra_next = i;
+  cur->ra_left = n;
+  if (n == 0)
+    cur->ra_parent = -1;
+
+  bpool_prefetch_batch(pool, pages, n);
+}
+
+/**
+ * Sobe pelo caminho até o primeiro ancestral com chave depois do filho
+ * percorrido
+ */
+static int cursor_ascend_next(btree_cursor_t *cur) {
+  bpool_t *pool = cur->tree->pool;
+
+  while (--cur->depth > 0) {
+    cursor_frame_t *frame = &cur->path[cur->depth - 1];
+    node_t *node = bpool_pin(pool, frame->page);
+    if (!node)
+      return BTREE_ERROR_IO;
+
+    if (frame->idx < (int)node->n_keys)
+      return cursor_load(cur, node, frame->idx);
+
+    bpool_unpin(pool, node, false);
+  }
+
+  return cursor_end(cur);
+}
+
+/**
+ * Sobe pelo caminho até o primeiro ancestral com chave antes do filho
+ * percorrido
+ */
+static int cursor_ascend_prev(btree_cursor_t *cur) {
+  bpool_t *pool = cur->tree->pool;
+
+  while (--cur->depth > 0) {
+    cursor_frame_t *frame = &cur->path[cur->depth - 1];
+    if (frame->idx == 0)
+      continue;
+
+    node_t *node = bpool_pin(pool, frame->page);
+    if (!node)
+      return BTREE_ERROR_IO;
+
+    return cursor_load(cur, node, frame->idx - 1);
+  }
+
+  return cursor_end(cur);
+}
+
+/**
+ * Desce pelos primeiros filhos a partir de page até a menor chave da
+ * subárvore
+ */
+static int cursor_descend_first(btree_cursor_t *cur, int page) {
+  bpool_t *pool = cur->tree->pool;
+
+  for (;;) {
+    node_t *node = bpool_pin(pool, page);
+    if (!node)
+      return BTREE_ERROR_IO;
+
+    if (cursor_push(cur, page, 0) != BTREE_SUCCESS) {
+      bpool_unpin(pool, node, false);
+      return BTREE_ERROR_ALLOC;
+    }
+
+    if (node->is_leaf) {
+      if (node->n_keys > 0)
+        return cursor_load(cur, node, 0);
+
+      // Folha vazia (possível na ordem 3): segue para o ancestral
+      bpool_unpin(pool, node, false);
+      return cursor_ascend_next(cur);
+    }
+
+    cursor_readahead(cur, node, 0, true);
+    page = node->children[0];
+    bpool_unpin(pool, node, false);
+  }
+}
+
+/**
+ * Desce pelos últimos filhos a partir de page até a maior chave da subárvore
+ */
+static int cursor_descend_last(btree_cursor_t *cur, int page) {
+  bpool_t *pool = cur->tree->pool;
+
+  for (;;) {
+    node_t *node = bpool_pin(pool, page);
+    if (!node)
+      return BTREE_ERROR_IO;
+
+    int n = node->n_keys;
+    if (cursor_push(cur, page, n) != BTREE_SUCCESS) {
+      bpool_unpin(pool, node, false);
+      return BTREE_ERROR_ALLOC;
+    }
+
+    if (node->is_leaf) {
+      if (n > 0)
+        return cursor_load(cur, node, n - 1);
+
+      bpool_unpin(pool, node, false);
+      return cursor_ascend_prev(cur);
+    }
+
+    cursor_readahead(cur, node, n, false);
+    page = node->children[n];
+    bpool_unpin(pool, node, false);
+  }
+}
+
+/**
+ * B+: percorre as folhas encadeadas a partir da posição idx de page até
+ * encontrar uma chave
+ *
+ * O caminho guarda apenas a folha: não é preciso subir na árvore
+ *
+ * @param cur Ponteiro para o cursor
+ * @param page Folha inicial ou -1
+ * @param idx Posição inicial; para trás, posições além da última chave
+ * começam pela última
+ * @param forward Flag indicando o sentido da busca
+ */
+static int cursor_leaf_walk(btree_cursor_t *cur, int page, int idx,
+                            bool forward) {
+  bpool_t *pool = cur->tree->pool;
+
+  cursor_end(cur);
+
+  while (page != -1) {
+    node_t *node = bpool_pin(pool, page);
+    if (!node)
+      return BTREE_ERROR_IO;
+
+    int n = node->n_keys;
+    if (!forward && idx >= n)
+      idx = n - 1;
+
+    if (idx >= 0 && idx < n) {
+      if (cursor_push(cur, page, idx) != BTREE_SUCCESS) {
+        bpool_unpin(pool, node, false);
+        return BTREE_ERROR_ALLOC;
+      }
+
+      return cursor_load(cur, node, idx);
+    }
+
+    page = node->siblings[forward ? 1 : 0];
+    idx = forward ? 0 : INT_MAX;
+    bpool_unpin(pool, node, false);
+
+    if (cur->ra_parent != -1 && cur->ra_forward == forward &&
+        --cur->ra_left <= 0)
+      cursor_leaf_readahead(cur);
+  }
+
+  return BTREE_ERROR_NOT_FOUND;
+}
+
+/**
+ * B+: desce até a folha de uma chave ou, sem chave, até a primeira ou a
+ * última folha, e antecipa as folhas vizinhas no sentido do percurso
+ *
+ * @param cur Ponteiro para o cursor
+ * @param key Chave procurada ou NULL
+ * @param forward Sentido do percurso; sem chave, true desce até a primeira
+ * folha
+ *
+ * @return Página da folha ou -1 em caso de erro
+ */
+static int cursor_find_leaf(btree_cursor_t *cur, const int *key,
+                            bool forward) {
+  bpool_t *pool = cur->tree->pool;
+  int page = cur->tree->root;
+  int parent = -1, idx = 0;
+
+  cur->ra_parent = -1;
+
+  while (page != -1) {
+    node_t *node = bpool_pin(pool, page);
+    if (!node)
+      return -1;
+
+    if (node->is_leaf) {
+      bpool_unpin(pool, node, false);
+      break;
+    }
+
+    if (key)
+      idx = keys_upper_bound(node->keys, node->n_keys, *key);
+    else
+      idx = forward ? 0 : node->n_keys;
+
+    parent = page;
+    page = node->children[idx];
+    bpool_unpin(pool, node, false);
+  }
+
+  // A folha encontrada já está no pool: a antecipação começa na seguinte
+  if (page != -1 && parent != -1) {
+    cur->ra_parent = parent;
+    cur->ra_forward = forward;
+    cur->ra_next = idx + (forward ? 1 : -1);
+    cursor_leaf_readahead(cur);
+  }
+
+  return page;
+}
+
+static int cursor_first(btree_cursor_t *cur) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  cursor_end(cur);
+  if (cur->tree->root == -1)
+    return BTREE_ERROR_NOT_FOUND;
+
+  if (cur->tree->bplus)
+    return cursor_leaf_walk(cur, cursor_find_leaf(cur, NULL, true), 0, true);
+
+  return cursor_descend_first(cur, cur->tree->root);
+}
+
+static int cursor_last(btree_cursor_t *cur) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  cursor_end(cur);
+  if (cur->tree->root == -1)
+    return BTREE_ERROR_NOT_FOUND;
+
+  if (cur->tree->bplus)
+    return cursor_leaf_walk(cur, cursor_find_leaf(cur, NULL, false), INT_MAX,
+                            false);
+
+  return cursor_descend_last(cur, cur->tree->root);
+}
+
+static int cursor_seek(btree_cursor_t *cur, int key) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  bpool_t *pool = cur->tree->pool;
+  int page = cur->tree->root;
+
+  cursor_end(cur);
+
+  // B+: a primeira chave maior ou igual está na folha da rota ou adiante
+  if (cur->tree->bplus) {
+    if (page == -1)
+      return BTREE_ERROR_NOT_FOUND;
+
+    node_t *leaf = bpool_pin(pool, cursor_find_leaf(cur, &key, true));
+    if (!leaf)
+      return BTREE_ERROR_IO;
+
+    int i = keys_lower_bound(leaf->keys, leaf->n_keys, key);
+
+    page = leaf->bin_pos;
+    bpool_unpin(pool, leaf, false);
+
+    return cursor_leaf_walk(cur, page, i, true);
+  }
+
+  while (page != -1) {
+    node_t *node = bpool_pin(pool, page);
+    if (!node)
+      return BTREE_ERROR_IO;
+
+    // Primeira chave maior ou igual à procurada
+    int n = node->n_keys, i = keys_lower_bound(node->keys, n, key);
+
+    if (cursor_push(cur, page, i) != BTREE_SUCCESS) {
+      bpool_unpin(pool, node, false);
+      return BTREE_ERROR_ALLOC;
+    }
+
+    if (i < n && (node->is_leaf || node->keys[i] == key))
+      return cursor_load(cur, node, i);
+
+    cursor_readahead(cur, node, i, true);
+    int child = node->is_leaf ? -1 : node->children[i];
+    bpool_unpin(pool, node, false);
+
+    // Todas as chaves da folha são menores: a próxima está em um ancestral
+    if (child == -1)
+      return cursor_ascend_next(cur);
+
+    page = child;
+  }
+
+  return cursor_end(cur);
+}
+
+/**
+ * Refaz o caminho do cursor se a árvore foi alterada desde que ele foi
+ * montado
+ *
+ * @return true se o cursor ainda está sobre a mesma chave
+ */
+static bool cursor_revalidate(btree_cursor_t *cur, int *result) {
+  if (cur->version == __atomic_load_n(&cur->tree->version, __ATOMIC_SEQ_CST))
+    return true;
+
+  int key = cur->key;
+  *result = cursor_seek(cur, key);
+
+  return *result == BTREE_SUCCESS && cur->key == key;
+}
+
+static int cursor_next(btree_cursor_t *cur) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  if (!cur->valid)
+    return BTREE_ERROR_NOT_FOUND;
+
+  // Se a chave atual foi removida, a busca já parou na seguinte
+  int result;
+  if (!cursor_revalidate(cur, &result))
+    return result;
+
+  cursor_frame_t *frame = &cur->path[cur->depth - 1];
+  if (cur->tree->bplus)
+    return cursor_leaf_walk(cur, frame->page, frame->idx + 1, true);
+
+  bpool_t *pool = cur->tree->pool;
+  node_t *node = bpool_pin(pool, frame->page);
+  if (!node)
+    return BTREE_ERROR_IO;
+
+  // Em um nó interno, a próxima chave é a menor do filho à direita
+  if (!node->is_leaf) {
+    int idx = ++frame->idx;
+    if (idx % CURSOR_READAHEAD == 0)
+      cursor_readahead(cur, node, idx, true);
+
+    int child = node->children[idx];
+    bpool_unpin(pool, node, false);
+    return cursor_descend_first(cur, child);
+  }
+
+  if (frame->idx + 1 < (int)node->n_keys)
+    return cursor_load(cur, node, frame->idx + 1);
+
+  bpool_unpin(pool, node, false);
+
+  return cursor_ascend_next(cur);
+}
+
+static int cursor_prev(btree_cursor_t *cur) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  if (!cur->valid)
+    return BTREE_ERROR_NOT_FOUND;
+
+  // A busca para na chave atual ou na seguinte; em ambos os casos, a
+  // anterior é a procurada. Sem seguinte, é a última da árvore
+  int result;
+  if (!cursor_revalidate(cur, &result) && result != BTREE_SUCCESS)
+    return result == BTREE_ERROR_NOT_FOUND ? cursor_last(cur) : result;
+
+  cursor_frame_t *frame = &cur->path[cur->depth - 1];
+  if (cur->tree->bplus)
+    return cursor_leaf_walk(cur, frame->page, frame->idx - 1, false);
+
+  bpool_t *pool = cur->tree->pool;
+  node_t *node = bpool_pin(pool, frame->page);
+  if (!node)
+    return BTREE_ERROR_IO;
+
+  // Em um nó interno, a chave anterior é a maior do filho à esquerda
+  if (!node->is_leaf) {
+    int idx = frame->idx;
+    if ((node->n_keys - idx) % CURSOR_READAHEAD == 0)
+      cursor_readahead(cur, node, idx, false);
+
+    int child = node->children[idx];
+    bpool_unpin(pool, node, false);
+    return cursor_descend_last(cur, child);
+  }
+
+  if (frame->idx > 0)
+    return cursor_load(cur, node, frame->idx - 1);
+
+  bpool_unpin(pool, node, false);
+
+  return cursor_ascend_prev(cur);
+}
+
+// Os passos do cursor usam o latch exclusivo da árvore: o caminho guardado
+// entre dois passos só é seguido se nenhuma escrita aconteceu desde que ele
+// foi montado
+
+int btree_cursor_first(btree_cursor_t *cur) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  uint64_t start = stats_now();
+
+  btree_lock(cur->tree);
+  int result = cursor_first(cur);
+  btree_unlock(cur->tree);
+
+  stats_record(cur->tree->counters, BTREE_OP_SCAN, start);
+
+  return result;
+}
+
+int btree_cursor_last(btree_cursor_t *cur) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  uint64_t start = stats_now();
+
+  btree_lock(cur->tree);
+  int result = cursor_last(cur);
+  btree_unlock(cur->tree);
+
+  stats_record(cur->tree->counters, BTREE_OP_SCAN, start);
+
+  return result;
+}
+
+int btree_cursor_seek(btree_cursor_t *cur, int key) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  uint64_t start = stats_now();
+
+  btree_lock(cur->tree);
+  int result = cursor_seek(cur, key);
+  btree_unlock(cur->tree);
+
+  stats_record(cur->tree->counters, BTREE_OP_SCAN, start);
+
+  return result;
+}
+
+int btree_cursor_next(btree_cursor_t *cur) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  uint64_t start = stats_now();
+
+  btree_lock(cur->tree);
+  int result = cursor_next(cur);
+  btree_unlock(cur->tree);
+
+  stats_record(cur->tree->counters, BTREE_OP_SCAN, start);
+
+  return result;
+}
+
+int btree_cursor_prev(btree_cursor_t *cur) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  uint64_t start = stats_now();
+
+  btree_lock(cur->tree);
+  int result = cursor_prev(cur);
+  btree_unlock(cur->tree);
+
+  stats_record(cur->tree->counters, BTREE_OP_SCAN, start);
+
+  return result;
+}
+
+bool btree_cursor_valid(const btree_cursor_t *cur) {
+  return cur && cur->valid;
+}
+
+int btree_cursor_get(const btree_cursor_t *cur, int *key, int *value) {
+  if (!cur)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  if (!cur->valid)
+    return BTREE_ERROR_NOT_FOUND;
+
+  if (key)
+    *key = cur->key;
+  if (value)
+    *value = cur->value;
+
+  return BTREE_SUCCESS;
+}
+
+int btree_flush(btree_t *tree) {
+  if (!tree)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  btree_lock(tree);
+  int result = btree_checkpoint(tree);
+  btree_unlock(tree);
+
+  return result;
+}
+
+size_t btree_count(btree_t *tree) {
+  return tree ? __atomic_load_n(&tree->n_keys, __ATOMIC_RELAXED) : 0;
+}
+
+int btree_cache_stats(btree_t *tree, btree_cache_stats_t *stats) {
+  if (!tree || !stats)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  bpool_stats(tree->pool, stats);
+
+  return BTREE_SUCCESS;
+}
+
+int btree_latency(btree_t *tree, btree_op_t op, btree_latency_t *latency) {
+  if (!tree || !latency || op < 0 || op >= BTREE_N_OPS)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  stats_latency(tree->counters, op, latency);
+
+  return BTREE_SUCCESS;
+}
+
+const char *btree_op_name(btree_op_t op) {
+  static const char *const names[BTREE_N_OPS] = {
+      [BTREE_OP_INSERT] = "insert", [BTREE_OP_REMOVE] = "remove",
+      [BTREE_OP_SEARCH] = "search", [BTREE_OP_SCAN] = "scan",
+      [BTREE_OP_BULK] = "bulk"};
+
+  return op >= 0 && op < BTREE_N_OPS ? names[op] : "?";
+}
+
+int btree_stats(btree_t *tree, btree_stats_t *stats) {
+  if (!tree || !stats)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  stats_read(tree->counters, stats);
+
+  return BTREE_SUCCESS;
+}
+
+size_t btree_max_order(size_t page_size, btree_layout_t layout) {
+  if (page_size != BTREE_PAGE_4K && page_size != BTREE_PAGE_8K &&
+      page_size != BTREE_PAGE_16K)
+    return 0;
+
+  return node_max_order(page_size, layout == BTREE_LAYOUT_BPLUS);
+}
+
+size_t btree_order(btree_t *tree) { return tree ? tree->order : 0; }
+
+btree_io_engine_t btree_io_engine(btree_t *tree) {
+  return tree ? storage_io_engine(tree->st) : BTREE_IO_SYNC;
+}
+
+btree_layout_t btree_layout(btree_t *tree) {
+  return tree && tree->bplus ? BTREE_LAYOUT_BPLUS : BTREE_LAYOUT_BTREE;
+}
+
+void enqueue(int *queue, int page, int *rear) { queue[(*rear)++] = page; }
+
+/**
+ * btree_print() com o latch exclusivo da árvore já obtido
+ */
+static int btree_print_locked(btree_t *tree, FILE *output_fptr) {
+  fprintf(output_fptr, "-- ARVORE B\n");
+
+  if (tree->root == -1)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  node_t *root = bpool_pin(tree->pool, tree->root);
+  if (!root)
+    return BTREE_ERROR_IO;
+
+  node_print(root, output_fptr);
+  fprintf(output_fptr, "\n");
+
+  // Cada página alocada aparece no máximo uma vez na fila
+  int *queue = calloc(bpool_page_count(tree->pool), sizeof(int));
+  if (!queue) {
+    bpool_unpin(tree->pool, root, false);
+    return BTREE_ERROR_ALLOC;
+  }
+  int front = 0, rear = 0;
+  int level = 1;
+  int nodes_curr_lvl = 0;
+  int nodes_nxt_lvl = 0;
+
+  if (!root->is_leaf) {
+    for (int i = 0; i <= root->n_keys; i++) {
+      enqueue(queue, root->children[i], &rear);
+      nodes_nxt_lvl++;
+    }
+  }
+
+  bpool_unpin(tree->pool, root, false);
+
+  while (front < rear) {
+    if (nodes_curr_lvl == 0) {
       nodes_curr_lvl = nodes_nxt_lvl;
       nodes_nxt_lvl = 0;
       level++;
     }
-    node_t *curr = queue[front++];
+    node_t *curr = bpool_pin(tree->pool, queue[front++]);
+    if (!curr) {
+      free(queue);
+      return BTREE_ERROR_IO;
+    }
     nodes_curr_lvl--;
 
     node_print(curr, output_fptr);
 
     if (!curr->is_leaf) {
       for (int i = 0; i <= curr->n_keys; i++) {
-        node_t *child = disk_read(tree->fp, tree->order, curr->children[i]);
-        if (!child) {
-          free(queue);
-          return BTREE_ERROR_IO;
-        }
-
-        enqueue(queue, child, &rear);
+        enqueue(queue, curr->children[i], &rear);
         nodes_nxt_lvl++;
       }
     }
 
+    bpool_unpin(tree->pool, curr, false);
+
     if (nodes_curr_lvl <= 0)
       fprintf(output_fptr, "\n");
   }
@@ -1220,3 +3146,14 @@ int btree_print(btree_t *tree, FILE *output_fptr) {
 
   return BTREE_SUCCESS;
 }
+
+int btree_print(btree_t *tree, FILE *output_fptr) {
+  if (!tree || !tree->st)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  btree_lock(tree);
+  int result = btree_print_locked(tree, output_fptr);
+  btree_unlock(tree);
+
+  return result;
+}
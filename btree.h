@@ -1,6 +1,8 @@
 #ifndef BTREE_H
 #define BTREE_H
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -14,8 +16,178 @@
 
 typedef struct node node_t;
 
+/**
+ * Árvore B armazenada em arquivo
+ *
+ * Buscas, inserções e remoções podem ser feitas por vários threads ao mesmo
+ * tempo: cada página é protegida por um latch e a descida solta o pai assim
+ * que o filho é fixado. Antes disso, buscas e escritas que não dividem nem
+ * mesclam nós tentam descer sem latches, confirmando a versão de cada página
+ * lida, e só fixam o nó alterado. Só essas operações dispensam os latches: as
+ * divisões, mesclas e empréstimos seguem pela descida com latches, e criar,
+ * dividir ou substituir a raiz exige a árvore com exclusividade, o que
+ * serializa as escritas nesse intervalo. Cursores, btree_flush(),
+ * btree_bulk_load() e btree_print() usam a árvore com exclusividade.
+ * btree_destroy() não pode ser chamada com outras operações em andamento
+ */
 typedef struct btree btree_t;
 
+typedef struct btree_cursor btree_cursor_t;
+
+// Tamanhos de página suportados pelo formato do arquivo
+#define BTREE_PAGE_4K 4096
+#define BTREE_PAGE_8K 8192
+#define BTREE_PAGE_16K 16384
+
+// Ordem que deriva a ordem da árvore do tamanho da página
+#define BTREE_ORDER_AUTO 0
+
+// Capacidade padrão do buffer pool, em páginas
+#define BTREE_DEFAULT_POOL_PAGES 256
+
+// Espaço de endereçamento reservado para o backend mmap (64 GiB)
+#define BTREE_DEFAULT_MMAP_RESERVE ((size_t)1 << 36)
+
+// Incremento padrão do mapeamento do backend mmap (1 MiB)
+#define BTREE_DEFAULT_MMAP_CHUNK ((size_t)1 << 20)
+
+// Leituras e escritas simultâneas do mecanismo de E/S io_uring
+#define BTREE_DEFAULT_IO_DEPTH 64
+
+// Operações por commit em grupo do log de redo
+#define BTREE_DEFAULT_WAL_GROUP_OPS 32
+
+// Tamanho do log a partir do qual é feito um checkpoint (64 MiB)
+#define BTREE_DEFAULT_WAL_CHECKPOINT ((size_t)64 << 20)
+
+/**
+ * Backends de acesso ao arquivo binário
+ */
+typedef enum btree_backend {
+  BTREE_BACKEND_PREAD, // pread/pwritev sobre o descritor do arquivo
+  BTREE_BACKEND_MMAP,  // Arquivo mapeado em memória
+
+  // Nome anterior de BTREE_BACKEND_PREAD, de quando o backend usava stdio
+  BTREE_BACKEND_STDIO __attribute__((deprecated)) = BTREE_BACKEND_PREAD,
+} btree_backend_t;
+
+/**
+ * Mecanismos de E/S do backend de descritor
+ */
+typedef enum btree_io_engine {
+  BTREE_IO_SYNC,  // Uma leitura ou escrita por vez
+  BTREE_IO_URING, // io_uring, com várias leituras e escritas em andamento
+} btree_io_engine_t;
+
+/**
+ * Formatos dos nós da árvore
+ */
+typedef enum btree_layout {
+  BTREE_LAYOUT_BTREE, // Registros em todos os nós
+  BTREE_LAYOUT_BPLUS, // Registros só nas folhas, encadeadas entre si
+} btree_layout_t;
+
+/**
+ * Níveis de durabilidade dos commits do log de redo
+ */
+typedef enum btree_durability {
+  BTREE_DURABILITY_NONE,      // Log escrito apenas quando o buffer enche
+  BTREE_DURABILITY_FLUSH,     // Cada grupo é entregue ao sistema operacional
+  BTREE_DURABILITY_FDATASYNC, // Cada grupo é gravado no disco com fdatasync
+} btree_durability_t;
+
+/**
+ * Opções de criação da árvore
+ */
+typedef struct btree_options {
+  size_t page_size;  // Tamanho da página (BTREE_PAGE_4K, 8K ou 16K)
+  size_t pool_pages; // Capacidade do buffer pool, em páginas
+
+  btree_layout_t layout; // Formato dos nós; um arquivo existente mantém o seu
+
+  btree_backend_t backend; // Backend de acesso ao arquivo
+  size_t mmap_reserve;     // Tamanho máximo do arquivo mapeado, em bytes
+  size_t mmap_chunk;       // Incremento do mapeamento, em bytes
+  bool mmap_sync;          // Executa msync a cada escrita de nó
+
+  // Sem io_uring no kernel, a E/S é síncrona; ignorado no backend mmap
+  btree_io_engine_t io_engine; // Mecanismo de E/S do backend de descritor
+  size_t io_depth;             // Transferências simultâneas do io_uring
+
+  bool wal;                      // Registra cada operação em "<arquivo>-wal"
+  btree_durability_t durability; // Nível de durabilidade dos commits do log
+  size_t wal_group_ops;          // Operações efetivadas por commit em grupo
+  size_t wal_checkpoint;         // Tamanho do log que dispara um checkpoint
+} btree_options_t;
+
+/**
+ * Contadores do buffer pool
+ */
+typedef struct btree_cache_stats {
+  size_t hits;       // Acessos resolvidos sem leitura do arquivo
+  size_t misses;     // Acessos que exigiram leitura do arquivo
+  size_t evictions;  // Páginas removidas do pool para dar lugar a outras
+  size_t writebacks; // Páginas sujas escritas no arquivo
+  size_t reused;     // Alocações atendidas pela lista de páginas livres
+  size_t pool_pages; // Capacidade do pool, em páginas
+} btree_cache_stats_t;
+
+// Alturas contadas separadamente em btree_stats_t; as demais somam na última
+#define BTREE_STATS_LEVELS 8
+
+/**
+ * Contadores de operações e de E/S da árvore, desde a sua abertura
+ *
+ * As alturas começam em 0 nas folhas. Páginas lidas no backend mmap sem log
+ * de redo não passam por leitura, mas contam como lidas do arquivo
+ */
+typedef struct btree_stats {
+  size_t page_reads[BTREE_STATS_LEVELS];  // Páginas lidas, por altura
+  size_t page_writes[BTREE_STATS_LEVELS]; // Páginas escritas, por altura
+  size_t cache_hits;    // Acessos resolvidos no buffer pool
+  size_t cache_misses;  // Acessos que exigiram leitura do arquivo
+  size_t splits;        // Divisões de nós, incluindo as da raiz
+  size_t root_splits;   // Divisões da raiz, que aumentam a altura
+  size_t merges;        // Mesclas de nós
+  size_t borrows_left;  // Chaves emprestadas do irmão à esquerda
+  size_t borrows_right; // Chaves emprestadas do irmão à direita
+  size_t file_growth;   // Páginas acrescentadas ao fim do arquivo
+  size_t bytes_read;    // Bytes lidos do arquivo binário
+  size_t bytes_written; // Bytes escritos no arquivo binário
+  size_t wal_bytes;     // Bytes escritos no log de redo
+  size_t flushes;       // Entregas de escritas ao sistema operacional
+  size_t syncs;         // Gravações no disco (fdatasync ou msync)
+} btree_stats_t;
+
+/**
+ * Operações com histograma de latência
+ */
+typedef enum btree_op {
+  BTREE_OP_INSERT, // btree_insert() e btree_upsert()
+  BTREE_OP_REMOVE, // btree_remove()
+  BTREE_OP_SEARCH, // btree_get(), btree_contains() e btree_search()
+  BTREE_OP_SCAN,   // Cada posicionamento ou passo de um cursor
+  BTREE_OP_BULK,   // btree_bulk_load() e btree_insert_batch()
+  BTREE_N_OPS,
+} btree_op_t;
+
+/**
+ * Latências de uma operação, em nanossegundos, desde a abertura da árvore
+ *
+ * Os percentis vêm de um histograma com faixas logarítmicas, cada potência de
+ * 2 dividida em 16 faixas: o valor informado é o limite superior da faixa,
+ * no máximo 6,25% acima do real. O máximo é exato
+ */
+typedef struct btree_latency {
+  size_t count;  // Quantidade de operações medidas
+  double mean;   // Média
+  uint64_t p50;  // Mediana
+  uint64_t p90;  // Percentil 90
+  uint64_t p99;  // Percentil 99
+  uint64_t p999; // Percentil 99,9
+  uint64_t max;  // Maior latência
+} btree_latency_t;
+
 /**
  * Imprime um nó
  *
@@ -26,12 +198,49 @@ void node_print(node_t* node, FILE* output_fptr);
 /**
  * Cria uma nova árvore B e aloca memória para ela
  *
- * @param order Ordem da árvore (mínimo 3)
+ * Cada nó ocupa exatamente uma página de BTREE_PAGE_4K bytes
+ *
+ * @param order Ordem da árvore (mínimo 3) ou BTREE_ORDER_AUTO para a maior
+ * ordem que cabe em uma página
  *
  * @return Ponteiro para a nova árvore ou NULL em caso de erro
  */
 btree_t* btree_create(size_t order, const char* filename, const char* mode);
 
+/**
+ * Preenche as opções de criação com os valores padrão
+ *
+ * @param opts Ponteiro para as opções
+ */
+void btree_options_init(btree_options_t* opts);
+
+/**
+ * Cria uma nova árvore B com opções de criação
+ *
+ * @param order Ordem da árvore (mínimo 3) ou BTREE_ORDER_AUTO para a maior
+ * ordem que cabe em uma página de opts->page_size bytes
+ * @param filename Caminho do arquivo binário
+ * @param mode Modo de abertura do arquivo
+ * @param opts Opções de criação ou NULL para os valores padrão
+ *
+ * @return Ponteiro para a nova árvore ou NULL em caso de erro
+ */
+btree_t* btree_create_ex(size_t order, const char* filename, const char* mode,
+                         const btree_options_t* opts);
+
+/**
+ * Reabre uma árvore B existente a partir do superbloco do arquivo
+ *
+ * A ordem e o tamanho de página são lidos do arquivo; em opts, esses campos
+ * são ignorados. Nenhum nó é lido na abertura
+ *
+ * @param filename Caminho do arquivo binário
+ * @param opts Opções de abertura ou NULL para os valores padrão
+ *
+ * @return Ponteiro para a árvore ou NULL em caso de erro
+ */
+btree_t* btree_open(const char* filename, const btree_options_t* opts);
+
 /**
  * Destrói a árvore B e libera a memória alocada
  *
@@ -47,10 +256,55 @@ void btree_destroy(btree_t* tree);
  * @param pos Ponteiro para pos que irá guardar o índice da chave encontrada
  * ou -1 se não encontrada
  *
- * @return Ponteiro para o nó encontrado ou NULL caso contrário
+ * @return Ponteiro para o nó encontrado ou NULL caso contrário. O nó pertence
+ * ao buffer pool e permanece válido até a próxima operação na árvore; com
+ * escritas concorrentes, use btree_get()
  */
 node_t* btree_search(btree_t* tree, int key, int* pos);
 
+/**
+ * Função que busca o registro associado a uma chave
+ *
+ * Não aloca memória: a descida usa apenas os frames do buffer pool e somente
+ * o registro é copiado
+ *
+ * @param tree Ponteiro para árvore B
+ * @param key Chave a ser buscada
+ * @param value_out Ponteiro para armazenar o registro (pode ser NULL)
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_NOT_FOUND ou código de erro
+ */
+int btree_get(btree_t* tree, int key, int* value_out);
+
+/**
+ * Função que verifica se uma chave está na árvore, sem alocar memória
+ *
+ * @param tree Ponteiro para árvore B
+ * @param key Chave a ser buscada
+ *
+ * @return true se a chave estiver na árvore
+ */
+bool btree_contains(btree_t* tree, int key);
+
+/**
+ * Função que busca os registros de um lote de chaves
+ *
+ * As buscas descem juntas, um nível por vez: cada página do nível é fixada
+ * uma única vez para todas as chaves que passam por ela, e as páginas do
+ * nível são antecipadas (cache da CPU, leitura em lote pelo io_uring ou
+ * leitura em segundo plano) antes da primeira ser visitada
+ *
+ * @param tree Ponteiro para árvore B
+ * @param keys Chaves a serem buscadas
+ * @param n Quantidade de chaves
+ * @param values Recebe o registro de cada chave encontrada (n posições)
+ * @param found Recebe, para cada chave, se ela foi encontrada (n posições)
+ *
+ * @return Quantidade de chaves encontradas ou código de erro
+ */
+int btree_get_batch(btree_t* tree, const int* keys, size_t n, int* values,
+                    bool* found);
+
 /**
  * Função para inserir uma chave na árvore
  *
@@ -61,6 +315,26 @@ node_t* btree_search(btree_t* tree, int key, int* pos);
  */
 int btree_insert(btree_t* tree, int key, int value);
 
+/**
+ * Função para inserir uma chave ou substituir o registro de uma chave
+ * existente
+ *
+ * A chave e a posição de inserção são encontradas na mesma descida, da raiz
+ * até a folha, em que os nós cheios são divididos
+ *
+ * @param tree Ponteiro para árvore B
+ * @param key Chave a ser inserida
+ * @param value Registro associado à chave
+ * @param replaced Ponteiro para flag indicando se a chave já existia (pode
+ * ser NULL)
+ * @param old_value Ponteiro para o registro anterior, escrito apenas se a
+ * chave já existia (pode ser NULL)
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int btree_upsert(btree_t* tree, int key, int value, bool* replaced,
+                 int* old_value);
+
 /**
  * Remove uma chave da árvore
  *
@@ -71,6 +345,46 @@ int btree_insert(btree_t* tree, int key, int value);
  */
 int btree_remove(btree_t* tree, int key);
 
+/**
+ * Constrói a árvore de baixo para cima a partir de um conjunto de pares
+ *
+ * Os nós de cada nível são preenchidos em sequência, folhas primeiro, e as
+ * páginas são alocadas em ordem no arquivo. Entradas fora de ordem são
+ * ordenadas antes da carga; para chaves repetidas, prevalece o último
+ * registro. A árvore precisa estar sem chaves, o que inclui uma árvore
+ * esvaziada por remoções
+ *
+ * @param tree Ponteiro para árvore B
+ * @param keys Chaves
+ * @param values Registros, na mesma ordem das chaves
+ * @param n Quantidade de pares
+ * @param fill Fração de cada nó ocupada pela carga, em (0, 1]; nós nunca
+ * ficam abaixo da ocupação mínima da árvore
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int btree_bulk_load(btree_t* tree, const int* keys, const int* values,
+                    size_t n, double fill);
+
+/**
+ * Insere ou atualiza um lote de pares em uma árvore qualquer
+ *
+ * O lote é ordenado e aplicado em uma passada: cada descida leva à folha da
+ * menor chave pendente, e todas as chaves seguintes que pertencem a essa
+ * folha são aplicadas enquanto ela está fixada. Para chaves repetidas,
+ * prevalece o último registro. Com o log de redo, as alterações são
+ * registradas em poucos registros grandes, cada página uma vez por registro
+ *
+ * @param tree Ponteiro para árvore B
+ * @param keys Chaves
+ * @param values Registros, na mesma ordem das chaves
+ * @param n Quantidade de pares
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int btree_insert_batch(btree_t* tree, const int* keys, const int* values,
+                       size_t n);
+
 /**
  * Imprime a árvore na saída padrão
  *
@@ -78,4 +392,188 @@ int btree_remove(btree_t* tree, int key);
  */
 int btree_print(btree_t* tree, FILE* output_fptr);
 
+/**
+ * Escreve no arquivo todas as páginas alteradas mantidas no buffer pool e o
+ * superbloco
+ *
+ * Com o log de redo habilitado, é um checkpoint: ao final o log é esvaziado
+ *
+ * @param tree Ponteiro para árvore B
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int btree_flush(btree_t* tree);
+
+/**
+ * Cria um cursor para percorrer as chaves da árvore em ordem
+ *
+ * O cursor guarda o caminho da raiz até a chave atual, de modo que avançar
+ * ou recuar costuma acessar apenas o nó atual. Nenhuma página fica fixada
+ * entre as chamadas; se a árvore for alterada, o caminho é refeito a partir
+ * da última chave visitada
+ *
+ * @param tree Ponteiro para árvore B
+ *
+ * @return Ponteiro para o cursor, ainda sem posição, ou NULL em caso de erro
+ */
+btree_cursor_t* btree_cursor_open(btree_t* tree);
+
+/**
+ * Libera a memória alocada pelo cursor
+ *
+ * @param cur Ponteiro para o cursor
+ */
+void btree_cursor_close(btree_cursor_t* cur);
+
+/**
+ * Posiciona o cursor na primeira chave maior ou igual a key
+ *
+ * @param cur Ponteiro para o cursor
+ * @param key Chave procurada
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_NOT_FOUND se todas as chaves forem
+ * menores ou código de erro
+ */
+int btree_cursor_seek(btree_cursor_t* cur, int key);
+
+/**
+ * Posiciona o cursor na menor chave da árvore
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_NOT_FOUND se a árvore estiver vazia ou
+ * código de erro
+ */
+int btree_cursor_first(btree_cursor_t* cur);
+
+/**
+ * Posiciona o cursor na maior chave da árvore
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_NOT_FOUND se a árvore estiver vazia ou
+ * código de erro
+ */
+int btree_cursor_last(btree_cursor_t* cur);
+
+/**
+ * Avança o cursor para a próxima chave
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_NOT_FOUND ao passar da maior chave ou
+ * código de erro
+ */
+int btree_cursor_next(btree_cursor_t* cur);
+
+/**
+ * Recua o cursor para a chave anterior
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_NOT_FOUND ao passar da menor chave ou
+ * código de erro
+ */
+int btree_cursor_prev(btree_cursor_t* cur);
+
+/**
+ * Indica se o cursor está posicionado sobre uma chave
+ */
+bool btree_cursor_valid(const btree_cursor_t* cur);
+
+/**
+ * Lê a chave e o registro sob o cursor
+ *
+ * Os valores são os lidos quando o cursor foi posicionado
+ *
+ * @param cur Ponteiro para o cursor
+ * @param key Recebe a chave (pode ser NULL)
+ * @param value Recebe o registro (pode ser NULL)
+ *
+ * @return BTREE_SUCCESS ou BTREE_ERROR_NOT_FOUND se o cursor não estiver
+ * posicionado
+ */
+int btree_cursor_get(const btree_cursor_t* cur, int* key, int* value);
+
+/**
+ * Retorna a quantidade de chaves armazenadas na árvore
+ *
+ * @param tree Ponteiro para árvore B
+ */
+size_t btree_count(btree_t* tree);
+
+/**
+ * Obtém os contadores do buffer pool da árvore
+ *
+ * @param tree Ponteiro para árvore B
+ * @param stats Ponteiro para a estrutura que receberá os contadores
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int btree_cache_stats(btree_t* tree, btree_cache_stats_t* stats);
+
+/**
+ * Obtém os contadores de operações e de E/S da árvore
+ *
+ * Cada thread conta separadamente e os valores são somados aqui, de modo que
+ * a contagem não disputa linhas de cache entre threads. Com operações em
+ * andamento, os contadores não são lidos todos no mesmo instante
+ *
+ * @param tree Ponteiro para árvore B
+ * @param stats Ponteiro para a estrutura que receberá os contadores
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int btree_stats(btree_t* tree, btree_stats_t* stats);
+
+/**
+ * Obtém os percentis de latência de uma operação
+ *
+ * Cada chamada medida soma uma amostra, tomada com o relógio monotônico, no
+ * histograma do thread que a fez; os histogramas dos threads são somados
+ * aqui. Chamadas que falham também são medidas
+ *
+ * @param tree Ponteiro para árvore B
+ * @param op Operação
+ * @param latency Ponteiro para a estrutura que receberá as latências
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int btree_latency(btree_t* tree, btree_op_t op, btree_latency_t* latency);
+
+/**
+ * Retorna o nome de uma operação, para relatórios
+ *
+ * @param op Operação
+ *
+ * @return Nome da operação ou "?" se op for inválida
+ */
+const char* btree_op_name(btree_op_t op);
+
+/**
+ * Calcula a maior ordem cujo nó cabe em uma página
+ *
+ * Sem registros nos nós internos, a B+ comporta ordens maiores
+ *
+ * @param page_size Tamanho da página (BTREE_PAGE_4K, 8K ou 16K)
+ * @param layout Formato dos nós
+ *
+ * @return Ordem máxima ou 0 se o tamanho de página não for suportado
+ */
+size_t btree_max_order(size_t page_size, btree_layout_t layout);
+
+/**
+ * Retorna a ordem da árvore
+ *
+ * @param tree Ponteiro para árvore B
+ */
+size_t btree_order(btree_t* tree);
+
+/**
+ * Retorna o formato dos nós da árvore
+ *
+ * @param tree Ponteiro para árvore B
+ */
+btree_layout_t btree_layout(btree_t* tree);
+
+/**
+ * Retorna o mecanismo de E/S em uso, que é BTREE_IO_SYNC quando o io_uring
+ * foi pedido mas não está disponível
+ *
+ * @param tree Ponteiro para árvore B
+ */
+btree_io_engine_t btree_io_engine(btree_t* tree);
+
 #endif // !BTREE_H
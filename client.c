@@ -1,6 +1,30 @@
 #include "btree.h"
+#include "opfile.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+/**
+ * Imprime os percentis de latência das operações executadas
+ *
+ * @param tree Ponteiro para árvore B
+ * @param fptr Arquivo de saída
+ */
+static void print_latencies(btree_t *tree, FILE *fptr) {
+  fprintf(fptr, "%-8s %10s %10s %10s %10s %10s %10s\n", "op (ns)", "n",
+          "media", "p50", "p99", "p99.9", "max");
+
+  for (int op = 0; op < BTREE_N_OPS; op++) {
+    btree_latency_t lat;
+    if (btree_latency(tree, op, &lat) != BTREE_SUCCESS || lat.count == 0)
+      continue;
+
+    fprintf(fptr, "%-8s %10zu %10.0f %10lu %10lu %10lu %10lu\n",
+            btree_op_name(op), lat.count, lat.mean, (unsigned long)lat.p50,
+            (unsigned long)lat.p99, (unsigned long)lat.p999,
+            (unsigned long)lat.max);
+  }
+}
 
 int main(int argc, char const *argv[]) {
   if (argc <= 2) {
@@ -8,38 +32,39 @@ int main(int argc, char const *argv[]) {
     return EXIT_FAILURE;
   }
 
-  FILE *input_fptr = fopen(argv[1], "r");
+  opfile_t input;
+  if (opfile_load(argv[1], &input) != BTREE_SUCCESS) {
+    fprintf(stderr, "Invalid input file %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
 
   FILE *output_fptr = fopen(argv[2], "w");
 
-  size_t order;
-  fscanf(input_fptr, "%ld", &order);
-
-  btree_t *tree = btree_create(order, "database", "w+b");
+  size_t order = input.order;
 
-  int op_num;
-  fscanf(input_fptr, "%d\n", &op_num);
-
-  for (int i = op_num; i > 0; i--) {
-    char op = fgetc(input_fptr);
-
-    if (op == 'I') {
-      int key, value;
-      fscanf(input_fptr, "%d, %d\n", &key, &value);
+  // Com "-r", reaproveita o arquivo da execução anterior se a ordem for a mesma
+  btree_t *tree = NULL;
+  if (argc > 3 && strcmp(argv[3], "-r") == 0) {
+    tree = btree_open("database", NULL);
+    if (tree && btree_order(tree) != order) {
+      btree_destroy(tree);
+      tree = NULL;
+    }
+  }
 
-      btree_insert(tree, key, value);
-    } else if (op == 'R') {
-      int key;
-      fscanf(input_fptr, "%d\n", &key);
+  if (!tree)
+    tree = btree_create(order, "database", "w+b");
 
-      btree_remove(tree, key);
-    } else if (op == 'B') {
-      int key;
-      fscanf(input_fptr, "%d\n", &key);
+  // Operações declaradas que faltam no arquivo também são não suportadas
+  for (size_t i = 0; i < input.n_declared; i++) {
+    const opfile_op_t *op = i < input.n_ops ? &input.ops[i] : NULL;
 
-      int pos;
-      node_t *node = btree_search(tree, key, &pos);
-      if (node)
+    if (op && op->type == OPFILE_INSERT) {
+      btree_insert(tree, op->key, op->value);
+    } else if (op && op->type == OPFILE_REMOVE) {
+      btree_remove(tree, op->key);
+    } else if (op && op->type == OPFILE_SEARCH) {
+      if (btree_contains(tree, op->key))
         fprintf(output_fptr, "O REGISTRO ESTA NA ARVORE!\n");
       else
         fprintf(output_fptr, "O REGISTRO NAO ESTA NA ARVORE!\n");
@@ -50,12 +75,20 @@ int main(int argc, char const *argv[]) {
 
   fprintf(output_fptr, "\n");
 
+  // Uma árvore sem raiz só tem o cabeçalho impresso, o que não é um erro
   int result = btree_print(tree, output_fptr);
+  if (result == BTREE_ERROR_INVALID_PARAM)
+    result = BTREE_SUCCESS;
+  else if (result != BTREE_SUCCESS)
+    fprintf(stderr, "Failed to print the tree (%d)\n", result);
+
+  // A saída padrão de erro não se mistura com o resultado das operações
+  print_latencies(tree, stderr);
 
   btree_destroy(tree);
 
-  fclose(input_fptr);
+  opfile_free(&input);
   fclose(output_fptr);
 
-  return 0;
+  return result == BTREE_SUCCESS ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,216 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "kernels.h"
+
+#define NODE_KERNEL static inline __attribute__((always_inline)) void
+
+/**
+ * Marca n posições de um vetor como vazias
+ */
+NODE_KERNEL node_clear(int *a, size_t n) {
+  for (size_t i = 0; i < n; i++)
+    a[i] = -1;
+}
+
+/**
+ * O filho está cheio (order - 1 chaves), então a quantidade de chaves movidas
+ * depende apenas da ordem
+ */
+NODE_KERNEL node_split_kernel(node_t *parent, int idx, node_t *child,
+                              node_t *sibling, size_t order) {
+  size_t t = order / 2;
+  size_t moved = order - 1 - t;
+
+  // Metade superior do filho vai para o novo nó
+  memcpy(sibling->keys, child->keys + t, moved * sizeof(int));
+  memcpy(sibling->values, child->values + t, moved * sizeof(int));
+  sibling->n_keys = moved;
+
+  if (!child->is_leaf) {
+    memcpy(sibling->children, child->children + t, (moved + 1) * sizeof(int));
+    node_clear(child->children + t, moved + 1);
+  }
+
+  // Abre espaço no pai para a chave do meio e para o novo filho
+  size_t tail = parent->n_keys - idx;
+  memmove(parent->keys + idx + 1, parent->keys + idx, tail * sizeof(int));
+  memmove(parent->values + idx + 1, parent->values + idx, tail * sizeof(int));
+  memmove(parent->children + idx + 2, parent->children + idx + 1,
+          tail * sizeof(int));
+
+  parent->keys[idx] = child->keys[t - 1];
+  parent->values[idx] = child->values[t - 1];
+  parent->children[idx + 1] = sibling->bin_pos;
+  parent->n_keys++;
+
+  // Limpa a chave do meio e a metade movida
+  node_clear(child->keys + t - 1, moved + 1);
+  node_clear(child->values + t - 1, moved + 1);
+  child->n_keys = t - 1;
+}
+
+NODE_KERNEL node_merge_kernel(node_t *parent, int idx, node_t *left,
+                              node_t *right, size_t order) {
+  size_t n = left->n_keys, m = right->n_keys;
+  (void)order;
+
+  // Chave do pai seguida de todas as chaves do filho à direita
+  left->keys[n] = parent->keys[idx];
+  left->values[n] = parent->values[idx];
+  memcpy(left->keys + n + 1, right->keys, m * sizeof(int));
+  memcpy(left->values + n + 1, right->values, m * sizeof(int));
+
+  if (!left->is_leaf)
+    memcpy(left->children + n + 1, right->children, (m + 1) * sizeof(int));
+
+  left->n_keys += m + 1;
+
+  // Remove a chave e o filho à direita do pai
+  size_t tail = parent->n_keys - idx - 1;
+  memmove(parent->keys + idx, parent->keys + idx + 1, tail * sizeof(int));
+  memmove(parent->values + idx, parent->values + idx + 1, tail * sizeof(int));
+  memmove(parent->children + idx + 1, parent->children + idx + 2,
+          tail * sizeof(int));
+
+  parent->keys[parent->n_keys - 1] = -1;
+  parent->values[parent->n_keys - 1] = -1;
+  parent->children[parent->n_keys] = -1;
+  parent->n_keys--;
+}
+
+NODE_KERNEL node_borrow_left_kernel(node_t *parent, int idx, node_t *child,
+                                    node_t *sibling, size_t order) {
+  size_t n = child->n_keys, s = sibling->n_keys;
+  (void)order;
+
+  // Abre a primeira posição do filho
+  memmove(child->keys + 1, child->keys, n * sizeof(int));
+  memmove(child->values + 1, child->values, n * sizeof(int));
+
+  child->keys[0] = parent->keys[idx - 1];
+  child->values[0] = parent->values[idx - 1];
+
+  // O primeiro filho recebe o último filho do irmão, se não for folha
+  if (!child->is_leaf) {
+    memmove(child->children + 1, child->children, (n + 1) * sizeof(int));
+    child->children[0] = sibling->children[s];
+    sibling->children[s] = -1;
+  }
+
+  parent->keys[idx - 1] = sibling->keys[s - 1];
+  parent->values[idx - 1] = sibling->values[s - 1];
+
+  sibling->keys[s - 1] = -1;
+  sibling->values[s - 1] = -1;
+
+  child->n_keys++;
+  sibling->n_keys--;
+}
+
+NODE_KERNEL node_borrow_right_kernel(node_t *parent, int idx, node_t *child,
+                                     node_t *sibling, size_t order) {
+  size_t n = child->n_keys, s = sibling->n_keys;
+  (void)order;
+
+  // Última chave do filho recebe a chave do pai
+  child->keys[n] = parent->keys[idx];
+  child->values[n] = parent->values[idx];
+
+  parent->keys[idx] = sibling->keys[0];
+  parent->values[idx] = sibling->values[0];
+
+  memmove(sibling->keys, sibling->keys + 1, (s - 1) * sizeof(int));
+  memmove(sibling->values, sibling->values + 1, (s - 1) * sizeof(int));
+
+  // Se não for folha, também recebe o primeiro filho do irmão
+  if (!child->is_leaf) {
+    child->children[n + 1] = sibling->children[0];
+    memmove(sibling->children, sibling->children + 1, s * sizeof(int));
+    sibling->children[s] = -1;
+  }
+
+  sibling->keys[s - 1] = -1;
+  sibling->values[s - 1] = -1;
+
+  child->n_keys++;
+  sibling->n_keys--;
+}
+
+/**
+ * Gera uma tabela de kernels com a ordem N fixa em tempo de compilação
+ */
+#define NODE_KERNELS(N)                                                        \
+  static void node_split_##N(node_t *parent, int idx, node_t *child,           \
+                             node_t *sibling, size_t order) {                  \
+    (void)order;                                                               \
+    node_split_kernel(parent, idx, child, sibling, N);                         \
+  }                                                                            \
+                                                                               \
+  static void node_merge_##N(node_t *parent, int idx, node_t *left,            \
+                             node_t *right, size_t order) {                    \
+    (void)order;                                                               \
+    node_merge_kernel(parent, idx, left, right, N);                            \
+  }                                                                            \
+                                                                               \
+  static void node_borrow_left_##N(node_t *parent, int idx, node_t *child,     \
+                                   node_t *sibling, size_t order) {            \
+    (void)order;                                                               \
+    node_borrow_left_kernel(parent, idx, child, sibling, N);                   \
+  }                                                                            \
+                                                                               \
+  static void node_borrow_right_##N(node_t *parent, int idx, node_t *child,    \
+                                    node_t *sibling, size_t order) {           \
+    (void)order;                                                               \
+    node_borrow_right_kernel(parent, idx, child, sibling, N);                  \
+  }                                                                            \
+                                                                               \
+  static const node_kernels_t node_kernels_##N = {                             \
+      N, node_split_##N, node_merge_##N, node_borrow_left_##N,                 \
+      node_borrow_right_##N}
+
+NODE_KERNELS(16);
+NODE_KERNELS(64);
+NODE_KERNELS(128);
+
+// Ordens maiores não são especializadas: com o tamanho fixo, o gcc troca as
+// cópias e limpezas da divisão por rep movsq e rep stos, mais lentos que o
+// memcpy() da biblioteca usado pela tabela genérica (na ordem 255, cerca de
+// 220 ns contra 100 ns nas ordens 254 e 256)
+
+static void node_split_generic(node_t *parent, int idx, node_t *child,
+                               node_t *sibling, size_t order) {
+  node_split_kernel(parent, idx, child, sibling, order);
+}
+
+static void node_merge_generic(node_t *parent, int idx, node_t *left,
+                               node_t *right, size_t order) {
+  node_merge_kernel(parent, idx, left, right, order);
+}
+
+static void node_borrow_left_generic(node_t *parent, int idx, node_t *child,
+                                     node_t *sibling, size_t order) {
+  node_borrow_left_kernel(parent, idx, child, sibling, order);
+}
+
+static void node_borrow_right_generic(node_t *parent, int idx, node_t *child,
+                                      node_t *sibling, size_t order) {
+  node_borrow_right_kernel(parent, idx, child, sibling, order);
+}
+
+static const node_kernels_t node_kernels_generic = {
+    0, node_split_generic, node_merge_generic, node_borrow_left_generic,
+    node_borrow_right_generic};
+
+const node_kernels_t *node_kernels_for(size_t order) {
+  switch (order) {
+  case 16:
+    return &node_kernels_16;
+  case 64:
+    return &node_kernels_64;
+  case 128:
+    return &node_kernels_128;
+  default:
+    return &node_kernels_generic;
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <stddef.h>
+
+#include "node.h"
+
+/**
+ * Operações de movimentação de chaves entre nós da árvore B
+ *
+ * Cada ordem especializada tem sua própria tabela, compilada com a ordem
+ * constante: as cópias da divisão têm tamanho fixo e podem ser desenroladas e
+ * vetorizadas. As demais ordens usam a tabela genérica
+ *
+ * Os kernels só movem dados entre nós já fixados no pool; alocação, leitura e
+ * marcação de páginas alteradas ficam com quem os chama
+ */
+typedef struct node_kernels {
+  size_t order; // Ordem especializada ou 0 na tabela genérica
+
+  /**
+   * Divide um filho cheio, movendo a metade superior para sibling (vazio) e
+   * a chave do meio para parent na posição idx
+   */
+  void (*split)(node_t *parent, int idx, node_t *child, node_t *sibling,
+                size_t order);
+
+  /**
+   * Junta o filho idx + 1 ao filho idx junto com a chave idx do pai; o filho
+   * à direita fica vazio
+   */
+  void (*merge)(node_t *parent, int idx, node_t *left, node_t *right,
+                size_t order);
+
+  /**
+   * Passa a última chave do irmão à esquerda, através do pai, para o filho idx
+   */
+  void (*borrow_left)(node_t *parent, int idx, node_t *child, node_t *sibling,
+                      size_t order);
+
+  /**
+   * Passa a primeira chave do irmão à direita, através do pai, para o filho
+   * idx
+   */
+  void (*borrow_right)(node_t *parent, int idx, node_t *child,
+                       node_t *sibling, size_t order);
+} node_kernels_t;
+
+/**
+ * Escolhe a tabela de kernels de uma ordem
+ *
+ * @param order Ordem da árvore
+ *
+ * @return Tabela especializada para a ordem ou a tabela genérica
+ */
+const node_kernels_t *node_kernels_for(size_t order);
+
+#endif // !KERNELS_H
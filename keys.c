@@ -0,0 +1,112 @@
+#include <stddef.h>
+
+#include "keys.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KEYS_X86
+#endif
+
+typedef int (*keys_kernel_fn)(const int *keys, int n, int key);
+
+/**
+ * Versão escalar, também usada para as chaves que sobram após os blocos das
+ * versões vetoriais
+ */
+static int keys_lower_bound_scalar(const int *keys, int n, int key) {
+  int i = 0;
+
+  while (i < n && keys[i] < key)
+    i++;
+
+  return i;
+}
+
+#ifdef KEYS_X86
+/**
+ * Compara blocos de 8 chaves com key; como o vetor é ordenado, o primeiro
+ * bloco com alguma chave maior ou igual contém a resposta e a quantidade de
+ * chaves menores nele é a posição dentro do bloco
+ */
+__attribute__((target("avx2"))) static int
+keys_lower_bound_avx2(const int *keys, int n, int key) {
+  __m256i needle = _mm256_set1_epi32(key);
+  int i = 0;
+
+  for (; i + 8 <= n; i += 8) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)(keys + i));
+    __m256i less = _mm256_cmpgt_epi32(needle, block);
+    unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(less));
+
+    if (mask != 0xff)
+      return i + __builtin_popcount(mask);
+  }
+
+  return i + keys_lower_bound_scalar(keys + i, n - i, key);
+}
+
+/**
+ * Mesma ideia de keys_lower_bound_avx2() com blocos de 4 chaves
+ */
+__attribute__((target("sse4.2"))) static int
+keys_lower_bound_sse42(const int *keys, int n, int key) {
+  __m128i needle = _mm_set1_epi32(key);
+  int i = 0;
+
+  for (; i + 4 <= n; i += 4) {
+    __m128i block = _mm_loadu_si128((const __m128i *)(keys + i));
+    __m128i less = _mm_cmpgt_epi32(needle, block);
+    unsigned mask = _mm_movemask_ps(_mm_castsi128_ps(less));
+
+    if (mask != 0xf)
+      return i + __builtin_popcount(mask);
+  }
+
+  return i + keys_lower_bound_scalar(keys + i, n - i, key);
+}
+#endif
+
+static int keys_lower_bound_resolve(const int *keys, int n, int key);
+
+// Implementação em uso; resolvida na primeira chamada. Threads que chamam
+// ao mesmo tempo podem resolver mais de uma vez, sempre com o mesmo
+// resultado, então basta publicar os valores atomicamente
+static keys_kernel_fn keys_impl = keys_lower_bound_resolve;
+static const char *keys_impl_name = "scalar";
+
+static void keys_select(void) {
+  keys_kernel_fn impl = keys_lower_bound_scalar;
+  const char *name = "scalar";
+
+#ifdef KEYS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    impl = keys_lower_bound_avx2;
+    name = "avx2";
+  } else if (__builtin_cpu_supports("sse4.2")) {
+    impl = keys_lower_bound_sse42;
+    name = "sse4.2";
+  }
+#endif
+
+  // O nome fica visível antes da implementação, lida com acquire
+  __atomic_store_n(&keys_impl_name, name, __ATOMIC_RELAXED);
+  __atomic_store_n(&keys_impl, impl, __ATOMIC_RELEASE);
+}
+
+static int keys_lower_bound_resolve(const int *keys, int n, int key) {
+  keys_select();
+  return keys_lower_bound(keys, n, key);
+}
+
+int keys_lower_bound(const int *keys, int n, int key) {
+  return __atomic_load_n(&keys_impl, __ATOMIC_ACQUIRE)(keys, n, key);
+}
+
+const char *keys_kernel(void) {
+  if (__atomic_load_n(&keys_impl, __ATOMIC_ACQUIRE) ==
+      keys_lower_bound_resolve)
+    keys_select();
+
+  return __atomic_load_n(&keys_impl_name, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,34 @@
+#ifndef KEYS_H
+#define KEYS_H
+
+#include <limits.h>
+
+/**
+ * Posição da primeira chave maior ou igual a key em um vetor ordenado
+ *
+ * A implementação (AVX2, SSE4.2 ou escalar) é escolhida na primeira chamada
+ * de acordo com a CPU
+ *
+ * @param keys Vetor de chaves em ordem crescente
+ * @param n Quantidade de chaves
+ * @param key Chave procurada
+ *
+ * @return Quantidade de chaves menores que key
+ */
+int keys_lower_bound(const int *keys, int n, int key);
+
+/**
+ * Posição da primeira chave maior que key em um vetor ordenado
+ *
+ * @return Quantidade de chaves menores ou iguais a key
+ */
+static inline int keys_upper_bound(const int *keys, int n, int key) {
+  return key == INT_MAX ? n : keys_lower_bound(keys, n, key + 1);
+}
+
+/**
+ * Nome da implementação escolhida ("avx2", "sse4.2" ou "scalar")
+ */
+const char *keys_kernel(void);
+
+#endif // !KEYS_H
@@ -0,0 +1,238 @@
+#ifndef NODE_H
+#define NODE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "btree.h"
+#include "storage.h"
+
+// Página 0 do arquivo é reservada para o cabeçalho; nós começam na página 1
+#define DISK_HEADER_PAGE 0
+#define DISK_FIRST_NODE_PAGE 1
+
+// Identificação do formato no início do superbloco ("BTRE")
+#define DISK_MAGIC 0x42545245u
+#define DISK_VERSION 1
+
+/**
+ * Superbloco do arquivo binário, no início da página DISK_HEADER_PAGE
+ *
+ * Guarda tudo o que é preciso para reabrir a árvore sem percorrê-la.
+ * Páginas liberadas formam uma lista encadeada: cada uma é gravada como um nó
+ * interno vazio cujo children[0] aponta para a próxima página livre
+ */
+typedef struct disk_superblock {
+  uint32_t magic;     // DISK_MAGIC
+  uint32_t version;   // DISK_VERSION
+  uint32_t page_size; // Tamanho das páginas, em bytes
+  uint32_t order;     // Ordem da árvore
+  uint64_t n_pages;   // Quantidade de páginas do arquivo, incluindo esta
+  uint64_t n_keys;    // Quantidade de chaves na árvore
+  int32_t root;       // Página da raiz ou -1 se a árvore estiver vazia
+  int32_t free_head;  // Primeira página livre ou -1 se a lista estiver vazia
+  uint32_t n_free;    // Quantidade de páginas na lista de páginas livres
+  uint32_t layout;    // btree_layout_t dos nós
+} disk_superblock_t;
+
+// Retorno de uma inserção que precisa criar ou dividir a raiz: a troca da
+// raiz exige o latch exclusivo da árvore, então fica com o chamador
+#define NODE_ROOT_FULL (-32)
+
+// Retorno de uma descida otimista que encontrou uma página alterada no
+// caminho ou que precisa de uma divisão ou mescla: a operação é repetida
+#define NODE_RESTART (-33)
+
+// Bits de disk_node_header_t::flags
+#define NODE_FLAG_LEAF 0x01
+
+/**
+ * Cabeçalho de um nó no arquivo binário
+ *
+ * A posição do nó não é armazenada: ela é o próprio número da página. Logo
+ * após o cabeçalho vêm keys[order - 1], values[order - 1] e children[order],
+ * todos alinhados a 4 bytes. Na B+, nós internos guardam keys[order - 1] e
+ * children[order]; folhas guardam siblings[2], keys[order - 1] e
+ * values[order - 1]
+ */
+typedef struct disk_node_header {
+  uint16_t n_keys; // Quantidade de chaves armazenadas
+  uint8_t flags;   // NODE_FLAG_LEAF se o nó for folha
+  uint8_t level;   // Altura do nó, 0 nas folhas; usada só nas estatísticas
+} disk_node_header_t;
+
+struct node {
+  size_t n_keys; // Quantidade de chaves armazenadas
+  int *keys;     // Array de chaves
+  int *values;   // Array de registros
+
+  size_t bin_pos; // Posição no arquivo binário
+  int *children;  // Array offsets para leitura dos filhos em arquivo binário
+  int *siblings;  // Folha B+: páginas da folha anterior e da seguinte
+
+  bool is_leaf;   // Flag indicando se um nó é folha
+  bool bplus;     // Flag indicando o formato B+ (definido na criação)
+  unsigned level; // Altura do nó: 0 nas folhas, a do filho mais um acima
+
+  char *page; // Página no formato do arquivo onde ficam os arrays do nó
+  char *buf;  // Página própria do nó (page aponta para o mapeamento no mmap)
+
+  // Latch da página carregada no nó, obtido e liberado pelo buffer pool
+  pthread_rwlock_t latch;
+  pthread_t owner; // Thread com o latch exclusivo, se houver
+  unsigned depth;  // Fixações exclusivas aninhadas do dono
+
+  // Versão do conteúdo para leituras sem latch: ímpar enquanto o nó está com
+  // o latch exclusivo ou é recarregado, e diferente a cada alteração. Um
+  // latch exclusivo liberado sem alterações devolve a versão anterior
+  uint64_t version;
+  bool modified; // Alterado pelo dono do latch exclusivo atual
+};
+
+/**
+ * Calcula quantos bytes um nó ocupa dentro da página
+ *
+ * @param order Ordem da árvore
+ * @param bplus Flag indicando o formato B+
+ */
+size_t node_disk_size(size_t order, bool bplus);
+
+/**
+ * Calcula a maior ordem cujo nó cabe em uma página
+ *
+ * @param page_size Tamanho da página, em bytes
+ * @param bplus Flag indicando o formato B+
+ */
+size_t node_max_order(size_t page_size, bool bplus);
+
+/**
+ * Calcula o grau mínimo t da árvore: nós fora a raiz têm ao menos t - 1 chaves
+ *
+ * @param order Ordem da árvore
+ */
+int node_min_degree(size_t order);
+
+/**
+ * Inicializa um latch de leitura e escrita que dá preferência às escritas,
+ * para que leitores contínuos não impeçam uma escrita de obtê-lo
+ *
+ * Um thread não deve pedir o mesmo latch duas vezes no modo compartilhado
+ *
+ * @param latch Latch a ser inicializado
+ */
+void node_latch_init(pthread_rwlock_t *latch);
+
+/**
+ * Alocador de nós de uma árvore
+ *
+ * Os nós são alocados em blocos: cada bloco é uma única alocação alinhada com
+ * as páginas dos nós, uma após a outra, seguidas dos cabeçalhos node_t. Nós
+ * liberados voltam para uma lista livre e são reutilizados antes de um novo
+ * bloco ser alocado
+ */
+typedef struct node_slab node_slab_t;
+
+/**
+ * Cria um alocador de nós
+ *
+ * @param bplus Flag indicando o formato B+
+ * @param order Ordem da árvore (i.e. quantidade máxima de filhos de um nó)
+ * @param page_size Tamanho da página, em bytes
+ *
+ * @return Ponteiro para o alocador ou NULL em caso de erro
+ */
+node_slab_t *node_slab_create(bool bplus, size_t order, size_t page_size);
+
+/**
+ * Libera todos os blocos do alocador, inclusive os nós ainda em uso
+ *
+ * @param slab Ponteiro para o alocador
+ */
+void node_slab_destroy(node_slab_t *slab);
+
+/**
+ * Garante que as próximas n alocações não precisem de um novo bloco, alocando
+ * os nós que faltarem em um único bloco
+ *
+ * @param slab Ponteiro para o alocador
+ * @param n Quantidade de nós
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int node_slab_reserve(node_slab_t *slab, size_t n);
+
+/**
+ * Obtém um nó do alocador, já inicializado
+ *
+ * @param slab Ponteiro para o alocador
+ * @param is_leaf Flag indicando se é um nó folha
+ * @param bin_pos Posição do nó no arquivo binário
+ *
+ * @return Ponteiro para o novo nó ou NULL em caso de erro
+ */
+node_t *node_slab_alloc(node_slab_t *slab, bool is_leaf, size_t bin_pos);
+
+/**
+ * Reinicializa um nó já alocado, limpando chaves, registros e filhos
+ *
+ * @param node Nó a ser reinicializado
+ * @param is_leaf Flag indicando se é um nó folha
+ * @param order Ordem da árvore
+ * @param bin_pos Posição do nó no arquivo binário
+ */
+void node_init(node_t *node, bool is_leaf, size_t order, size_t bin_pos);
+
+/**
+ * Devolve um nó para a lista livre do alocador
+ *
+ * @param slab Alocador de onde o nó veio
+ * @param node Ponteiro para o nó a ser liberado
+ */
+void node_slab_free(node_slab_t *slab, node_t *node);
+
+/**
+ * Atualiza o cabeçalho da página do nó, deixando-a no formato do arquivo
+ *
+ * @param node Nó
+ */
+void node_pack(node_t *node);
+
+/**
+ * Lê um nó do arquivo binário para um nó já alocado
+ *
+ * No backend mmap os arrays do nó passam a apontar diretamente para a página
+ * mapeada, sem cópia
+ *
+ * @param st Ponteiro para o arquivo aberto
+ * @param node Nó que receberá o conteúdo lido
+ * @param order Ordem da árvore
+ * @param file_pos Posição do nó no arquivo
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int disk_read(storage_t *st, node_t *node, size_t order, size_t file_pos);
+
+/**
+ * Interpreta como nó uma página já lida do arquivo binário
+ *
+ * @param node Nó que receberá o conteúdo
+ * @param page Página lida (node->buf ou a página mapeada)
+ * @param order Ordem da árvore
+ * @param file_pos Posição do nó no arquivo
+ */
+void disk_unpack(node_t *node, char *page, size_t order, size_t file_pos);
+
+/**
+ * Escreve um nó no arquivo binário
+ *
+ * @param st Ponteiro para o arquivo aberto
+ * @param node Nó a ser escrito
+ * @param order Ordem da árvore
+ *
+ * @return Posição do nó escrito ou código de erro
+ */
+int disk_write(storage_t *st, node_t *node, size_t order);
+
+#endif // !NODE_H
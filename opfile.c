@@ -0,0 +1,260 @@
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "btree.h"
+#include "opfile.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Menor linha que gera uma operação: um caractere e a quebra de linha
+#define OPFILE_MIN_LINE 2
+
+// Bloco lido de cada vez quando o arquivo não pode ser mapeado
+#define OPFILE_READ_CHUNK ((size_t)1 << 20)
+
+/**
+ * Conteúdo do arquivo: o mapeamento ou um buffer lido
+ */
+typedef struct opfile_text {
+  const char *data;
+  size_t len;
+  bool mapped; // Flag indicando que data é um mapeamento
+} opfile_text_t;
+
+/**
+ * Encontra a próxima quebra de linha, comparando 16 bytes de cada vez com
+ * SSE2 quando disponível
+ *
+ * @return Posição da quebra de linha ou end se não houver outra
+ */
+static const char *opfile_newline(const char *p, const char *end) {
+#ifdef __SSE2__
+  const __m128i newline = _mm_set1_epi8('\n');
+
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)p);
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+#endif
+
+  const char *found = memchr(p, '\n', end - p);
+
+  return found ? found : end;
+}
+
+static bool opfile_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' ||
+         c == '\f';
+}
+
+static const char *opfile_skip_space(const char *p, const char *end) {
+  while (p < end && opfile_space(*p))
+    p++;
+
+  return p;
+}
+
+/**
+ * Lê um inteiro decimal com sinal opcional, após espaços, como o "%d" de
+ * scanf
+ *
+ * @return Flag indicando se algum dígito foi lido
+ */
+static bool opfile_int(const char **pos, const char *end, int64_t *out) {
+  const char *p = opfile_skip_space(*pos, end);
+  bool negative = false;
+
+  if (p < end && (*p == '-' || *p == '+'))
+    negative = *p++ == '-';
+
+  const char *digits = p;
+  uint64_t v = 0;
+
+  while (p < end && *p >= '0' && *p <= '9')
+    v = v * 10 + (*p++ - '0');
+
+  if (p == digits)
+    return false;
+
+  *out = negative ? -(int64_t)v : (int64_t)v;
+  *pos = p;
+
+  return true;
+}
+
+/**
+ * Interpreta uma linha de operação, sem os espaços iniciais
+ */
+static opfile_op_t opfile_parse_op(const char *p, const char *end) {
+  opfile_op_t op = {0, 0, OPFILE_INVALID};
+  char type = *p++;
+  int64_t key, value;
+
+  if (type != OPFILE_INSERT && type != OPFILE_REMOVE && type != OPFILE_SEARCH)
+    return op;
+
+  if (!opfile_int(&p, end, &key))
+    return op;
+
+  if (type == OPFILE_INSERT) {
+    p = opfile_skip_space(p, end);
+    if (p == end || *p++ != ',' || !opfile_int(&p, end, &value))
+      return op;
+
+    op.value = (int32_t)value;
+  }
+
+  op.key = (int32_t)key;
+  op.type = type;
+
+  return op;
+}
+
+/**
+ * Lê para um buffer um arquivo que não pode ser mapeado
+ */
+static int opfile_read_all(int fd, opfile_text_t *text) {
+  size_t cap = 0, len = 0;
+  char *buf = NULL;
+
+  for (;;) {
+    if (len == cap) {
+      char *grown = realloc(buf, cap + OPFILE_READ_CHUNK);
+      if (!grown) {
+        free(buf);
+        return BTREE_ERROR_ALLOC;
+      }
+
+      buf = grown;
+      cap += OPFILE_READ_CHUNK;
+    }
+
+    ssize_t n = read(fd, buf + len, cap - len);
+    if (n < 0) {
+      free(buf);
+      return BTREE_ERROR_IO;
+    }
+    if (n == 0)
+      break;
+
+    len += n;
+  }
+
+  text->data = buf;
+  text->len = len;
+  text->mapped = false;
+
+  return BTREE_SUCCESS;
+}
+
+static int opfile_open(const char *filename, opfile_text_t *text) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    return BTREE_ERROR_IO;
+
+  struct stat st;
+  int result = BTREE_ERROR_IO;
+
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    if (addr != MAP_FAILED) {
+      madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+      text->data = addr;
+      text->len = st.st_size;
+      text->mapped = true;
+      result = BTREE_SUCCESS;
+    }
+  }
+
+  if (result != BTREE_SUCCESS)
+    result = opfile_read_all(fd, text);
+
+  close(fd);
+
+  return result;
+}
+
+static void opfile_close(opfile_text_t *text) {
+  if (text->mapped)
+    munmap((void *)text->data, text->len);
+  else
+    free((void *)text->data);
+}
+
+int opfile_load(const char *filename, opfile_t *out) {
+  if (!filename || !out)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  memset(out, 0, sizeof(*out));
+
+  opfile_text_t text;
+  int result = opfile_open(filename, &text);
+  if (result != BTREE_SUCCESS)
+    return result;
+
+  const char *p = text.data, *end = text.data + text.len;
+  int64_t order, declared;
+
+  if (!opfile_int(&p, end, &order) || order < 0 ||
+      !opfile_int(&p, end, &declared)) {
+    opfile_close(&text);
+    return BTREE_ERROR_INVALID_PARAM;
+  }
+
+  out->order = order;
+  out->n_declared = declared > 0 ? declared : 0;
+
+  // Cada operação ocupa ao menos OPFILE_MIN_LINE bytes, o que limita o vetor
+  // sem uma passada só para contar as linhas
+  size_t cap = (end - p) / OPFILE_MIN_LINE + 1;
+  if (cap > out->n_declared)
+    cap = out->n_declared;
+
+  out->ops = malloc((cap ? cap : 1) * sizeof(opfile_op_t));
+  if (!out->ops) {
+    opfile_close(&text);
+    return BTREE_ERROR_ALLOC;
+  }
+
+  while (p < end && out->n_ops < cap) {
+    const char *eol = opfile_newline(p, end);
+    const char *start = opfile_skip_space(p, eol);
+
+    if (start < eol)
+      out->ops[out->n_ops++] = opfile_parse_op(start, eol);
+
+    p = eol < end ? eol + 1 : end;
+  }
+
+  opfile_close(&text);
+
+  // Devolve a sobra da estimativa
+  if (out->n_ops && out->n_ops < cap) {
+    opfile_op_t *ops = realloc(out->ops, out->n_ops * sizeof(opfile_op_t));
+    if (ops)
+      out->ops = ops;
+  }
+
+  return BTREE_SUCCESS;
+}
+
+void opfile_free(opfile_t *file) {
+  if (!file)
+    return;
+
+  free(file->ops);
+  file->ops = NULL;
+  file->n_ops = file->n_declared = 0;
+}
@@ -0,0 +1,60 @@
+#ifndef OPFILE_H
+#define OPFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Tipos de operação do arquivo de entrada, com a letra usada no arquivo
+ */
+typedef enum opfile_type {
+  OPFILE_INSERT = 'I',  // "I chave, registro"
+  OPFILE_REMOVE = 'R',  // "R chave"
+  OPFILE_SEARCH = 'B',  // "B chave"
+  OPFILE_INVALID = '?', // Linha que não segue nenhum dos formatos
+} opfile_type_t;
+
+/**
+ * Operação lida do arquivo
+ */
+typedef struct opfile_op {
+  int32_t key;   // Chave
+  int32_t value; // Registro, só nas inserções
+  uint8_t type;  // opfile_type_t
+} opfile_op_t;
+
+/**
+ * Arquivo de entrada do cliente: a ordem na primeira linha, a quantidade de
+ * operações na segunda e uma operação por linha em seguida
+ */
+typedef struct opfile {
+  size_t order;      // Ordem da árvore
+  size_t n_declared; // Quantidade de operações declarada no arquivo
+  size_t n_ops;      // Operações lidas (até n_declared)
+  opfile_op_t *ops;  // Operações, na ordem do arquivo
+} opfile_t;
+
+/**
+ * Lê o arquivo de entrada inteiro para um vetor de operações
+ *
+ * O arquivo é mapeado em memória e interpretado sem cópias; arquivos que não
+ * podem ser mapeados, como pipes, são lidos para um buffer. Linhas em branco
+ * são ignoradas e a leitura para depois de n_declared operações
+ *
+ * @param filename Caminho do arquivo
+ * @param out Estrutura que receberá as operações
+ *
+ * @return BTREE_SUCCESS, BTREE_ERROR_IO se o arquivo não puder ser lido,
+ * BTREE_ERROR_INVALID_PARAM se o cabeçalho for inválido ou
+ * BTREE_ERROR_ALLOC
+ */
+int opfile_load(const char *filename, opfile_t *out);
+
+/**
+ * Libera as operações lidas
+ *
+ * @param file Arquivo lido por opfile_load()
+ */
+void opfile_free(opfile_t *file);
+
+#endif // !OPFILE_H
@@ -0,0 +1,288 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+/**
+ * Contadores de um thread, em linhas de cache próprias
+ */
+typedef struct stats_slot {
+  _Alignas(64) size_t counters[STATS_N_COUNTERS];
+  size_t page_reads[BTREE_STATS_LEVELS];  // Páginas lidas, por altura
+  size_t page_writes[BTREE_STATS_LEVELS]; // Páginas escritas, por altura
+} stats_slot_t;
+
+/**
+ * Histograma de latências de uma operação
+ */
+typedef struct stats_hist {
+  uint64_t sum;                       // Soma das latências
+  uint64_t max;                       // Maior latência
+  size_t buckets[STATS_HIST_BUCKETS]; // Amostras de cada faixa
+} stats_hist_t;
+
+struct stats {
+  stats_slot_t *slots; // STATS_SLOTS conjuntos de contadores
+
+  // Histogramas de cada thread, BTREE_N_OPS por conjunto, alocados no
+  // primeiro registro do thread
+  stats_hist_t *hists[STATS_SLOTS];
+};
+
+// Quantidade de threads que já usaram contadores, em qualquer árvore
+static unsigned stats_threads;
+
+// Número do thread atual mais um, ou 0 antes do primeiro uso
+static __thread unsigned stats_thread;
+
+/**
+ * Retorna os contadores do thread atual
+ *
+ * O número do thread é o mesmo em todas as árvores, de modo que threads
+ * diferentes só dividem contadores depois de STATS_SLOTS threads
+ */
+static size_t stats_slot_idx(void) {
+  if (stats_thread == 0)
+    stats_thread = __atomic_add_fetch(&stats_threads, 1, __ATOMIC_RELAXED);
+
+  return (stats_thread - 1) % STATS_SLOTS;
+}
+
+static stats_slot_t *stats_slot(stats_t *stats) {
+  return &stats->slots[stats_slot_idx()];
+}
+
+stats_t *stats_create(void) {
+  stats_t *stats = malloc(sizeof(stats_t));
+  if (!stats)
+    return NULL;
+
+  stats->slots = aligned_alloc(64, STATS_SLOTS * sizeof(stats_slot_t));
+  if (!stats->slots) {
+    free(stats);
+    return NULL;
+  }
+
+  memset(stats->slots, 0, STATS_SLOTS * sizeof(stats_slot_t));
+
+  for (size_t i = 0; i < STATS_SLOTS; i++)
+    stats->hists[i] = NULL;
+
+  return stats;
+}
+
+void stats_destroy(stats_t *stats) {
+  if (!stats)
+    return;
+
+  for (size_t i = 0; i < STATS_SLOTS; i++)
+    free(stats->hists[i]);
+
+  free(stats->slots);
+  free(stats);
+}
+
+void stats_add(stats_t *stats, stats_counter_t counter, size_t n) {
+  if (!stats)
+    return;
+
+  // Sem disputa, a soma atômica não sai da linha de cache do thread
+  __atomic_fetch_add(&stats_slot(stats)->counters[counter], n,
+                     __ATOMIC_RELAXED);
+}
+
+void stats_page(stats_t *stats, unsigned level, bool write) {
+  if (!stats)
+    return;
+
+  if (level >= BTREE_STATS_LEVELS)
+    level = BTREE_STATS_LEVELS - 1;
+
+  stats_slot_t *slot = stats_slot(stats);
+  size_t *counter =
+      write ? &slot->page_writes[level] : &slot->page_reads[level];
+
+  __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Soma um contador em todos os conjuntos
+ */
+static size_t stats_sum(const stats_t *stats, size_t offset) {
+  size_t sum = 0;
+
+  for (size_t s = 0; s < STATS_SLOTS; s++) {
+    const size_t *counter =
+        (const size_t *)((const char *)&stats->slots[s] + offset);
+    sum += __atomic_load_n(counter, __ATOMIC_RELAXED);
+  }
+
+  return sum;
+}
+
+#define STATS_SUM(stats, field) stats_sum(stats, offsetof(stats_slot_t, field))
+
+void stats_read(const stats_t *stats, btree_stats_t *out) {
+  if (!out)
+    return;
+
+  memset(out, 0, sizeof(*out));
+  if (!stats)
+    return;
+
+  for (size_t l = 0; l < BTREE_STATS_LEVELS; l++) {
+    out->page_reads[l] = STATS_SUM(stats, page_reads[l]);
+    out->page_writes[l] = STATS_SUM(stats, page_writes[l]);
+  }
+
+  out->cache_hits = STATS_SUM(stats, counters[STATS_CACHE_HITS]);
+  out->cache_misses = STATS_SUM(stats, counters[STATS_CACHE_MISSES]);
+  out->splits = STATS_SUM(stats, counters[STATS_SPLITS]);
+  out->root_splits = STATS_SUM(stats, counters[STATS_ROOT_SPLITS]);
+  out->merges = STATS_SUM(stats, counters[STATS_MERGES]);
+  out->borrows_left = STATS_SUM(stats, counters[STATS_BORROWS_LEFT]);
+  out->borrows_right = STATS_SUM(stats, counters[STATS_BORROWS_RIGHT]);
+  out->file_growth = STATS_SUM(stats, counters[STATS_FILE_GROWTH]);
+  out->bytes_read = STATS_SUM(stats, counters[STATS_BYTES_READ]);
+  out->bytes_written = STATS_SUM(stats, counters[STATS_BYTES_WRITTEN]);
+  out->wal_bytes = STATS_SUM(stats, counters[STATS_WAL_BYTES]);
+  out->flushes = STATS_SUM(stats, counters[STATS_FLUSHES]);
+  out->syncs = STATS_SUM(stats, counters[STATS_SYNCS]);
+}
+
+uint64_t stats_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/**
+ * Faixa do histograma de uma latência: o expoente da maior potência de 2 e
+ * os STATS_HIST_BITS bits seguintes
+ */
+static size_t stats_bucket(uint64_t ns) {
+  if (ns < (1u << STATS_HIST_BITS))
+    return ns;
+
+  unsigned exp = 63 - __builtin_clzll(ns);
+  if (exp > STATS_HIST_MAX_EXP)
+    return STATS_HIST_BUCKETS - 1;
+
+  size_t sub = (ns >> (exp - STATS_HIST_BITS)) & ((1u << STATS_HIST_BITS) - 1);
+
+  return ((size_t)(exp - STATS_HIST_BITS + 1) << STATS_HIST_BITS) + sub;
+}
+
+/**
+ * Maior latência contada em uma faixa
+ */
+static uint64_t stats_bucket_top(size_t bucket) {
+  if (bucket < (1u << STATS_HIST_BITS))
+    return bucket;
+
+  unsigned shift = (bucket >> STATS_HIST_BITS) - 1;
+  uint64_t sub = bucket & ((1u << STATS_HIST_BITS) - 1);
+
+  return (((1u << STATS_HIST_BITS) + sub + 1) << shift) - 1;
+}
+
+void stats_record(stats_t *stats, btree_op_t op, uint64_t start) {
+  if (!stats || op >= BTREE_N_OPS)
+    return;
+
+  uint64_t ns = stats_now() - start;
+  size_t idx = stats_slot_idx();
+
+  stats_hist_t *hists = __atomic_load_n(&stats->hists[idx], __ATOMIC_ACQUIRE);
+  if (!hists) {
+    stats_hist_t *fresh = calloc(BTREE_N_OPS, sizeof(stats_hist_t));
+    if (!fresh)
+      return;
+
+    // Outro thread do mesmo conjunto pode ter alocado antes
+    if (__atomic_compare_exchange_n(&stats->hists[idx], &hists, fresh, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      hists = fresh;
+    } else {
+      free(fresh);
+    }
+  }
+
+  stats_hist_t *hist = &hists[op];
+  __atomic_fetch_add(&hist->buckets[stats_bucket(ns)], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&hist->sum, ns, __ATOMIC_RELAXED);
+
+  uint64_t max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+  while (ns > max && !__atomic_compare_exchange_n(&hist->max, &max, ns, true,
+                                                  __ATOMIC_RELAXED,
+                                                  __ATOMIC_RELAXED))
+    ;
+}
+
+/**
+ * Menor latência que cobre a fração q das amostras
+ */
+static uint64_t stats_quantile(const size_t *buckets, size_t count,
+                               uint64_t max, double q) {
+  size_t rank = (size_t)(q * count);
+  if (rank < q * count)
+    rank++;
+  if (rank == 0)
+    rank = 1;
+
+  size_t seen = 0;
+
+  for (size_t b = 0; b < STATS_HIST_BUCKETS; b++) {
+    seen += buckets[b];
+    if (seen >= rank) {
+      uint64_t top = stats_bucket_top(b);
+      return top < max ? top : max;
+    }
+  }
+
+  return max;
+}
+
+void stats_latency(const stats_t *stats, btree_op_t op, btree_latency_t *out) {
+  if (!out)
+    return;
+
+  memset(out, 0, sizeof(*out));
+  if (!stats || op >= BTREE_N_OPS)
+    return;
+
+  size_t buckets[STATS_HIST_BUCKETS] = {0};
+  uint64_t sum = 0;
+
+  for (size_t s = 0; s < STATS_SLOTS; s++) {
+    stats_hist_t *hists = __atomic_load_n(&stats->hists[s], __ATOMIC_ACQUIRE);
+    if (!hists)
+      continue;
+
+    const stats_hist_t *hist = &hists[op];
+    for (size_t b = 0; b < STATS_HIST_BUCKETS; b++)
+      buckets[b] += __atomic_load_n(&hist->buckets[b], __ATOMIC_RELAXED);
+
+    sum += __atomic_load_n(&hist->sum, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&hist->max, __ATOMIC_RELAXED);
+    if (max > out->max)
+      out->max = max;
+  }
+
+  // A quantidade vem das faixas lidas, para que os percentis as percorram
+  // até o fim mesmo com registros em andamento
+  for (size_t b = 0; b < STATS_HIST_BUCKETS; b++)
+    out->count += buckets[b];
+
+  if (out->count == 0)
+    return;
+
+  out->mean = (double)sum / out->count;
+  out->p50 = stats_quantile(buckets, out->count, out->max, 0.5);
+  out->p90 = stats_quantile(buckets, out->count, out->max, 0.9);
+  out->p99 = stats_quantile(buckets, out->count, out->max, 0.99);
+  out->p999 = stats_quantile(buckets, out->count, out->max, 0.999);
+}
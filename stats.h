@@ -0,0 +1,129 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "btree.h"
+
+/**
+ * Contadores de operações e de E/S e histogramas de latência de uma árvore
+ *
+ * Cada thread soma nos seus próprios contadores, em uma linha de cache só
+ * dele, sem lock e sem disputa com os demais; a leitura percorre os
+ * contadores de todos os threads e soma os valores. Com mais threads do que
+ * STATS_SLOTS, alguns passam a dividir contadores, que continuam corretos
+ */
+typedef struct stats stats_t;
+
+// Conjuntos de contadores de uma árvore, um por thread
+#define STATS_SLOTS 64
+
+// Bits de cada potência de 2 nos histogramas de latência: 16 faixas por
+// potência, com erro relativo de até 6,25%
+#define STATS_HIST_BITS 4
+
+// Maior potência de 2 distinguida nos histogramas (2^47 ns, cerca de 39 h);
+// latências maiores ficam na última faixa
+#define STATS_HIST_MAX_EXP 47
+
+// Faixas de um histograma: valores abaixo de 2^STATS_HIST_BITS têm uma faixa
+// cada, e cada potência seguinte tem 2^STATS_HIST_BITS
+#define STATS_HIST_BUCKETS \
+  ((STATS_HIST_MAX_EXP - STATS_HIST_BITS + 2) << STATS_HIST_BITS)
+
+/**
+ * Contadores individuais
+ */
+typedef enum stats_counter {
+  STATS_CACHE_HITS,    // Acessos resolvidos no buffer pool
+  STATS_CACHE_MISSES,  // Acessos que exigiram leitura do arquivo
+  STATS_SPLITS,        // Divisões de nós
+  STATS_ROOT_SPLITS,   // Divisões da raiz, que aumentam a altura
+  STATS_MERGES,        // Mesclas de nós
+  STATS_BORROWS_LEFT,  // Empréstimos do irmão à esquerda
+  STATS_BORROWS_RIGHT, // Empréstimos do irmão à direita
+  STATS_FILE_GROWTH,   // Páginas acrescentadas ao fim do arquivo
+  STATS_BYTES_READ,    // Bytes lidos do arquivo binário
+  STATS_BYTES_WRITTEN, // Bytes escritos no arquivo binário
+  STATS_WAL_BYTES,     // Bytes escritos no log de redo
+  STATS_FLUSHES,       // Entregas de escritas ao sistema operacional
+  STATS_SYNCS,         // Gravações no disco (fdatasync ou msync)
+  STATS_N_COUNTERS,
+} stats_counter_t;
+
+/**
+ * Cria um conjunto de contadores zerados
+ *
+ * @return Ponteiro para os contadores ou NULL em caso de erro
+ */
+stats_t *stats_create(void);
+
+/**
+ * Libera os contadores
+ *
+ * @param stats Ponteiro para os contadores ou NULL
+ */
+void stats_destroy(stats_t *stats);
+
+/**
+ * Soma n a um contador do thread atual
+ *
+ * @param stats Ponteiro para os contadores ou NULL, que ignora a soma
+ * @param counter Contador
+ * @param n Valor somado
+ */
+void stats_add(stats_t *stats, stats_counter_t counter, size_t n);
+
+/**
+ * Conta uma página lida do arquivo ou escrita nele
+ *
+ * @param stats Ponteiro para os contadores ou NULL, que ignora a contagem
+ * @param level Altura do nó (0 nas folhas); alturas a partir de
+ * BTREE_STATS_LEVELS - 1 são somadas na última posição
+ * @param write Flag indicando escrita
+ */
+void stats_page(stats_t *stats, unsigned level, bool write);
+
+/**
+ * Lê o relógio monotônico
+ *
+ * @return Instante atual, em nanossegundos
+ */
+uint64_t stats_now(void);
+
+/**
+ * Registra no histograma do thread atual a latência de uma operação
+ *
+ * O histograma de cada thread é alocado no seu primeiro registro; sem
+ * memória, a amostra é descartada
+ *
+ * @param stats Ponteiro para os contadores ou NULL, que ignora o registro
+ * @param op Operação
+ * @param start Instante em que a operação começou, lido com stats_now()
+ */
+void stats_record(stats_t *stats, btree_op_t op, uint64_t start);
+
+/**
+ * Soma os histogramas de uma operação de todos os threads e calcula os
+ * percentis
+ *
+ * @param stats Ponteiro para os contadores ou NULL, que lê tudo zerado
+ * @param op Operação
+ * @param out Estrutura que receberá as latências
+ */
+void stats_latency(const stats_t *stats, btree_op_t op, btree_latency_t *out);
+
+/**
+ * Soma os contadores de todos os threads
+ *
+ * Os contadores continuam mudando durante a leitura: cada um é lido
+ * atomicamente, mas não todos no mesmo instante
+ *
+ * @param stats Ponteiro para os contadores ou NULL, que lê tudo zerado
+ * @param out Estrutura que receberá as somas
+ */
+void stats_read(const stats_t *stats, btree_stats_t *out);
+
+#endif // !STATS_H
@@ -0,0 +1,559 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "stats.h"
+#include "storage.h"
+#include "uring.h"
+
+struct storage {
+  btree_backend_t backend; // Backend de acesso ao arquivo
+  int fd;                  // Descritor do arquivo
+  size_t size;             // Tamanho lógico do arquivo
+  size_t page_size;        // Tamanho das páginas da árvore
+
+  // Backend mmap
+  char *base;      // Início da região reservada para o mapeamento
+  size_t reserve;  // Tamanho da região reservada
+  size_t mapped;   // Bytes do arquivo atualmente mapeados
+  size_t chunk;    // Incremento do mapeamento
+  size_t os_page;  // Tamanho da página do sistema operacional
+  bool writable;   // Flag indicando se o arquivo aceita escritas
+  bool sync_each;  // Flag indicando msync a cada escrita
+  bool zero_copy;  // Flag indicando se nós podem apontar para o mapeamento
+
+  uring_t *ring; // Fila io_uring ou NULL para E/S síncrona
+
+  stats_t *counters; // Contadores da árvore ou NULL
+};
+
+static size_t round_up(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+/**
+ * Tamanho lógico do arquivo, que pode crescer durante a leitura de outro
+ * thread
+ */
+static size_t storage_cur_size(const storage_t *st) {
+  return __atomic_load_n(&st->size, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Lê len bytes em offset sem usar a posição compartilhada do descritor, de
+ * modo que leituras de threads diferentes não interferem entre si
+ */
+static int storage_pread(storage_t *st, size_t offset, void *buf, size_t len) {
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t n = pread(st->fd, (char *)buf + done, len - done, offset + done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return BTREE_ERROR_IO;
+
+    done += n;
+  }
+
+  return BTREE_SUCCESS;
+}
+
+static int storage_pwrite(storage_t *st, size_t offset, const void *buf,
+                          size_t len) {
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t n =
+        pwrite(st->fd, (const char *)buf + done, len - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return BTREE_ERROR_IO;
+    }
+
+    done += n;
+  }
+
+  return BTREE_SUCCESS;
+}
+
+/**
+ * Lê ou escreve n páginas consecutivas a partir de offset com uma única
+ * chamada preadv/pwritev, repetida apenas para o que uma transferência
+ * parcial deixar de fora
+ */
+static int storage_prwv(storage_t *st, size_t offset, void *const *bufs,
+                        size_t n, bool write) {
+  struct iovec iov[STORAGE_MAX_RUN];
+  size_t len = st->page_size;
+
+  for (size_t i = 0; i < n; i++) {
+    iov[i].iov_base = bufs[i];
+    iov[i].iov_len = len;
+  }
+
+  struct iovec *cur = iov;
+  size_t left = n;
+
+  while (left > 0) {
+    ssize_t done = write ? pwritev(st->fd, cur, left, offset)
+                         : preadv(st->fd, cur, left, offset);
+    if (done < 0 && errno == EINTR)
+      continue;
+    if (done < 0 || (done == 0 && !write))
+      return BTREE_ERROR_IO;
+
+    offset += done;
+
+    // Descarta os vetores já transferidos e ajusta o primeiro incompleto
+    while (left > 0 && (size_t)done >= cur->iov_len) {
+      done -= cur->iov_len;
+      cur++;
+      left--;
+    }
+
+    if (left > 0) {
+      cur->iov_base = (char *)cur->iov_base + done;
+      cur->iov_len -= done;
+    }
+  }
+
+  return BTREE_SUCCESS;
+}
+
+/**
+ * Converte um modo de fopen() nas flags equivalentes de open()
+ *
+ * O modo "a" não usa O_APPEND, que faria pwrite ignorar o deslocamento
+ *
+ * @return Flags de open() ou -1 se o modo for inválido
+ */
+static int storage_open_flags(const char *mode) {
+  bool plus = strchr(mode, '+') != NULL;
+
+  switch (mode[0]) {
+  case 'r':
+    return plus ? O_RDWR : O_RDONLY;
+  case 'w':
+    return (plus ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC;
+  case 'a':
+    return (plus ? O_RDWR : O_WRONLY) | O_CREAT;
+  default:
+    return -1;
+  }
+}
+
+/**
+ * Mapeia o arquivo até new_mapped bytes dentro da região reservada
+ *
+ * A região é reservada inteira na abertura, de modo que o mapeamento cresce
+ * sem mudar de endereço
+ */
+static int storage_map_grow(storage_t *st, size_t new_mapped) {
+  if (new_mapped <= st->mapped)
+    return BTREE_SUCCESS;
+
+  if (new_mapped > st->reserve)
+    return BTREE_ERROR_IO;
+
+  if (st->writable && ftruncate(st->fd, new_mapped) != 0)
+    return BTREE_ERROR_IO;
+
+  int prot = PROT_READ | (st->writable ? PROT_WRITE : 0);
+  void *addr = mmap(st->base + st->mapped, new_mapped - st->mapped, prot,
+                    MAP_SHARED | MAP_FIXED, st->fd, st->mapped);
+  if (addr == MAP_FAILED)
+    return BTREE_ERROR_IO;
+
+  __atomic_store_n(&st->mapped, new_mapped, __ATOMIC_RELEASE);
+
+  return BTREE_SUCCESS;
+}
+
+static int storage_mmap_open(storage_t *st, const btree_options_t *opts) {
+  size_t page = st->os_page = sysconf(_SC_PAGESIZE);
+
+  // O incremento precisa conter páginas inteiras da árvore
+  if (st->page_size > page)
+    page = st->page_size;
+
+  st->chunk = round_up(opts->mmap_chunk ? opts->mmap_chunk : page, page);
+  st->reserve = round_up(opts->mmap_reserve, st->chunk);
+  st->sync_each = opts->mmap_sync;
+
+  // Com o log de redo, uma alteração no mapeamento chegaria ao arquivo antes
+  // do registro correspondente
+  st->zero_copy = !opts->wal;
+
+  void *base = mmap(NULL, st->reserve, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED)
+    return BTREE_ERROR_IO;
+
+  st->base = base;
+
+  // Somente leitura: mapeia exatamente o que existe no arquivo
+  size_t target =
+      st->writable ? round_up(st->size, st->chunk) : round_up(st->size, page);
+
+  return storage_map_grow(st, target);
+}
+
+storage_t *storage_open(const char *filename, const char *mode,
+                        const btree_options_t *opts, stats_t *counters) {
+  if (!filename || !mode || !opts)
+    return NULL;
+
+  storage_t *st = calloc(1, sizeof(storage_t));
+  if (!st)
+    return NULL;
+
+  st->backend = opts->backend;
+  st->page_size = opts->page_size;
+  st->counters = counters;
+  st->writable = strpbrk(mode, "wa+") != NULL;
+
+  // O acesso é posicional pelo descritor, sem o buffer e a posição
+  // compartilhada de um FILE
+  int flags = storage_open_flags(mode);
+  st->fd = flags == -1 ? -1 : open(filename, flags | O_CLOEXEC, 0666);
+  if (st->fd == -1) {
+    free(st);
+    return NULL;
+  }
+
+  struct stat sb;
+  if (fstat(st->fd, &sb) != 0) {
+    storage_close(st);
+    return NULL;
+  }
+  st->size = sb.st_size;
+
+  if (st->backend == BTREE_BACKEND_MMAP &&
+      storage_mmap_open(st, opts) != BTREE_SUCCESS) {
+    storage_close(st);
+    return NULL;
+  }
+
+  // No mmap as páginas já estão em memória. Sem io_uring no kernel, a E/S
+  // continua síncrona
+  if (st->backend == BTREE_BACKEND_PREAD && opts->io_engine == BTREE_IO_URING)
+    st->ring = uring_create(opts->io_depth);
+
+  return st;
+}
+
+void storage_close(storage_t *st) {
+  if (!st)
+    return;
+
+  if (st->base) {
+    if (st->mapped > 0)
+      msync(st->base, st->mapped, MS_SYNC);
+
+    munmap(st->base, st->reserve);
+
+    // Descarta a folga do último incremento do mapeamento
+    if (st->writable && st->mapped > st->size)
+      if (ftruncate(st->fd, st->size) != 0)
+        perror("ftruncate");
+  }
+
+  uring_destroy(st->ring);
+
+  if (st->fd != -1)
+    close(st->fd);
+
+  free(st);
+}
+
+int storage_read(storage_t *st, size_t offset, void *buf, size_t len) {
+  if (!st || !buf || offset + len > storage_cur_size(st))
+    return BTREE_ERROR_IO;
+
+  if (st->backend == BTREE_BACKEND_MMAP)
+    memcpy(buf, st->base + offset, len);
+  else if (storage_pread(st, offset, buf, len) != BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
+
+  stats_add(st->counters, STATS_BYTES_READ, len);
+
+  return BTREE_SUCCESS;
+}
+
+int storage_write(storage_t *st, size_t offset, const void *buf, size_t len) {
+  if (!st || !buf || !st->writable)
+    return BTREE_ERROR_IO;
+
+  if (st->backend == BTREE_BACKEND_MMAP) {
+    if (storage_map_grow(st, round_up(offset + len, st->chunk)) !=
+        BTREE_SUCCESS)
+      return BTREE_ERROR_IO;
+
+    // Páginas fixadas no pool podem ser a própria região mapeada
+    if (st->base + offset != buf)
+      memcpy(st->base + offset, buf, len);
+
+    if (st->sync_each) {
+      size_t start = offset / st->os_page * st->os_page;
+      if (msync(st->base + start, offset + len - start, MS_SYNC) != 0)
+        return BTREE_ERROR_IO;
+
+      stats_add(st->counters, STATS_SYNCS, 1);
+    }
+  } else if (storage_pwrite(st, offset, buf, len) != BTREE_SUCCESS) {
+    return BTREE_ERROR_IO;
+  }
+
+  stats_add(st->counters, STATS_BYTES_WRITTEN, len);
+
+  if (offset + len > st->size)
+    __atomic_store_n(&st->size, offset + len, __ATOMIC_RELEASE);
+
+  return BTREE_SUCCESS;
+}
+
+int storage_read_page(storage_t *st, size_t page, void *buf) {
+  if (!st)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  return storage_read(st, page * st->page_size, buf, st->page_size);
+}
+
+int storage_write_page(storage_t *st, size_t page, const void *buf) {
+  if (!st)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  return storage_write(st, page * st->page_size, buf, st->page_size);
+}
+
+int storage_write_pages(storage_t *st, size_t page, const void *const *bufs,
+                        size_t n) {
+  if (!st || !bufs || !st->writable)
+    return BTREE_ERROR_IO;
+
+  size_t len = st->page_size;
+
+  while (n > 0) {
+    size_t run = n < STORAGE_MAX_RUN ? n : STORAGE_MAX_RUN;
+    size_t offset = page * len;
+
+    if (st->backend == BTREE_BACKEND_MMAP) {
+      for (size_t i = 0; i < run; i++)
+        if (storage_write(st, offset + i * len, bufs[i], len) != BTREE_SUCCESS)
+          return BTREE_ERROR_IO;
+    } else {
+      if (storage_prwv(st, offset, (void *const *)bufs, run, true) !=
+          BTREE_SUCCESS)
+        return BTREE_ERROR_IO;
+
+      stats_add(st->counters, STATS_BYTES_WRITTEN, run * len);
+
+      if (offset + run * len > st->size)
+        __atomic_store_n(&st->size, offset + run * len, __ATOMIC_RELEASE);
+    }
+
+    page += run;
+    bufs += run;
+    n -= run;
+  }
+
+  return BTREE_SUCCESS;
+}
+
+/**
+ * Executa um lote pela fila io_uring
+ *
+ * @return BTREE_SUCCESS ou BTREE_ERROR_IO se a fila falhar, caso em que o lote
+ * deve ser repetido de forma síncrona
+ */
+static int storage_uring_batch(storage_t *st, const storage_io_t *ios,
+                               size_t n, bool write) {
+  size_t n_iov = 0;
+  for (size_t i = 0; i < n; i++)
+    n_iov += ios[i].n;
+
+  uring_op_t *ops = malloc(n * sizeof(uring_op_t));
+  struct iovec *iov = malloc(n_iov * sizeof(struct iovec));
+  if (!ops || !iov) {
+    free(ops);
+    free(iov);
+    return BTREE_ERROR_IO;
+  }
+
+  struct iovec *next = iov;
+
+  for (size_t i = 0; i < n; i++) {
+    ops[i] = (uring_op_t){write, ios[i].page * st->page_size, next,
+                          (int)ios[i].n};
+
+    for (size_t k = 0; k < ios[i].n; k++)
+      *next++ = (struct iovec){ios[i].bufs[k], st->page_size};
+  }
+
+  int result = uring_run(st->ring, st->fd, ops, n);
+
+  free(ops);
+  free(iov);
+
+  return result;
+}
+
+/**
+ * Verifica um lote e retorna o fim da última página transferida
+ *
+ * @return Tamanho que o arquivo passa a ter ou 0 se o lote for inválido
+ */
+static size_t storage_batch_end(const storage_t *st, const storage_io_t *ios,
+                                size_t n) {
+  size_t end = 0;
+
+  for (size_t i = 0; i < n; i++) {
+    if (!ios[i].bufs || ios[i].n == 0 || ios[i].n > STORAGE_MAX_RUN)
+      return 0;
+
+    size_t io_end = (ios[i].page + ios[i].n) * st->page_size;
+    if (io_end > end)
+      end = io_end;
+  }
+
+  return end;
+}
+
+int storage_read_batch(storage_t *st, const storage_io_t *ios, size_t n) {
+  if (!st || (n > 0 && !ios))
+    return BTREE_ERROR_INVALID_PARAM;
+
+  if (n == 0)
+    return BTREE_SUCCESS;
+
+  size_t end = storage_batch_end(st, ios, n);
+  if (end == 0 || end > storage_cur_size(st))
+    return BTREE_ERROR_IO;
+
+  size_t bytes = 0;
+  for (size_t i = 0; i < n; i++)
+    bytes += ios[i].n * st->page_size;
+
+  if (st->ring && storage_uring_batch(st, ios, n, false) == BTREE_SUCCESS) {
+    stats_add(st->counters, STATS_BYTES_READ, bytes);
+    return BTREE_SUCCESS;
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    size_t offset = ios[i].page * st->page_size;
+
+    if (st->backend == BTREE_BACKEND_MMAP) {
+      for (size_t k = 0; k < ios[i].n; k++)
+        memcpy(ios[i].bufs[k], st->base + offset + k * st->page_size,
+               st->page_size);
+    } else if (storage_prwv(st, offset, ios[i].bufs, ios[i].n, false) !=
+               BTREE_SUCCESS) {
+      return BTREE_ERROR_IO;
+    }
+  }
+
+  stats_add(st->counters, STATS_BYTES_READ, bytes);
+
+  return BTREE_SUCCESS;
+}
+
+int storage_write_batch(storage_t *st, const storage_io_t *ios, size_t n) {
+  if (!st || (n > 0 && !ios) || !st->writable)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  if (n == 0)
+    return BTREE_SUCCESS;
+
+  size_t end = storage_batch_end(st, ios, n);
+  if (end == 0)
+    return BTREE_ERROR_IO;
+
+  if (st->ring && storage_uring_batch(st, ios, n, true) == BTREE_SUCCESS) {
+    if (end > st->size)
+      __atomic_store_n(&st->size, end, __ATOMIC_RELEASE);
+
+    for (size_t i = 0; i < n; i++)
+      stats_add(st->counters, STATS_BYTES_WRITTEN, ios[i].n * st->page_size);
+
+    return BTREE_SUCCESS;
+  }
+
+  for (size_t i = 0; i < n; i++)
+    if (storage_write_pages(st, ios[i].page, (const void *const *)ios[i].bufs,
+                            ios[i].n) != BTREE_SUCCESS)
+      return BTREE_ERROR_IO;
+
+  return BTREE_SUCCESS;
+}
+
+btree_io_engine_t storage_io_engine(const storage_t *st) {
+  return st && uring_usable(st->ring) ? BTREE_IO_URING : BTREE_IO_SYNC;
+}
+
+void *storage_map_page(storage_t *st, size_t page) {
+  if (!st || st->backend != BTREE_BACKEND_MMAP || !st->zero_copy ||
+      (page + 1) * st->page_size > storage_cur_size(st))
+    return NULL;
+
+  return st->base + page * st->page_size;
+}
+
+void storage_prefetch(storage_t *st, size_t page) {
+  if (!st || (page + 1) * st->page_size > storage_cur_size(st))
+    return;
+
+  size_t offset = page * st->page_size;
+
+  if (st->backend == BTREE_BACKEND_MMAP) {
+    // madvise exige endereço alinhado à página do sistema operacional
+    size_t start = offset / st->os_page * st->os_page;
+    size_t mapped = __atomic_load_n(&st->mapped, __ATOMIC_ACQUIRE);
+    if (offset + st->page_size <= mapped)
+      madvise(st->base + start, offset + st->page_size - start,
+              MADV_WILLNEED);
+    return;
+  }
+
+  posix_fadvise(st->fd, offset, st->page_size, POSIX_FADV_WILLNEED);
+}
+
+int storage_flush(storage_t *st) {
+  if (!st)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  // As escritas posicionais e as do mapeamento já estão no page cache do
+  // sistema operacional
+  stats_add(st->counters, STATS_FLUSHES, 1);
+
+  return BTREE_SUCCESS;
+}
+
+int storage_sync(storage_t *st) {
+  if (!st)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  stats_add(st->counters, STATS_SYNCS, 1);
+
+  if (st->backend == BTREE_BACKEND_MMAP)
+    return st->mapped == 0 || msync(st->base, st->mapped, MS_SYNC) == 0
+               ? BTREE_SUCCESS
+               : BTREE_ERROR_IO;
+
+  return fdatasync(st->fd) == 0 ? BTREE_SUCCESS : BTREE_ERROR_IO;
+}
+
+size_t storage_size(const storage_t *st) { return st ? st->size : 0; }
+
+size_t storage_page_size(const storage_t *st) {
+  return st ? st->page_size : 0;
+}
@@ -0,0 +1,170 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "btree.h"
+#include "stats.h"
+
+typedef struct storage storage_t;
+
+// Páginas consecutivas transferidas por uma única chamada de sistema
+#define STORAGE_MAX_RUN 64
+
+/**
+ * Transferência de páginas consecutivas de um lote
+ */
+typedef struct storage_io {
+  size_t page; // Primeira página
+  size_t n;    // Quantidade de páginas (até STORAGE_MAX_RUN)
+  void **bufs; // Conteúdo de cada página
+} storage_io_t;
+
+/**
+ * Abre o arquivo binário com o backend escolhido nas opções
+ *
+ * @param filename Caminho do arquivo
+ * @param mode Modo de abertura, no formato de fopen()
+ * @param opts Opções da árvore
+ * @param counters Contadores da árvore, que recebem os bytes transferidos e
+ * as chamadas de storage_flush() e storage_sync() (pode ser NULL)
+ *
+ * @return Ponteiro para o armazenamento ou NULL em caso de erro
+ */
+storage_t *storage_open(const char *filename, const char *mode,
+                        const btree_options_t *opts, stats_t *counters);
+
+/**
+ * Descarrega as escritas pendentes e fecha o arquivo
+ *
+ * @param st Ponteiro para o armazenamento
+ */
+void storage_close(storage_t *st);
+
+/**
+ * Lê len bytes a partir do deslocamento offset
+ *
+ * A leitura é posicional (pread ou cópia do mapeamento) e não depende de uma
+ * posição compartilhada: pode ocorrer em paralelo com outras leituras e com
+ * uma escrita
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int storage_read(storage_t *st, size_t offset, void *buf, size_t len);
+
+/**
+ * Escreve len bytes a partir do deslocamento offset, aumentando o arquivo se
+ * necessário
+ *
+ * Escritas não podem ser concorrentes entre si; cabe ao chamador serializá-las
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int storage_write(storage_t *st, size_t offset, const void *buf, size_t len);
+
+/**
+ * Lê a página page inteira para buf, em uma única operação alinhada
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int storage_read_page(storage_t *st, size_t page, void *buf);
+
+/**
+ * Escreve buf na página page, em uma única operação alinhada
+ *
+ * No backend mmap, se buf já for a própria página mapeada a cópia é omitida
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int storage_write_page(storage_t *st, size_t page, const void *buf);
+
+/**
+ * Escreve n páginas consecutivas a partir de page, com uma chamada pwritev a
+ * cada STORAGE_MAX_RUN páginas
+ *
+ * @param st Ponteiro para o armazenamento
+ * @param page Primeira página
+ * @param bufs Conteúdo de cada página
+ * @param n Quantidade de páginas
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int storage_write_pages(storage_t *st, size_t page, const void *const *bufs,
+                        size_t n);
+
+/**
+ * Lê um lote de transferências, com várias em andamento ao mesmo tempo se a
+ * fila io_uring estiver disponível
+ *
+ * @param st Ponteiro para o armazenamento
+ * @param ios Transferências
+ * @param n Quantidade de transferências
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int storage_read_batch(storage_t *st, const storage_io_t *ios, size_t n);
+
+/**
+ * Escreve um lote de transferências, com várias em andamento ao mesmo tempo
+ * se a fila io_uring estiver disponível
+ *
+ * Escritas não podem ser concorrentes entre si; cabe ao chamador serializá-las
+ *
+ * @param st Ponteiro para o armazenamento
+ * @param ios Transferências
+ * @param n Quantidade de transferências
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int storage_write_batch(storage_t *st, const storage_io_t *ios, size_t n);
+
+/**
+ * Retorna o mecanismo de E/S em uso: BTREE_IO_URING só se a fila foi criada
+ */
+btree_io_engine_t storage_io_engine(const storage_t *st);
+
+/**
+ * Obtém o endereço da página page dentro do mapeamento
+ *
+ * @return Ponteiro para a página ou NULL se o backend não for mmap, o log de
+ * redo estiver habilitado ou a página ainda não existir no arquivo
+ */
+void *storage_map_page(storage_t *st, size_t page);
+
+/**
+ * Avisa o sistema operacional de que a página page será lida em breve
+ *
+ * A leitura antecipada acontece em segundo plano (posix_fadvise no backend
+ * de descritor, madvise no mmap); falhas são ignoradas
+ */
+void storage_prefetch(storage_t *st, size_t page);
+
+/**
+ * Entrega ao sistema operacional as escritas mantidas em buffer
+ *
+ * As escritas já são feitas diretamente no descritor ou no mapeamento, então
+ * não há nada a entregar; a chamada marca os pontos em que isso é exigido
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int storage_flush(storage_t *st);
+
+/**
+ * Grava no disco as escritas feitas até aqui (fdatasync ou msync)
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int storage_sync(storage_t *st);
+
+/**
+ * Retorna o tamanho lógico do arquivo, em bytes
+ */
+size_t storage_size(const storage_t *st);
+
+/**
+ * Retorna o tamanho das páginas do arquivo, em bytes
+ */
+size_t storage_page_size(const storage_t *st);
+
+#endif // !STORAGE_H
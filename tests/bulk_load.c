@@ -0,0 +1,112 @@
+/**
+ * Carga em lote em uma árvore esvaziada por remoções
+ *
+ * Em ordem 3 o mínimo de chaves por nó é zero: remover todas as chaves deixa
+ * folhas vazias, separadores da árvore B+ e, na árvore B, raízes internas sem
+ * chaves. A carga precisa aceitar essa árvore, e o resultado precisa
+ * sobreviver à reabertura do arquivo, com e sem o log de redo
+ *
+ * Uso: bulk_load (termina com 0 se todos os casos passarem)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "btree.h"
+
+#define TEST_FILE "bulk_load.db"
+#define TEST_WAL TEST_FILE "-wal"
+#define TEST_KEYS 2000
+
+static int check(btree_t *tree, const char *when, int layout, size_t order,
+                 bool wal) {
+  int missing = 0;
+
+  for (int i = 0; i < TEST_KEYS; i++) {
+    int value;
+    if (btree_get(tree, i, &value) != BTREE_SUCCESS || value != -i)
+      missing++;
+  }
+
+  if (missing == 0 && btree_count(tree) == TEST_KEYS)
+    return 0;
+
+  fprintf(stderr, "layout %d ordem %zu wal %d, %s: %d chaves ausentes, %zu "
+                  "contadas\n",
+          layout, order, wal, when, missing, btree_count(tree));
+
+  return 1;
+}
+
+static int run(int layout, size_t order, bool wal) {
+  static int keys[TEST_KEYS], values[TEST_KEYS];
+  btree_options_t opts;
+
+  btree_options_init(&opts);
+  opts.layout = layout;
+  opts.wal = wal;
+  opts.pool_pages = 64;
+
+  unlink(TEST_FILE);
+  unlink(TEST_WAL);
+
+  btree_t *tree = btree_create_ex(order, TEST_FILE, "w+b", &opts);
+  if (!tree) {
+    fprintf(stderr, "btree_create_ex falhou\n");
+    return 1;
+  }
+
+  for (int i = 0; i < TEST_KEYS; i++)
+    btree_insert(tree, (i * 7919) % TEST_KEYS, i);
+
+  for (int i = 0; i < TEST_KEYS; i++)
+    btree_remove(tree, (i * 104729) % TEST_KEYS);
+
+  for (int i = 0; i < TEST_KEYS; i++) {
+    keys[i] = i;
+    values[i] = -i;
+  }
+
+  int failed = 0;
+  int result = btree_bulk_load(tree, keys, values, TEST_KEYS, 1.0);
+
+  if (result == BTREE_SUCCESS) {
+    failed |= check(tree, "após a carga", layout, order, wal);
+  } else {
+    fprintf(stderr, "layout %d ordem %zu wal %d: carga devolveu %d\n", layout,
+            order, wal, result);
+    failed = 1;
+  }
+
+  btree_destroy(tree);
+
+  tree = btree_open(TEST_FILE, &opts);
+  if (!tree) {
+    fprintf(stderr, "layout %d ordem %zu wal %d: btree_open falhou\n", layout,
+            order, wal);
+    failed = 1;
+  } else {
+    if (result == BTREE_SUCCESS)
+      failed |= check(tree, "após reabrir", layout, order, wal);
+
+    btree_destroy(tree);
+  }
+
+  unlink(TEST_FILE);
+  unlink(TEST_WAL);
+
+  return failed;
+}
+
+int main(void) {
+  int failed = 0;
+
+  for (int layout = BTREE_LAYOUT_BTREE; layout <= BTREE_LAYOUT_BPLUS; layout++)
+    for (size_t order = 3; order <= 5; order++)
+      for (int wal = 0; wal <= 1; wal++)
+        failed |= run(layout, order, wal);
+
+  puts(failed ? "bulk_load: FALHOU" : "bulk_load: ok");
+
+  return failed;
+}
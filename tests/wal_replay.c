@@ -0,0 +1,143 @@
+/**
+ * Recuperação do log de redo com um LSN corrompido
+ *
+ * Grava alguns registros de uma página, altera um bit do LSN de um deles e
+ * confere que a recuperação para no registro corrompido: os anteriores são
+ * aplicados, em ordem, e nenhum a partir dele
+ *
+ * Uso: wal_replay (termina com 0 se todos os casos passarem)
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "btree.h"
+#include "wal.h"
+
+#define TEST_FILE "wal_replay.db"
+#define TEST_WAL TEST_FILE "-wal"
+#define TEST_RECORDS 5
+
+// Posição do LSN no cabeçalho de um registro: depois de magic e n_pages
+#define TEST_LSN_OFFSET 8
+
+typedef struct replay {
+  int applied; // Registros aplicados
+  bool order;  // Flag indicando que os registros chegaram na ordem gravada
+} replay_t;
+
+static int count_record(void *ctx, const disk_superblock_t *sb,
+                        size_t n_pages, const int32_t *pages,
+                        const char *images) {
+  replay_t *replay = ctx;
+
+  // Cada registro leva o próprio índice na página e no superbloco
+  if (n_pages != 1 || pages[0] != replay->applied ||
+      sb->n_keys != (uint64_t)replay->applied || images[0] != replay->applied)
+    replay->order = false;
+
+  replay->applied++;
+
+  return BTREE_SUCCESS;
+}
+
+static wal_t *open_log(bool truncate) {
+  btree_options_t opts;
+
+  btree_options_init(&opts);
+  opts.durability = BTREE_DURABILITY_FLUSH;
+  opts.wal_group_ops = 1;
+
+  return wal_open(TEST_FILE, truncate, &opts, BTREE_PAGE_4K, NULL);
+}
+
+static int write_log(void) {
+  static char image[BTREE_PAGE_4K];
+  disk_superblock_t sb;
+
+  wal_t *wal = open_log(true);
+  if (!wal)
+    return BTREE_ERROR_IO;
+
+  memset(&sb, 0, sizeof(sb));
+
+  for (int i = 0; i < TEST_RECORDS; i++) {
+    sb.n_keys = i;
+    image[0] = i;
+
+    if (wal_begin(wal, &sb, 1) != BTREE_SUCCESS ||
+        wal_add_page(wal, i, image) != BTREE_SUCCESS || wal_end(wal) < 0) {
+      wal_close(wal);
+      return BTREE_ERROR_IO;
+    }
+  }
+
+  wal_close(wal);
+
+  return BTREE_SUCCESS;
+}
+
+/**
+ * Inverte um bit do LSN do registro corrupted, que ainda parece um LSN válido
+ */
+static int corrupt_lsn(int corrupted) {
+  int fd = open(TEST_WAL, O_RDWR);
+  if (fd < 0)
+    return BTREE_ERROR_IO;
+
+  // Todos os registros têm uma página e, portanto, o mesmo tamanho
+  off_t record = lseek(fd, 0, SEEK_END) / TEST_RECORDS;
+  off_t offset = record * corrupted + TEST_LSN_OFFSET;
+  int64_t lsn;
+
+  int result = BTREE_ERROR_IO;
+  if (pread(fd, &lsn, sizeof(lsn), offset) == sizeof(lsn)) {
+    lsn ^= 1 << 4;
+    if (pwrite(fd, &lsn, sizeof(lsn), offset) == sizeof(lsn))
+      result = BTREE_SUCCESS;
+  }
+
+  close(fd);
+
+  return result;
+}
+
+static int run(int corrupted) {
+  if (write_log() != BTREE_SUCCESS || corrupt_lsn(corrupted) != BTREE_SUCCESS) {
+    fprintf(stderr, "registro %d: falha ao preparar o log\n", corrupted);
+    return 1;
+  }
+
+  wal_t *wal = open_log(false);
+  if (!wal) {
+    fprintf(stderr, "registro %d: falha ao abrir o log\n", corrupted);
+    return 1;
+  }
+
+  replay_t replay = {0, true};
+  int applied = wal_replay(wal, count_record, &replay);
+  wal_close(wal);
+
+  if (applied == corrupted && replay.applied == corrupted && replay.order)
+    return 0;
+
+  fprintf(stderr, "registro %d corrompido: %d registros aplicados\n",
+          corrupted, applied);
+
+  return 1;
+}
+
+int main(void) {
+  int failed = 0;
+
+  for (int corrupted = 0; corrupted < TEST_RECORDS; corrupted++)
+    failed |= run(corrupted);
+
+  unlink(TEST_FILE);
+  unlink(TEST_WAL);
+
+  puts(failed ? "wal_replay: FALHOU" : "wal_replay: ok");
+
+  return failed;
+}
@@ -0,0 +1,324 @@
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "btree.h"
+#include "uring.h"
+
+struct uring {
+  int fd;           // Descritor da fila
+  unsigned entries; // Quantidade de entradas da fila de submissão
+
+  // Fila de submissão, compartilhada com o kernel
+  char *sq_ring;
+  size_t sq_len;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  struct io_uring_sqe *sqes;
+  size_t sqes_len;
+
+  // Fila de conclusão; com IORING_FEAT_SINGLE_MMAP, no mesmo mapeamento
+  char *cq_ring;
+  size_t cq_len;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+
+  pthread_mutex_t lock; // Uma execução de uring_run() por vez
+
+  // Flag indicando que io_uring_enter() falhou sem poder esperar as
+  // operações em andamento; a fila não é mais usada
+  bool broken;
+};
+
+// Intervalo entre verificações da fila de conclusão enquanto ela é drenada
+#define URING_DRAIN_NS 50000
+
+static int uring_setup(unsigned entries, struct io_uring_params *params) {
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+                      IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+uring_t *uring_create(unsigned depth) {
+  if (depth == 0)
+    return NULL;
+
+  uring_t *ring = calloc(1, sizeof(uring_t));
+  if (!ring)
+    return NULL;
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  // Sem suporte no kernel (ENOSYS) ou bloqueado por seccomp (EPERM)
+  ring->fd = uring_setup(depth, &params);
+  if (ring->fd < 0) {
+    free(ring);
+    return NULL;
+  }
+
+  ring->entries = params.sq_entries;
+  ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cq_len =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single && ring->cq_len > ring->sq_len)
+    ring->sq_len = ring->cq_len;
+
+  ring->sq_ring = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_ring == MAP_FAILED) {
+    ring->sq_ring = NULL;
+    uring_destroy(ring);
+    return NULL;
+  }
+
+  if (single) {
+    ring->cq_ring = ring->sq_ring;
+  } else {
+    ring->cq_ring =
+        mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+    if (ring->cq_ring == MAP_FAILED) {
+      ring->cq_ring = NULL;
+      uring_destroy(ring);
+      return NULL;
+    }
+  }
+
+  ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    ring->sqes = NULL;
+    uring_destroy(ring);
+    return NULL;
+  }
+
+  ring->sq_head = (unsigned *)(ring->sq_ring + params.sq_off.head);
+  ring->sq_tail = (unsigned *)(ring->sq_ring + params.sq_off.tail);
+  ring->sq_mask = (unsigned *)(ring->sq_ring + params.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(ring->sq_ring + params.sq_off.array);
+
+  ring->cq_head = (unsigned *)(ring->cq_ring + params.cq_off.head);
+  ring->cq_tail = (unsigned *)(ring->cq_ring + params.cq_off.tail);
+  ring->cq_mask = (unsigned *)(ring->cq_ring + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(ring->cq_ring + params.cq_off.cqes);
+
+  pthread_mutex_init(&ring->lock, NULL);
+
+  return ring;
+}
+
+void uring_destroy(uring_t *ring) {
+  if (!ring)
+    return;
+
+  if (ring->sqes)
+    munmap(ring->sqes, ring->sqes_len);
+
+  if (ring->cq_ring && ring->cq_ring != ring->sq_ring)
+    munmap(ring->cq_ring, ring->cq_len);
+
+  if (ring->sq_ring) {
+    munmap(ring->sq_ring, ring->sq_len);
+    pthread_mutex_destroy(&ring->lock);
+  }
+
+  close(ring->fd);
+  free(ring);
+}
+
+/**
+ * Completa de forma síncrona uma operação da qual done bytes já foram
+ * transferidos
+ */
+static int uring_finish(int fd, uring_op_t *op, size_t done) {
+  struct iovec *iov = op->iov;
+  int n_iov = op->n_iov;
+  size_t offset = op->offset + done;
+
+  for (;;) {
+    // Descarta os buffers já transferidos e ajusta o primeiro incompleto
+    while (n_iov > 0 && done >= iov->iov_len) {
+      done -= iov->iov_len;
+      iov++;
+      n_iov--;
+    }
+
+    if (n_iov == 0)
+      return BTREE_SUCCESS;
+
+    iov->iov_base = (char *)iov->iov_base + done;
+    iov->iov_len -= done;
+
+    ssize_t n = op->write ? pwritev(fd, iov, n_iov, offset)
+                          : preadv(fd, iov, n_iov, offset);
+    if (n < 0 && errno == EINTR)
+      n = 0;
+    else if (n <= 0)
+      return BTREE_ERROR_IO;
+
+    done = n;
+    offset += n;
+  }
+}
+
+/**
+ * Preenche a próxima entrada da fila de submissão com a operação i
+ */
+static void uring_prepare(uring_t *ring, int fd, const uring_op_t *op,
+                          size_t i) {
+  unsigned tail = *ring->sq_tail;
+  unsigned idx = tail & *ring->sq_mask;
+
+  struct io_uring_sqe *sqe = &ring->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = op->write ? IORING_OP_WRITEV : IORING_OP_READV;
+  sqe->fd = fd;
+  sqe->off = op->offset;
+  sqe->addr = (uintptr_t)op->iov;
+  sqe->len = op->n_iov;
+  sqe->user_data = i;
+
+  ring->sq_array[idx] = idx;
+
+  // A entrada fica visível ao kernel antes da nova cauda
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Consome as conclusões disponíveis, completando de forma síncrona as
+ * operações parciais
+ *
+ * @return Quantidade de conclusões consumidas
+ */
+static unsigned uring_reap(uring_t *ring, int fd, uring_op_t *ops,
+                           bool *failed) {
+  unsigned head = *ring->cq_head;
+  unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  unsigned reaped = 0;
+
+  for (; head != tail; head++, reaped++) {
+    const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+    uring_op_t *op = &ops[cqe->user_data];
+
+    size_t len = 0;
+    for (int k = 0; k < op->n_iov; k++)
+      len += op->iov[k].iov_len;
+
+    if (cqe->res < 0 ||
+        ((size_t)cqe->res < len &&
+         uring_finish(fd, op, cqe->res) != BTREE_SUCCESS))
+      *failed = true;
+  }
+
+  __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+  return reaped;
+}
+
+/**
+ * Espera as operações em andamento sem io_uring_enter(), verificando a fila
+ * de conclusão a intervalos
+ *
+ * As conclusões continuam sendo publicadas pelo kernel; as que dependem do
+ * próprio thread são processadas no retorno de cada nanosleep()
+ */
+static void uring_drain(uring_t *ring, int fd, uring_op_t *ops,
+                        unsigned in_flight, bool *failed) {
+  const struct timespec pause = {0, URING_DRAIN_NS};
+
+  while (in_flight > 0) {
+    unsigned reaped = uring_reap(ring, fd, ops, failed);
+
+    if (reaped == 0)
+      nanosleep(&pause, NULL);
+
+    in_flight -= reaped;
+  }
+}
+
+int uring_run(uring_t *ring, int fd, uring_op_t *ops, size_t n) {
+  if (!ring || (n > 0 && !ops))
+    return BTREE_ERROR_INVALID_PARAM;
+
+  pthread_mutex_lock(&ring->lock);
+
+  if (ring->broken) {
+    pthread_mutex_unlock(&ring->lock);
+    return BTREE_ERROR_IO;
+  }
+
+  size_t prepared = 0;
+  unsigned in_flight = 0, unsubmitted = 0;
+  bool failed = false;
+
+  while (in_flight > 0 || (!failed && prepared < n)) {
+    while (!failed && prepared < n && in_flight < ring->entries) {
+      uring_prepare(ring, fd, &ops[prepared], prepared);
+      prepared++;
+      in_flight++;
+      unsubmitted++;
+    }
+
+    int ret = uring_enter(ring->fd, unsubmitted, 1);
+    if (ret < 0) {
+      // Falta temporária de recursos no kernel: tenta de novo
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        uring_reap(ring, fd, ops, &failed);
+        continue;
+      }
+
+      // As entradas que o kernel não consumiu saem da fila, e nenhuma outra
+      // é preparada
+      __atomic_store_n(ring->sq_tail, *ring->sq_tail - unsubmitted,
+                       __ATOMIC_RELEASE);
+      in_flight -= unsubmitted;
+      unsubmitted = 0;
+      failed = true;
+
+      // Sem como esperar pelo kernel, as operações em andamento ainda usam os
+      // buffers do chamador: elas são drenadas antes do retorno, e a fila
+      // deixa de ser usada
+      ring->broken = true;
+      uring_drain(ring, fd, ops, in_flight, &failed);
+      break;
+    }
+
+    unsubmitted -= (unsigned)ret;
+    in_flight -= uring_reap(ring, fd, ops, &failed);
+  }
+
+  int result = failed ? BTREE_ERROR_IO : BTREE_SUCCESS;
+
+  pthread_mutex_unlock(&ring->lock);
+
+  return result;
+}
+
+bool uring_usable(uring_t *ring) {
+  if (!ring)
+    return false;
+
+  pthread_mutex_lock(&ring->lock);
+  bool usable = !ring->broken;
+  pthread_mutex_unlock(&ring->lock);
+
+  return usable;
+}
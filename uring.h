@@ -0,0 +1,75 @@
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+/**
+ * Fila de E/S assíncrona sobre io_uring, usada diretamente pelas chamadas de
+ * sistema, sem liburing
+ *
+ * Uma fila pode ser usada por vários threads: cada uring_run() a usa com
+ * exclusividade até que todas as suas operações terminem
+ */
+typedef struct uring uring_t;
+
+/**
+ * Leitura ou escrita vetorizada em um deslocamento do arquivo
+ */
+typedef struct uring_op {
+  bool write;        // Flag indicando escrita
+  size_t offset;     // Deslocamento no arquivo
+  struct iovec *iov; // Buffers, alterados se a operação terminar parcialmente
+  int n_iov;         // Quantidade de buffers
+} uring_op_t;
+
+/**
+ * Cria uma fila com até depth operações em andamento
+ *
+ * @param depth Profundidade da fila
+ *
+ * @return Ponteiro para a fila ou NULL se o kernel não oferecer io_uring (ou
+ * o bloquear) ou em caso de erro
+ */
+uring_t *uring_create(unsigned depth);
+
+/**
+ * Destrói a fila
+ *
+ * @param ring Ponteiro para a fila ou NULL
+ */
+void uring_destroy(uring_t *ring);
+
+/**
+ * Executa as operações sobre o descritor fd, mantendo até a profundidade da
+ * fila em andamento, e espera todas terminarem
+ *
+ * Uma operação que termina parcialmente é completada de forma síncrona. A
+ * função só retorna depois que o kernel terminou todas as operações
+ * submetidas, mesmo em caso de erro. Se io_uring_enter() falhar de forma
+ * permanente, as operações em andamento são drenadas e a fila passa a
+ * recusar novas execuções
+ *
+ * @param ring Ponteiro para a fila
+ * @param fd Descritor do arquivo
+ * @param ops Operações
+ * @param n Quantidade de operações
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou BTREE_ERROR_IO se alguma
+ * operação falhar ou se a fila não puder mais ser usada; nesse caso, as
+ * operações devem ser repetidas de forma síncrona
+ */
+int uring_run(uring_t *ring, int fd, uring_op_t *ops, size_t n);
+
+/**
+ * Indica se a fila ainda aceita execuções
+ *
+ * @param ring Ponteiro para a fila ou NULL
+ *
+ * @return false se a fila for NULL ou tiver sido desativada por uma falha de
+ * io_uring_enter()
+ */
+bool uring_usable(uring_t *ring);
+
+#endif // !URING_H
@@ -0,0 +1,403 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "wal.h"
+
+// Identificação de um registro do log ("WALR")
+#define WAL_MAGIC 0x57414c52u
+
+// Bytes em buffer a partir dos quais o log é entregue ao sistema operacional,
+// mesmo que o grupo ainda não tenha sido efetivado
+#define WAL_BUFFER_BYTES ((size_t)1 << 20)
+
+// Limite de páginas de um registro, usado para rejeitar cabeçalhos corrompidos
+#define WAL_MAX_RECORD_PAGES 4096
+
+/**
+ * Cabeçalho de um registro do log
+ *
+ * Logo após o cabeçalho vêm int32_t pages[n_pages] e as imagens das páginas,
+ * na mesma ordem. O checksum cobre os campos do cabeçalho que o antecedem
+ * (magic, n_pages e lsn), o superbloco, os números e as imagens
+ */
+typedef struct wal_record_header {
+  uint32_t magic;    // WAL_MAGIC
+  uint32_t n_pages;  // Quantidade de páginas do registro
+  int64_t lsn;       // Número de sequência do registro
+  uint32_t checksum; // FNV-1a do registro, exceto checksum e reserved
+  uint32_t reserved;
+  disk_superblock_t sb; // Superbloco após a operação
+} wal_record_header_t;
+
+struct wal {
+  int fd;                        // Descritor do arquivo de log
+  btree_durability_t durability; // Nível de durabilidade dos commits
+  size_t group_ops;              // Operações por commit em grupo
+  size_t page_size;              // Tamanho das páginas, em bytes
+
+  char *buf;  // Registros ainda não entregues ao sistema operacional
+  size_t len; // Bytes usados em buf
+  size_t cap; // Capacidade de buf
+
+  size_t rec_start; // Início do registro aberto em buf
+  size_t rec_pages; // Páginas declaradas em wal_begin()
+  size_t rec_added; // Páginas já adicionadas ao registro aberto
+
+  size_t file_size;    // Bytes já escritos no arquivo de log
+  size_t group_count;  // Registros no grupo atual
+  int64_t lsn;         // LSN do último registro fechado
+  int64_t written_lsn; // Último LSN entregue ao sistema operacional
+  int64_t synced_lsn;  // Último LSN gravado com fdatasync
+
+  stats_t *counters; // Contadores da árvore ou NULL
+};
+
+static uint32_t wal_checksum(uint32_t hash, const void *data, size_t len) {
+  const unsigned char *p = data;
+
+  for (size_t i = 0; i < len; i++) {
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+/**
+ * Calcula o checksum de um registro completo
+ *
+ * O LSN entra no checksum: um LSN corrompido que ainda parecesse a sequência
+ * faria a recuperação pular ou reordenar registros
+ *
+ * @param rec Início do registro
+ * @param size Tamanho do registro, em bytes
+ */
+static uint32_t wal_record_checksum(const char *rec, size_t size) {
+  const wal_record_header_t *h = (const wal_record_header_t *)rec;
+  const char *body = (const char *)&h->sb;
+
+  uint32_t hash =
+      wal_checksum(2166136261u, rec, offsetof(wal_record_header_t, checksum));
+
+  return wal_checksum(hash, body, rec + size - body);
+}
+
+static size_t wal_record_size(const wal_t *wal, size_t n_pages) {
+  size_t size = sizeof(wal_record_header_t) +
+                n_pages * (sizeof(int32_t) + wal->page_size);
+
+  // Mantém o próximo cabeçalho alinhado dentro do buffer
+  return (size + 7) & ~(size_t)7;
+}
+
+static int wal_reserve(wal_t *wal, size_t len) {
+  if (wal->len + len <= wal->cap)
+    return BTREE_SUCCESS;
+
+  size_t cap = wal->cap ? wal->cap : WAL_BUFFER_BYTES;
+  while (cap < wal->len + len)
+    cap *= 2;
+
+  char *buf = realloc(wal->buf, cap);
+  if (!buf)
+    return BTREE_ERROR_ALLOC;
+
+  wal->buf = buf;
+  wal->cap = cap;
+
+  return BTREE_SUCCESS;
+}
+
+/**
+ * Entrega ao sistema operacional, em uma única escrita sequencial, todos os
+ * registros fechados mantidos em buffer
+ */
+static int wal_write(wal_t *wal) {
+  size_t done = 0;
+
+  while (done < wal->len) {
+    ssize_t n = pwrite(wal->fd, wal->buf + done, wal->len - done,
+                       wal->file_size + done);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return BTREE_ERROR_IO;
+    }
+
+    done += n;
+  }
+
+  stats_add(wal->counters, STATS_WAL_BYTES, wal->len);
+  stats_add(wal->counters, STATS_FLUSHES, 1);
+
+  wal->file_size += wal->len;
+  wal->len = 0;
+  wal->written_lsn = wal->lsn;
+
+  return BTREE_SUCCESS;
+}
+
+wal_t *wal_open(const char *filename, bool truncate,
+                const btree_options_t *opts, size_t page_size,
+                stats_t *counters) {
+  if (!filename || !opts)
+    return NULL;
+
+  size_t name_len = strlen(filename);
+  char *path = malloc(name_len + sizeof("-wal"));
+  if (!path)
+    return NULL;
+
+  memcpy(path, filename, name_len);
+  memcpy(path + name_len, "-wal", sizeof("-wal"));
+
+  wal_t *wal = calloc(1, sizeof(wal_t));
+  if (!wal) {
+    free(path);
+    return NULL;
+  }
+
+  wal->fd = open(path, O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+  free(path);
+  if (wal->fd < 0) {
+    free(wal);
+    return NULL;
+  }
+
+  off_t size = lseek(wal->fd, 0, SEEK_END);
+  if (size < 0) {
+    wal_close(wal);
+    return NULL;
+  }
+
+  wal->file_size = size;
+  wal->durability = opts->durability;
+  wal->group_ops = opts->wal_group_ops ? opts->wal_group_ops : 1;
+  wal->page_size = page_size;
+  wal->counters = counters;
+
+  return wal;
+}
+
+void wal_close(wal_t *wal) {
+  if (!wal)
+    return;
+
+  if (wal->fd >= 0) {
+    wal_commit(wal);
+    close(wal->fd);
+  }
+
+  free(wal->buf);
+  free(wal);
+}
+
+int wal_begin(wal_t *wal, const disk_superblock_t *sb, size_t n_pages) {
+  if (!wal || !sb || n_pages > WAL_MAX_RECORD_PAGES)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  if (wal_reserve(wal, wal_record_size(wal, n_pages)) != BTREE_SUCCESS)
+    return BTREE_ERROR_ALLOC;
+
+  wal_record_header_t *header = (wal_record_header_t *)(wal->buf + wal->len);
+  memset(header, 0, sizeof(*header));
+  header->magic = WAL_MAGIC;
+  header->n_pages = n_pages;
+  header->sb = *sb;
+
+  wal->rec_start = wal->len;
+  wal->rec_pages = n_pages;
+  wal->rec_added = 0;
+  wal->len += wal_record_size(wal, n_pages);
+
+  return BTREE_SUCCESS;
+}
+
+int wal_add_page(wal_t *wal, int page, const void *image) {
+  if (!wal || !image || wal->rec_added >= wal->rec_pages)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  char *rec = wal->buf + wal->rec_start;
+  int32_t *pages = (int32_t *)(rec + sizeof(wal_record_header_t));
+  char *images = (char *)(pages + wal->rec_pages);
+
+  pages[wal->rec_added] = page;
+  memcpy(images + wal->rec_added * wal->page_size, image, wal->page_size);
+  wal->rec_added++;
+
+  return BTREE_SUCCESS;
+}
+
+int64_t wal_end(wal_t *wal) {
+  if (!wal || wal->rec_added != wal->rec_pages)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  wal_record_header_t *header =
+      (wal_record_header_t *)(wal->buf + wal->rec_start);
+
+  header->lsn = ++wal->lsn;
+  header->checksum = wal_record_checksum(wal->buf + wal->rec_start,
+                                         wal->len - wal->rec_start);
+
+  int64_t lsn = wal->lsn;
+  int result = BTREE_SUCCESS;
+
+  // Sem durabilidade, o log só é escrito quando o buffer enche
+  if (wal->durability != BTREE_DURABILITY_NONE &&
+      ++wal->group_count >= wal->group_ops)
+    result = wal_commit(wal);
+  else if (wal->len >= WAL_BUFFER_BYTES)
+    result = wal_write(wal);
+
+  return result == BTREE_SUCCESS ? lsn : result;
+}
+
+int wal_commit(wal_t *wal) {
+  if (!wal)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  wal->group_count = 0;
+
+  if (wal->len > 0 && wal_write(wal) != BTREE_SUCCESS)
+    return BTREE_ERROR_IO;
+
+  if (wal->durability == BTREE_DURABILITY_FDATASYNC &&
+      wal->synced_lsn < wal->written_lsn) {
+    if (fdatasync(wal->fd) != 0)
+      return BTREE_ERROR_IO;
+
+    stats_add(wal->counters, STATS_SYNCS, 1);
+    wal->synced_lsn = wal->written_lsn;
+  }
+
+  return BTREE_SUCCESS;
+}
+
+int wal_sync(wal_t *wal, int64_t lsn) {
+  if (!wal)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  int64_t durable = wal->durability == BTREE_DURABILITY_FDATASYNC
+                        ? wal->synced_lsn
+                        : wal->written_lsn;
+
+  return lsn > durable ? wal_commit(wal) : BTREE_SUCCESS;
+}
+
+int wal_truncate(wal_t *wal) {
+  if (!wal)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  wal->len = 0;
+  wal->group_count = 0;
+  wal->written_lsn = wal->synced_lsn = wal->lsn;
+
+  if (wal->file_size == 0)
+    return BTREE_SUCCESS;
+
+  if (ftruncate(wal->fd, 0) != 0)
+    return BTREE_ERROR_IO;
+
+  wal->file_size = 0;
+
+  // Registros antigos não podem reaparecer atrás dos novos após uma queda
+  if (wal->durability == BTREE_DURABILITY_FDATASYNC) {
+    if (fdatasync(wal->fd) != 0)
+      return BTREE_ERROR_IO;
+
+    stats_add(wal->counters, STATS_SYNCS, 1);
+  }
+
+  return BTREE_SUCCESS;
+}
+
+size_t wal_size(const wal_t *wal) {
+  return wal ? wal->file_size + wal->len : 0;
+}
+
+btree_durability_t wal_durability(const wal_t *wal) {
+  return wal ? wal->durability : BTREE_DURABILITY_NONE;
+}
+
+static int wal_read(int fd, size_t offset, void *buf, size_t len) {
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t n = pread(fd, (char *)buf + done, len - done, offset + done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return BTREE_ERROR_IO;
+
+    done += n;
+  }
+
+  return BTREE_SUCCESS;
+}
+
+int wal_replay(wal_t *wal, wal_apply_fn apply, void *ctx) {
+  if (!wal || !apply)
+    return BTREE_ERROR_INVALID_PARAM;
+
+  char *rec = NULL;
+  size_t cap = 0;
+  size_t offset = 0;
+  int64_t prev_lsn = 0;
+  int applied = 0;
+
+  while (offset + sizeof(wal_record_header_t) <= wal->file_size) {
+    wal_record_header_t header;
+    if (wal_read(wal->fd, offset, &header, sizeof(header)) != BTREE_SUCCESS ||
+        header.magic != WAL_MAGIC || header.n_pages > WAL_MAX_RECORD_PAGES ||
+        (applied > 0 && header.lsn != prev_lsn + 1))
+      break;
+
+    size_t size = wal_record_size(wal, header.n_pages);
+    if (offset + size > wal->file_size)
+      break;
+
+    if (size > cap) {
+      char *grown = realloc(rec, size);
+      if (!grown) {
+        free(rec);
+        return BTREE_ERROR_ALLOC;
+      }
+
+      rec = grown;
+      cap = size;
+    }
+
+    if (wal_read(wal->fd, offset, rec, size) != BTREE_SUCCESS)
+      break;
+
+    const wal_record_header_t *h = (const wal_record_header_t *)rec;
+    if (wal_record_checksum(rec, size) != h->checksum)
+      break;
+
+    const int32_t *pages = (const int32_t *)(rec + sizeof(*h));
+    const char *images = (const char *)(pages + h->n_pages);
+
+    int result = apply(ctx, &h->sb, h->n_pages, pages, images);
+    if (result != BTREE_SUCCESS) {
+      free(rec);
+      return result;
+    }
+
+    prev_lsn = h->lsn;
+    offset += size;
+    applied++;
+  }
+
+  free(rec);
+
+  // Continua a numeração a partir do último registro aplicado
+  wal->lsn = wal->written_lsn = wal->synced_lsn = prev_lsn;
+
+  return applied;
+}
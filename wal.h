@@ -0,0 +1,134 @@
+#ifndef WAL_H
+#define WAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "btree.h"
+#include "node.h"
+#include "stats.h"
+
+typedef struct wal wal_t;
+
+/**
+ * Função aplicada a cada registro válido durante a recuperação
+ *
+ * @param ctx Contexto repassado por wal_replay()
+ * @param sb Superbloco gravado no registro
+ * @param n_pages Quantidade de páginas do registro
+ * @param pages Números das páginas
+ * @param images Imagens das páginas, uma após a outra
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+typedef int (*wal_apply_fn)(void *ctx, const disk_superblock_t *sb,
+                            size_t n_pages, const int32_t *pages,
+                            const char *images);
+
+/**
+ * Abre o log de redo associado a um arquivo binário ("<filename>-wal")
+ *
+ * @param filename Caminho do arquivo binário
+ * @param truncate Flag indicando se o conteúdo anterior do log é descartado
+ * @param opts Opções da árvore (durabilidade e tamanho dos grupos)
+ * @param page_size Tamanho das páginas, em bytes
+ * @param counters Contadores da árvore, que recebem os bytes escritos no log
+ * e as chamadas de fdatasync (pode ser NULL)
+ *
+ * @return Ponteiro para o log ou NULL em caso de erro
+ */
+wal_t *wal_open(const char *filename, bool truncate,
+                const btree_options_t *opts, size_t page_size,
+                stats_t *counters);
+
+/**
+ * Grava os registros pendentes e fecha o log
+ *
+ * @param wal Ponteiro para o log
+ */
+void wal_close(wal_t *wal);
+
+/**
+ * Inicia um registro no buffer do log
+ *
+ * Um registro corresponde a uma operação da árvore: o superbloco e a imagem
+ * de cada página alterada pela operação
+ *
+ * @param wal Ponteiro para o log
+ * @param sb Superbloco após a operação
+ * @param n_pages Quantidade de páginas que serão adicionadas
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int wal_begin(wal_t *wal, const disk_superblock_t *sb, size_t n_pages);
+
+/**
+ * Adiciona a imagem de uma página ao registro aberto por wal_begin()
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int wal_add_page(wal_t *wal, int page, const void *image);
+
+/**
+ * Fecha o registro aberto e o inclui no grupo atual
+ *
+ * Quando o grupo atinge o tamanho configurado, ele é efetivado de uma vez
+ * segundo o nível de durabilidade
+ *
+ * @param wal Ponteiro para o log
+ *
+ * @return LSN do registro (maior que zero) ou código de erro
+ */
+int64_t wal_end(wal_t *wal);
+
+/**
+ * Garante que os registros até lsn foram efetivados no nível de durabilidade
+ * configurado
+ *
+ * Deve ser chamada antes que uma página alterada por esses registros seja
+ * escrita no arquivo binário
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int wal_sync(wal_t *wal, int64_t lsn);
+
+/**
+ * Efetiva todos os registros pendentes, independentemente do tamanho do grupo
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int wal_commit(wal_t *wal);
+
+/**
+ * Descarta o conteúdo do log após um checkpoint
+ *
+ * @return BTREE_SUCCESS em caso de sucesso ou código de erro
+ */
+int wal_truncate(wal_t *wal);
+
+/**
+ * Retorna o tamanho do log, em bytes, incluindo registros ainda em buffer
+ */
+size_t wal_size(const wal_t *wal);
+
+/**
+ * Retorna o nível de durabilidade do log
+ */
+btree_durability_t wal_durability(const wal_t *wal);
+
+/**
+ * Percorre os registros íntegros do log, em ordem, aplicando apply a cada um
+ *
+ * A leitura termina no primeiro registro incompleto ou corrompido, que
+ * corresponde a uma escrita interrompida
+ *
+ * @param wal Ponteiro para o log
+ * @param apply Função aplicada a cada registro
+ * @param ctx Contexto repassado a apply
+ *
+ * @return Quantidade de registros aplicados ou código de erro
+ */
+int wal_replay(wal_t *wal, wal_apply_fn apply, void *ctx);
+
+#endif // !WAL_H